@@ -0,0 +1,842 @@
+/*
+ *	wiiuse
+ *
+ *	This file is part of wiiuse.
+ *
+ *	This program is free software; you can redistribute it and/or modify
+ *	it under the terms of the GNU General Public License as published by
+ *	the Free Software Foundation; either version 3 of the License, or
+ *	(at your option) any later version.
+ *
+ *	This program is distributed in the hope that it will be useful,
+ *	but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *	GNU General Public License for more details.
+ *
+ *	You should have received a copy of the GNU General Public License
+ *	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *	$Header$
+ *
+ */
+
+/**
+ *	@file
+ *	@brief Micro-benchmark of the report decode path and the dynamics code.
+ *
+ *	Feeds synthetic reports of every data report type (and optionally a
+ *	recorded capture) through propagate_event() and the individual decode
+ *	kernels, then prints ns, cycles and heap allocations per report as JSON
+ *	on stdout.
+ *
+ *	Usage: wiiuse_bench [-n iterations] [-r repeats] [--replay capture.txt]
+ *
+ *	A capture is a text file with one report per line, either as bare hex
+ *	bytes starting with the report id ("31 00 00 80 80 99") or as the
+ *	"RECV: (31) 00 00 ..." lines a Debug build of the library logs.
+ *	Lines starting with '#' are ignored.
+ *
+ *	Cycles come from perf_event_open() and are reported as null when the
+ *	kernel does not allow it (see /proc/sys/kernel/perf_event_paranoid).
+ *	Allocations are counted by wrapping malloc() and friends, including
+ *	the aligned ones (memalign(), aligned_alloc(), posix_memalign(),
+ *	valloc()), which needs glibc; elsewhere they are reported as null.
+ */
+
+#define _GNU_SOURCE
+
+#include "dynamics.h"
+#include "events.h"
+#include "ir.h"
+#include "motion_plus.h"
+#include "wiiuse_internal.h"
+
+#include <errno.h>            /* for EINVAL, ENOMEM */
+#include <linux/perf_event.h> /* for perf_event_attr */
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/syscall.h> /* for __NR_perf_event_open */
+#include <time.h>        /* for clock_gettime */
+#include <unistd.h>      /* for syscall, read, dup */
+
+/* number of distinct inputs generated per case, must be a power of two */
+#define POOL_SIZE 256
+
+#define DEFAULT_ITERATIONS 200000
+#define DEFAULT_REPEATS 5
+
+/*
+ * Allocation counting
+ */
+#ifdef __GLIBC__
+#define HAVE_ALLOC_COUNT 1
+
+extern void *__libc_malloc(size_t size);
+extern void *__libc_calloc(size_t nmemb, size_t size);
+extern void *__libc_realloc(void *ptr, size_t size);
+extern void __libc_free(void *ptr);
+extern void *__libc_memalign(size_t alignment, size_t size);
+extern void *__libc_valloc(size_t size);
+
+static unsigned long alloc_count = 0;
+
+void *malloc(size_t size)
+{
+    ++alloc_count;
+    return __libc_malloc(size);
+}
+
+void *calloc(size_t nmemb, size_t size)
+{
+    ++alloc_count;
+    return __libc_calloc(nmemb, size);
+}
+
+void *realloc(void *ptr, size_t size)
+{
+    ++alloc_count;
+    return __libc_realloc(ptr, size);
+}
+
+/* the aligned variants, so an arena carved out of them is counted too */
+void *memalign(size_t alignment, size_t size)
+{
+    ++alloc_count;
+    return __libc_memalign(alignment, size);
+}
+
+void *aligned_alloc(size_t alignment, size_t size)
+{
+    ++alloc_count;
+    return __libc_memalign(alignment, size);
+}
+
+int posix_memalign(void **ptr, size_t alignment, size_t size)
+{
+    void *p;
+
+    if (alignment < sizeof(void *) || (alignment & (alignment - 1)))
+    {
+        return EINVAL;
+    }
+    ++alloc_count;
+    p = __libc_memalign(alignment, size);
+    if (!p)
+    {
+        return ENOMEM;
+    }
+    *ptr = p;
+    return 0;
+}
+
+void *valloc(size_t size)
+{
+    ++alloc_count;
+    return __libc_valloc(size);
+}
+
+void free(void *ptr) { __libc_free(ptr); }
+#else
+#define HAVE_ALLOC_COUNT 0
+static unsigned long alloc_count = 0;
+#endif
+
+/*
+ * Cycle counter
+ */
+static int cycles_fd = -1;
+
+static void cycles_open()
+{
+    struct perf_event_attr attr;
+
+    memset(&attr, 0, sizeof(attr));
+    attr.type           = PERF_TYPE_HARDWARE;
+    attr.size           = sizeof(attr);
+    attr.config         = PERF_COUNT_HW_CPU_CYCLES;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv     = 1;
+
+    cycles_fd = (int)syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+}
+
+static uint64_t cycles_now()
+{
+    uint64_t value = 0;
+
+    if (cycles_fd < 0 || read(cycles_fd, &value, sizeof(value)) != sizeof(value))
+    {
+        return 0;
+    }
+    return value;
+}
+
+static uint64_t ns_now()
+{
+    struct timespec tp;
+    clock_gettime(CLOCK_MONOTONIC, &tp);
+    return (uint64_t)tp.tv_sec * 1000000000u + (uint64_t)tp.tv_nsec;
+}
+
+/*
+ * Inputs
+ */
+static struct wiimote_t *wm_nunchuk;     /* nunchuk attached, IR and accel on */
+static struct wiimote_t *wm_motion_plus; /* Motion Plus attached */
+
+/* synthetic reports, [report id - WM_RPT_BTN][n][report id + payload] */
+static byte reports[16][POOL_SIZE][MAX_PAYLOAD];
+static byte mp_frames[POOL_SIZE][6];
+static struct vec3b_t accels[POOL_SIZE];
+static byte batch_x[POOL_SIZE], batch_y[POOL_SIZE], batch_z[POOL_SIZE]; /* accels as arrays */
+static byte sticks[POOL_SIZE][2];
+static byte constellation_ir[POOL_SIZE][12]; /* extended IR of the four LEDs below */
+
+/* an asymmetric four LED constellation, about 1.5 m in front of the camera */
+static const float constellation[4][3] = {
+    {-0.2f, 0.0f, 0.0f}, {0.2f, 0.0f, 0.0f}, {-0.08f, 0.15f, 0.0f}, {0.12f, 0.09f, 0.02f}};
+
+static byte *replay        = NULL; /* MAX_PAYLOAD bytes per report */
+static unsigned replay_len = 0;
+
+static uint32_t rng_state = 0x2545F491;
+
+static uint32_t rng()
+{
+    /* xorshift32, fixed seed so every run sees the same inputs */
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 17;
+    rng_state ^= rng_state << 5;
+    return rng_state;
+}
+
+static byte jitter(byte center, int amplitude)
+{
+    return (byte)(center + (int)(rng() % (2 * amplitude + 1)) - amplitude);
+}
+
+static void put_buttons(byte *p, unsigned n)
+{
+    /* change the buttons every 16 reports so held/released get exercised */
+    uint16_t btns = ((n / 16) & 1) ? (uint16_t)(rng() & WIIMOTE_BUTTON_ALL) : 0;
+    p[0]          = btns >> 8;
+    p[1]          = btns & 0xFF;
+}
+
+static void put_accel(byte *p)
+{
+    p[0] = jitter(0x80, 0x19);
+    p[1] = jitter(0x80, 0x19);
+    p[2] = jitter(0x9A, 0x19);
+}
+
+/* two visible dots around the center of the camera, two invisible */
+static void put_basic_ir(byte *p)
+{
+    unsigned x1 = 1023 - (400 + rng() % 32), y1 = 380 + rng() % 16;
+    unsigned x2 = 1023 - (600 + rng() % 32), y2 = 380 + rng() % 16;
+
+    p[0] = x1 & 0xFF;
+    p[1] = y1 & 0xFF;
+    p[2] = ((y1 >> 8) << 6) | ((x1 >> 8) << 4) | ((y2 >> 8) << 2) | (x2 >> 8);
+    p[3] = x2 & 0xFF;
+    p[4] = y2 & 0xFF;
+    memset(p + 5, 0xFF, 5);
+}
+
+static void put_extended_ir(byte *p)
+{
+    int i;
+
+    for (i = 0; i < 2; ++i)
+    {
+        unsigned x = 1023 - (400 + 200 * i + rng() % 32), y = 380 + rng() % 16;
+        p[3 * i]     = x & 0xFF;
+        p[3 * i + 1] = y & 0xFF;
+        p[3 * i + 2] = ((y >> 8) << 6) | ((x >> 8) << 4) | (2 + rng() % 4);
+    }
+    memset(p + 6, 0xFF, 6);
+}
+
+/* full mode halves: the first carries the two visible dots, the second two invisible ones */
+static void put_full_ir(byte *p, int visible)
+{
+    int i;
+
+    memset(p, 0xFF, 18);
+    for (i = 0; visible && i < 2; ++i)
+    {
+        unsigned x = 1023 - (400 + 200 * i + rng() % 32), y = 380 + rng() % 16;
+        byte *d    = p + 9 * i;
+
+        d[0] = x & 0xFF;
+        d[1] = y & 0xFF;
+        d[2] = ((y >> 8) << 6) | ((x >> 8) << 4) | (2 + rng() % 4);
+        d[3] = (x >> 3) - 1;
+        d[4] = (y >> 3) - 1;
+        d[5] = (x >> 3) + 1;
+        d[6] = (y >> 3) + 1;
+        d[7] = 0;
+        d[8] = 0x80 + rng() % 64;
+    }
+}
+
+/* where the camera sees the constellation, give or take a pixel */
+static void put_constellation_ir(byte *p)
+{
+    static const unsigned dots[4][2] = {{330, 383}, {696, 384}, {439, 520}, {622, 468}};
+    int i;
+
+    for (i = 0; i < 4; ++i)
+    {
+        unsigned x = dots[i][0] - 1 + rng() % 3, y = dots[i][1] - 1 + rng() % 3;
+        p[3 * i]     = x & 0xFF;
+        p[3 * i + 1] = y & 0xFF;
+        p[3 * i + 2] = ((y >> 8) << 6) | ((x >> 8) << 4) | 3;
+    }
+}
+
+static void put_nunchuk(byte *p)
+{
+    p[0] = jitter(0x80, 0x60);
+    p[1] = jitter(0x80, 0x60);
+    put_accel(p + 2);
+    p[5] = 0x03 & ~(rng() & 0x03);
+}
+
+static void put_motion_plus(byte *p)
+{
+    /* slow mode on all axes, no pass-through extension */
+    uint16_t yaw = 8000 + rng() % 64, roll = 8000 + rng() % 64, pitch = 8000 + rng() % 64;
+
+    p[0] = yaw & 0xFF;
+    p[1] = roll & 0xFF;
+    p[2] = pitch & 0xFF;
+    p[3] = ((yaw >> 6) & 0xFC) | 0x03;
+    p[4] = ((roll >> 6) & 0xFC) | 0x02;
+    p[5] = ((pitch >> 6) & 0xFC) | 0x02;
+}
+
+static void generate_inputs()
+{
+    unsigned n;
+
+    for (n = 0; n < POOL_SIZE; ++n)
+    {
+        byte *r;
+
+        r = reports[WM_RPT_BTN & 0x0F][n];
+        r[0] = WM_RPT_BTN;
+        put_buttons(r + 1, n);
+
+        r = reports[WM_RPT_BTN_ACC & 0x0F][n];
+        r[0] = WM_RPT_BTN_ACC;
+        put_buttons(r + 1, n);
+        put_accel(r + 3);
+
+        r = reports[WM_RPT_BTN_EXP_8 & 0x0F][n];
+        r[0] = WM_RPT_BTN_EXP_8;
+        put_buttons(r + 1, n);
+        put_nunchuk(r + 3);
+
+        r = reports[WM_RPT_BTN_ACC_IR & 0x0F][n];
+        r[0] = WM_RPT_BTN_ACC_IR;
+        put_buttons(r + 1, n);
+        put_accel(r + 3);
+        put_extended_ir(r + 6);
+
+        r = reports[WM_RPT_BTN_EXP & 0x0F][n];
+        r[0] = WM_RPT_BTN_EXP;
+        put_buttons(r + 1, n);
+        put_nunchuk(r + 3);
+
+        r = reports[WM_RPT_BTN_ACC_EXP & 0x0F][n];
+        r[0] = WM_RPT_BTN_ACC_EXP;
+        put_buttons(r + 1, n);
+        put_accel(r + 3);
+        put_nunchuk(r + 6);
+
+        r = reports[WM_RPT_BTN_IR_EXP & 0x0F][n];
+        r[0] = WM_RPT_BTN_IR_EXP;
+        put_buttons(r + 1, n);
+        put_basic_ir(r + 3);
+        put_nunchuk(r + 13);
+
+        r = reports[WM_RPT_BTN_ACC_IR_EXP & 0x0F][n];
+        r[0] = WM_RPT_BTN_ACC_IR_EXP;
+        put_buttons(r + 1, n);
+        put_accel(r + 3);
+        put_basic_ir(r + 6);
+        put_nunchuk(r + 16);
+
+        r = reports[WM_RPT_EXP_21 & 0x0F][n];
+        r[0] = WM_RPT_EXP_21;
+        put_nunchuk(r + 1);
+
+        r = reports[WM_RPT_INTERLEAVED_A & 0x0F][n];
+        r[0] = WM_RPT_INTERLEAVED_A;
+        put_buttons(r + 1, n);
+        r[3] = jitter(0x80, 0x19);
+        put_full_ir(r + 4, 1);
+
+        r = reports[WM_RPT_INTERLEAVED_B & 0x0F][n];
+        r[0] = WM_RPT_INTERLEAVED_B;
+        put_buttons(r + 1, n);
+        r[3] = jitter(0x80, 0x19);
+        put_full_ir(r + 4, 0);
+
+        put_constellation_ir(constellation_ir[n]);
+        put_motion_plus(mp_frames[n]);
+
+        accels[n].x = jitter(0x80, 0x19);
+        accels[n].y = jitter(0x80, 0x19);
+        accels[n].z = jitter(0x9A, 0x19);
+
+        batch_x[n] = accels[n].x;
+        batch_y[n] = accels[n].y;
+        batch_z[n] = accels[n].z;
+
+        sticks[n][0] = jitter(0x80, 0x60);
+        sticks[n][1] = jitter(0x80, 0x60);
+    }
+}
+
+static void calibrate_accel(struct accel_t *ac, struct accel_lut_t *lut)
+{
+    ac->cal_zero.x = ac->cal_zero.y = ac->cal_zero.z = 0x80;
+    ac->cal_g.x = ac->cal_g.y = ac->cal_g.z = 0x1A;
+    ac->st_alpha                            = WIIUSE_DEFAULT_SMOOTH_ALPHA;
+    accel_build_lut(ac, lut);
+}
+
+static void setup_wiimotes(struct wiimote_t **wm)
+{
+    struct nunchuk_t *nc;
+
+    wm_nunchuk     = wm[0];
+    wm_motion_plus = wm[1];
+
+    calibrate_accel(&wm_nunchuk->accel_calib, &wm_nunchuk->accel_lut[0]);
+    WIIMOTE_ENABLE_STATE(wm_nunchuk, WIIMOTE_STATE_ACC);
+    WIIMOTE_ENABLE_STATE(wm_nunchuk, WIIMOTE_STATE_IR);
+
+    nc = &wm_nunchuk->exp.nunchuk;
+    calibrate_accel(&nc->accel_calib, &wm_nunchuk->accel_lut[1]);
+    nc->flags       = &wm_nunchuk->flags;
+    nc->js.max.x    = nc->js.max.y = 0xE0;
+    nc->js.min.x    = nc->js.min.y = 0x20;
+    nc->js.center.x = nc->js.center.y = 0x80;
+    wm_nunchuk->exp.type = EXP_NUNCHUK;
+    WIIMOTE_ENABLE_STATE(wm_nunchuk, WIIMOTE_STATE_EXP);
+
+    calibrate_accel(&wm_motion_plus->accel_calib, &wm_motion_plus->accel_lut[0]);
+    wm_motion_plus->exp.type = EXP_MOTION_PLUS;
+    WIIMOTE_ENABLE_STATE(wm_motion_plus, WIIMOTE_STATE_EXP);
+
+    /* the IR pose case runs on the Motion Plus remote, which has no IR of its own here */
+    wiiuse_set_ir_constellation(wm_motion_plus, constellation, 0.0f);
+}
+
+/*
+ * Replay of recorded reports
+ */
+static int parse_report(const char *line, byte *out)
+{
+    const char *p = strstr(line, "RECV: (");
+    char *end;
+    int len = 0;
+
+    if (p)
+    {
+        /* debug log format: "RECV: (31) 00 00 ..." */
+        p += strlen("RECV: (");
+        out[len++] = (byte)strtoul(p, &end, 16);
+        p          = end + 1;
+    } else
+    {
+        p = line;
+    }
+
+    while (len < MAX_PAYLOAD)
+    {
+        unsigned long value = strtoul(p, &end, 16);
+        if (end == p)
+        {
+            break;
+        }
+        out[len++] = (byte)value;
+        p          = end;
+    }
+
+    return len;
+}
+
+static int load_replay(const char *path)
+{
+    char line[512];
+    unsigned capacity = 0;
+    FILE *f           = fopen(path, "r");
+
+    if (!f)
+    {
+        perror(path);
+        return 0;
+    }
+
+    while (fgets(line, sizeof(line), f))
+    {
+        byte report[MAX_PAYLOAD];
+        int len;
+
+        if (line[0] == '#')
+        {
+            continue;
+        }
+
+        memset(report, 0, sizeof(report));
+        len = parse_report(line, report);
+        if (len < 2 || (report[0] & 0xF0) != WM_RPT_BTN)
+        {
+            /* only data reports, replies to requests need a live connection */
+            continue;
+        }
+
+        if (replay_len == capacity)
+        {
+            capacity = capacity ? 2 * capacity : 1024;
+            replay   = (byte *)realloc(replay, (size_t)capacity * MAX_PAYLOAD);
+            if (!replay)
+            {
+                fclose(f);
+                return 0;
+            }
+        }
+        memcpy(replay + (size_t)replay_len * MAX_PAYLOAD, report, MAX_PAYLOAD);
+        ++replay_len;
+    }
+
+    fclose(f);
+
+    if (!replay_len)
+    {
+        fprintf(stderr, "%s: no reports found\n", path);
+        return 0;
+    }
+    return 1;
+}
+
+/*
+ * Benchmark cases
+ */
+struct bench_case_t;
+typedef void (*bench_fn)(const struct bench_case_t *bc, unsigned i);
+
+struct bench_case_t
+{
+    const char *name;
+    byte report; /**< report id for the propagate_event cases */
+    bench_fn fn;
+};
+
+static void bench_propagate(const struct bench_case_t *bc, unsigned i)
+{
+    byte *r = reports[bc->report & 0x0F][i & (POOL_SIZE - 1)];
+    propagate_event(wm_nunchuk, r[0], r + 1);
+}
+
+static void bench_propagate_motion_plus(const struct bench_case_t *bc, unsigned i)
+{
+    byte *r = reports[WM_RPT_BTN_ACC_EXP & 0x0F][i & (POOL_SIZE - 1)];
+
+    /* reuse buttons and accel, swap in a gyro frame */
+    memcpy(r + 6, mp_frames[i & (POOL_SIZE - 1)], 6);
+    propagate_event(wm_motion_plus, r[0], r + 1);
+    (void)bc;
+}
+
+static void bench_replay(const struct bench_case_t *bc, unsigned i)
+{
+    byte *r = replay + (size_t)(i % replay_len) * MAX_PAYLOAD;
+    propagate_event(wm_nunchuk, r[0], r + 1);
+    (void)bc;
+}
+
+static void bench_orientation(const struct bench_case_t *bc, unsigned i)
+{
+    calculate_orientation(&wm_nunchuk->accel_calib, &accels[i & (POOL_SIZE - 1)], &wm_nunchuk->orient, 0);
+    (void)bc;
+}
+
+static void bench_orientation_smoothed(const struct bench_case_t *bc, unsigned i)
+{
+    calculate_orientation(&wm_nunchuk->accel_calib, &accels[i & (POOL_SIZE - 1)], &wm_nunchuk->orient, 1);
+    (void)bc;
+}
+
+static void bench_gforce(const struct bench_case_t *bc, unsigned i)
+{
+    calculate_gforce(&wm_nunchuk->accel_calib, &accels[i & (POOL_SIZE - 1)], &wm_nunchuk->gforce);
+    (void)bc;
+}
+
+/* the batch cases process BATCH_SIZE pool samples every BATCH_SIZE calls */
+#define BATCH_SIZE 64
+
+static float batch_out[5][BATCH_SIZE];
+
+static void run_batch(unsigned i, void (*kernel)(const struct accel_t *, struct accel_batch_t *))
+{
+    struct accel_batch_t b;
+    unsigned first = i & (POOL_SIZE - 1) & ~(BATCH_SIZE - 1);
+
+    if (i & (BATCH_SIZE - 1))
+    {
+        return;
+    }
+
+    b.n     = BATCH_SIZE;
+    b.x     = batch_x + first;
+    b.y     = batch_y + first;
+    b.z     = batch_z + first;
+    b.gx    = batch_out[0];
+    b.gy    = batch_out[1];
+    b.gz    = batch_out[2];
+    b.roll  = batch_out[3];
+    b.pitch = batch_out[4];
+    kernel(&wm_nunchuk->accel_calib, &b);
+}
+
+static void batch_dispatched(const struct accel_t *ac, struct accel_batch_t *b)
+{
+    wiiuse_accel_batch(ac, b, &wm_nunchuk->orient);
+}
+
+static void bench_accel_batch(const struct bench_case_t *bc, unsigned i)
+{
+    run_batch(i, batch_dispatched);
+    (void)bc;
+}
+
+static void bench_accel_batch_scalar(const struct bench_case_t *bc, unsigned i)
+{
+    run_batch(i, accel_batch_scalar);
+    (void)bc;
+}
+
+static void bench_joystick(const struct bench_case_t *bc, unsigned i)
+{
+    byte *s = sticks[i & (POOL_SIZE - 1)];
+    calc_joystick_state(&wm_nunchuk->exp.nunchuk.js, s[0], s[1]);
+    (void)bc;
+}
+
+/* interpret_ir_data() is static to ir.c; it is reached through these three */
+static void bench_basic_ir(const struct bench_case_t *bc, unsigned i)
+{
+    calculate_basic_ir(wm_nunchuk, reports[WM_RPT_BTN_IR_EXP & 0x0F][i & (POOL_SIZE - 1)] + 3);
+    (void)bc;
+}
+
+static void bench_extended_ir(const struct bench_case_t *bc, unsigned i)
+{
+    calculate_extended_ir(wm_nunchuk, reports[WM_RPT_BTN_ACC_IR & 0x0F][i & (POOL_SIZE - 1)] + 6);
+    (void)bc;
+}
+
+static void bench_full_ir(const struct bench_case_t *bc, unsigned i)
+{
+    calculate_full_ir(wm_nunchuk, reports[WM_RPT_INTERLEAVED_A & 0x0F][i & (POOL_SIZE - 1)] + 4,
+                      reports[WM_RPT_INTERLEAVED_B & 0x0F][i & (POOL_SIZE - 1)] + 4);
+    (void)bc;
+}
+
+static void bench_ir_pose(const struct bench_case_t *bc, unsigned i)
+{
+    calculate_extended_ir(wm_motion_plus, constellation_ir[i & (POOL_SIZE - 1)]);
+    (void)bc;
+}
+
+static void bench_motion_plus(const struct bench_case_t *bc, unsigned i)
+{
+    motion_plus_event(&wm_motion_plus->exp.mp, EXP_MOTION_PLUS, mp_frames[i & (POOL_SIZE - 1)]);
+    (void)bc;
+}
+
+static const struct bench_case_t cases[] = {
+    {"propagate_event/0x30", WM_RPT_BTN, bench_propagate},
+    {"propagate_event/0x31", WM_RPT_BTN_ACC, bench_propagate},
+    {"propagate_event/0x32", WM_RPT_BTN_EXP_8, bench_propagate},
+    {"propagate_event/0x33", WM_RPT_BTN_ACC_IR, bench_propagate},
+    {"propagate_event/0x34", WM_RPT_BTN_EXP, bench_propagate},
+    {"propagate_event/0x35", WM_RPT_BTN_ACC_EXP, bench_propagate},
+    {"propagate_event/0x36", WM_RPT_BTN_IR_EXP, bench_propagate},
+    {"propagate_event/0x37", WM_RPT_BTN_ACC_IR_EXP, bench_propagate},
+    {"propagate_event/0x3d", WM_RPT_EXP_21, bench_propagate},
+    {"propagate_event/0x3e", WM_RPT_INTERLEAVED_A, bench_propagate},
+    {"propagate_event/0x3f", WM_RPT_INTERLEAVED_B, bench_propagate},
+    {"propagate_event/0x35_motion_plus", WM_RPT_BTN_ACC_EXP, bench_propagate_motion_plus},
+    {"calculate_orientation", 0, bench_orientation},
+    {"calculate_orientation_smoothed", 0, bench_orientation_smoothed},
+    {"calculate_gforce", 0, bench_gforce},
+    {"accel_batch", 0, bench_accel_batch},
+    {"accel_batch/scalar", 0, bench_accel_batch_scalar},
+    {"calc_joystick_state", 0, bench_joystick},
+    {"calculate_basic_ir", 0, bench_basic_ir},
+    {"calculate_extended_ir", 0, bench_extended_ir},
+    {"calculate_full_ir", 0, bench_full_ir},
+    {"calculate_extended_ir/pose", 0, bench_ir_pose},
+    {"motion_plus_event", 0, bench_motion_plus},
+};
+
+static const struct bench_case_t replay_case = {"replay/propagate_event", 0, bench_replay};
+
+/**
+ *	@brief Run one case and print its JSON object.
+ *
+ *	The best of \a repeats runs is reported, which is the most stable
+ *	figure on a machine that is doing other things at the same time.
+ */
+static void run_case(const struct bench_case_t *bc, unsigned iterations, unsigned repeats, int first)
+{
+    uint64_t best_ns = UINT64_MAX, best_cycles = UINT64_MAX;
+    uint64_t t0, t1, c0, c1;
+    unsigned long a0, allocs = 0;
+    unsigned r, i;
+
+    /* warm up caches and the branch predictor */
+    for (i = 0; i < iterations / 10; ++i)
+    {
+        bc->fn(bc, i);
+    }
+
+    for (r = 0; r < repeats; ++r)
+    {
+        a0 = alloc_count;
+        c0 = cycles_now();
+        t0 = ns_now();
+
+        for (i = 0; i < iterations; ++i)
+        {
+            bc->fn(bc, i);
+        }
+
+        t1 = ns_now();
+        c1 = cycles_now();
+
+        if (t1 - t0 < best_ns)
+        {
+            best_ns = t1 - t0;
+        }
+        if (c1 - c0 < best_cycles)
+        {
+            best_cycles = c1 - c0;
+        }
+        if (alloc_count - a0 > allocs)
+        {
+            allocs = alloc_count - a0;
+        }
+    }
+
+    printf("%s    {\"name\": \"%s\", \"ns_per_report\": %.3f, ", first ? "" : ",\n", bc->name,
+           (double)best_ns / iterations);
+    if (cycles_fd >= 0)
+    {
+        printf("\"cycles_per_report\": %.3f, ", (double)best_cycles / iterations);
+    } else
+    {
+        printf("\"cycles_per_report\": null, ");
+    }
+    if (HAVE_ALLOC_COUNT)
+    {
+        printf("\"allocs_per_report\": %.4f}", (double)allocs / iterations);
+    } else
+    {
+        printf("\"allocs_per_report\": null}");
+    }
+}
+
+static void usage(const char *argv0)
+{
+    fprintf(stderr, "usage: %s [-n iterations] [-r repeats] [--replay capture.txt]\n", argv0);
+}
+
+int main(int argc, char **argv)
+{
+    struct wiimote_t **wm;
+    unsigned iterations    = DEFAULT_ITERATIONS;
+    unsigned repeats       = DEFAULT_REPEATS;
+    const char *replay_path = NULL;
+    unsigned c;
+    int saved_stdout;
+    int i;
+
+    for (i = 1; i < argc; ++i)
+    {
+        if (!strcmp(argv[i], "-n") && i + 1 < argc)
+        {
+            iterations = (unsigned)strtoul(argv[++i], NULL, 10);
+        } else if (!strcmp(argv[i], "-r") && i + 1 < argc)
+        {
+            repeats = (unsigned)strtoul(argv[++i], NULL, 10);
+        } else if (!strcmp(argv[i], "--replay") && i + 1 < argc)
+        {
+            replay_path = argv[++i];
+        } else
+        {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+    if (!iterations || !repeats)
+    {
+        usage(argv[0]);
+        return 1;
+    }
+
+    if (replay_path && !load_replay(replay_path))
+    {
+        return 1;
+    }
+
+    /* the library banner goes to stdout; keep it out of the JSON */
+    fflush(stdout);
+    saved_stdout = dup(STDOUT_FILENO);
+    dup2(STDERR_FILENO, STDOUT_FILENO);
+    wm = wiiuse_init(2);
+    fflush(stdout);
+    dup2(saved_stdout, STDOUT_FILENO);
+    close(saved_stdout);
+
+    wiiuse_set_output(LOGLEVEL_INFO, NULL);
+
+    setup_wiimotes(wm);
+    generate_inputs();
+    cycles_open();
+
+    printf("{\n  \"benchmark\": \"wiiuse_bench\",\n  \"wiiuse_version\": \"%s\",\n", WIIUSE_VERSION);
+    printf("  \"iterations\": %u,\n  \"repeats\": %u,\n", iterations, repeats);
+    printf("  \"accel_batch_kernel\": \"%s\",\n", wiiuse_accel_batch_kernel());
+    printf("  \"results\": [\n");
+
+    for (c = 0; c < sizeof(cases) / sizeof(cases[0]); ++c)
+    {
+        run_case(&cases[c], iterations, repeats, c == 0);
+    }
+    if (replay_len)
+    {
+        run_case(&replay_case, iterations, repeats, 0);
+    }
+
+    printf("\n  ]\n}\n");
+
+    if (cycles_fd >= 0)
+    {
+        close(cycles_fd);
+    }
+    wiiuse_cleanup(wm, 2);
+    free(replay);
+
+    return 0;
+}
@@ -0,0 +1,740 @@
+/*
+ *	wiiuse
+ *
+ *	This file is part of wiiuse.
+ *
+ *	This program is free software; you can redistribute it and/or modify
+ *	it under the terms of the GNU General Public License as published by
+ *	the Free Software Foundation; either version 3 of the License, or
+ *	(at your option) any later version.
+ *
+ *	This program is distributed in the hope that it will be useful,
+ *	but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *	GNU General Public License for more details.
+ *
+ *	You should have received a copy of the GNU General Public License
+ *	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *	$Header$
+ *
+ */
+
+/**
+ *	@file
+ *	@brief End-to-end latency of wiimotebridged, from report to OSC datagram.
+ *
+ *	Starts wiimotebridged with one end of a SOCK_SEQPACKET socketpair as its
+ *	remote (--virtual) and a local UDP port as its OSC server (--osc).  The
+ *	other end is driven by a small emulated Wiimote with a nunchuk attached:
+ *	it answers the handshake, then injects one report at a time and waits
+ *	for the OSC message it should cause.  The time between write() of the
+ *	report and recv() of the datagram is one sample.
+ *
+ *	Paths measured, each with its own histogram:
+ *	  - button       A pressed/released            -> /wii/<id>/buttons/a
+ *	  - orientation  accel change with B held      -> /wii/<id>/orientation
+ *	  - nunchuk      joystick change               -> /wii/<id>/nunchuk/joystick
+ *	  - ir           dot movement, IR on (UP)      -> /wii/<id>/ir
+ *	  - shm          joystick change               -> shared memory (--shm),
+ *	                 read by spinning on wiimote_shm_read()
+ *
+ *	Usage: wiiuse_latency [-n samples] [--bridge path/to/wiimotebridged] [-v]
+ *
+ *	Results are printed as JSON on stdout (ns).  The emulated link has no
+ *	radio, so the figures are what the bridge adds on top of Bluetooth.
+ */
+
+#define _GNU_SOURCE
+
+#include <arpa/inet.h>  /* for inet_pton */
+#include <errno.h>
+#include <fcntl.h>      /* for open */
+#include <netinet/in.h> /* for sockaddr_in */
+#include <poll.h>       /* for poll */
+#include <sched.h>      /* for sched_yield */
+#include <signal.h>     /* for kill */
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>   /* for shm_open, mmap */
+#include <sys/socket.h> /* for socketpair */
+#include <sys/wait.h>   /* for waitpid */
+#include <time.h>       /* for clock_gettime */
+#include <unistd.h>     /* for fork, execv */
+
+#include "wiimote_shm.h"
+
+#ifndef WIIMOTEBRIDGED_PATH
+#define WIIMOTEBRIDGED_PATH "./wiimotebridged"
+#endif
+
+#define DEFAULT_SAMPLES 2000
+#define WIIMOTE_ID 1
+
+/* how long to wait for the datagram of one sample */
+#define SAMPLE_TIMEOUT_MS 200
+/* handshake, LEDs and the connect rumble take a few seconds */
+#define STARTUP_TIMEOUT_MS 20000
+/* B and UP make the bridge talk to the remote (rumble, IR setup) */
+#define SETTLE_MS 400
+/* a remote reports at most every 10 ms in the modes measured */
+#define REPORT_INTERVAL_MS 10
+
+/* HID transaction headers as seen on the L2CAP channel */
+#define HID_INPUT 0xA1
+#define HID_OUTPUT 0xA2
+
+/* output reports (host -> remote) */
+#define OUT_REPORT_TYPE 0x12
+#define OUT_CTRL_STATUS 0x15
+#define OUT_READ_DATA 0x17
+
+/* input reports (remote -> host) */
+#define IN_CTRL_STATUS 0x20
+#define IN_READ_DATA 0x21
+#define IN_BTN_ACC_EXP 0x35
+#define IN_BTN_ACC_IR_EXP 0x37
+
+#define BUTTON_UP 0x0800
+#define BUTTON_A 0x0008
+#define BUTTON_B 0x0004
+
+enum path_t
+{
+    PATH_BUTTON,
+    PATH_ORIENTATION,
+    PATH_NUNCHUK,
+    PATH_IR,
+    PATH_SHM,
+    PATH_COUNT
+};
+
+static const char *path_names[PATH_COUNT] = {"button", "orientation", "nunchuk", "ir", "shm"};
+
+/* emulated remote */
+static int remote_fd = -1;
+static int osc_fd    = -1;
+static int verbose   = 0;
+static unsigned char report_mode = 0x30;
+static char shm_name[32];
+static const wiimote_shm_t *shm = NULL;
+
+static unsigned char eeprom[256];
+static unsigned char exp_regs[256];
+
+static uint64_t ns_now()
+{
+    struct timespec tp;
+    clock_gettime(CLOCK_MONOTONIC, &tp);
+    return (uint64_t)tp.tv_sec * 1000000000u + (uint64_t)tp.tv_nsec;
+}
+
+static void init_memory()
+{
+    /* wiimote accelerometer calibration: zero 0x80, 1g at 0x9A */
+    static const unsigned char accel_cal[8] = {0x80, 0x80, 0x80, 0x00, 0x9A, 0x9A, 0x9A, 0x00};
+    /* nunchuk: accelerometer, then joystick max/min/center for x and y */
+    static const unsigned char nunchuk_cal[16] = {0x80, 0x80, 0x80, 0x00, 0xB3, 0xB3, 0xB3, 0x00,
+                                                  0xE0, 0x20, 0x80, 0xE0, 0x20, 0x80, 0x00, 0x00};
+    static const unsigned char nunchuk_id[6]   = {0x00, 0x00, 0xA4, 0x20, 0x00, 0x00};
+
+    memcpy(eeprom + 0x16, accel_cal, sizeof(accel_cal));
+    memcpy(exp_regs + 0x20, nunchuk_cal, sizeof(nunchuk_cal));
+    memcpy(exp_regs + 0x30, nunchuk_cal, sizeof(nunchuk_cal));
+    memcpy(exp_regs + 0xFA, nunchuk_id, sizeof(nunchuk_id));
+}
+
+static void send_report(const unsigned char *report, size_t len)
+{
+    if (write(remote_fd, report, len) < 0 && verbose)
+    {
+        perror("write to bridge");
+    }
+}
+
+static void answer_read(const unsigned char *req)
+{
+    /* req: header, 0x17, space, addr[3], size[2] */
+    int registers   = req[2] & 0x04;
+    unsigned addr   = (req[3] << 16) | (req[4] << 8) | req[5];
+    unsigned size   = (req[6] << 8) | req[7];
+    unsigned offset = 0;
+
+    while (offset < size)
+    {
+        unsigned char reply[23];
+        unsigned chunk = size - offset > 16 ? 16 : size - offset;
+        unsigned a     = addr + offset;
+        unsigned i;
+
+        memset(reply, 0, sizeof(reply));
+        reply[0] = HID_INPUT;
+        reply[1] = IN_READ_DATA;
+        reply[4] = (unsigned char)((chunk - 1) << 4);
+        reply[5] = (a >> 8) & 0xFF;
+        reply[6] = a & 0xFF;
+
+        for (i = 0; i < chunk; ++i)
+        {
+            unsigned cell = (a + i) & 0xFF;
+            if (!registers)
+            {
+                reply[7 + i] = (a + i) < 0x100 ? eeprom[cell] : 0;
+            } else if (((a + i) >> 16) == 0xA4)
+            {
+                reply[7 + i] = exp_regs[cell];
+            }
+            /* anything else (e.g. the Motion Plus at 0xA6) reads as zero: not present */
+        }
+
+        send_report(reply, sizeof(reply));
+        offset += chunk;
+    }
+}
+
+static void answer_status()
+{
+    /* attachment present, LED 1, full battery */
+    unsigned char reply[8] = {HID_INPUT, IN_CTRL_STATUS, 0x00, 0x00, 0x12, 0x00, 0x00, 0xC0};
+    send_report(reply, sizeof(reply));
+}
+
+/**
+ *	@brief Serve the requests the bridge has written so far.
+ */
+static void serve_requests()
+{
+    unsigned char buf[64];
+    ssize_t len;
+
+    while ((len = recv(remote_fd, buf, sizeof(buf), MSG_DONTWAIT)) > 0)
+    {
+        if (len < 2 || buf[0] != HID_OUTPUT)
+        {
+            continue;
+        }
+        switch (buf[1])
+        {
+        case OUT_CTRL_STATUS:
+            answer_status();
+            break;
+        case OUT_READ_DATA:
+            if (len >= 8)
+            {
+                answer_read(buf);
+            }
+            break;
+        case OUT_REPORT_TYPE:
+            if (len >= 4)
+            {
+                report_mode = buf[3];
+            }
+            break;
+        default:
+            /* LEDs, rumble, register writes: nothing to answer */
+            break;
+        }
+    }
+}
+
+/**
+ *	@brief Check whether a datagram holds a message whose address starts
+ *	with \a prefix, looking inside a #bundle if it is one.
+ */
+static int osc_has_prefix(const char *datagram, ssize_t len, const char *prefix)
+{
+    size_t plen = strlen(prefix);
+    ssize_t off;
+
+    if (len < 16 || memcmp(datagram, "#bundle", 8))
+    {
+        return !strncmp(datagram, prefix, plen);
+    }
+    for (off = 16; off + 4 <= len;)
+    {
+        uint32_t size = ((uint32_t)(uint8_t)datagram[off] << 24) | ((uint32_t)(uint8_t)datagram[off + 1] << 16)
+                        | ((uint32_t)(uint8_t)datagram[off + 2] << 8) | (uint8_t)datagram[off + 3];
+
+        off += 4;
+        if (size > (size_t)(len - off))
+        {
+            break;
+        }
+        if (size >= plen && !strncmp(datagram + off, prefix, plen))
+        {
+            return 1;
+        }
+        off += size;
+    }
+    return 0;
+}
+
+/**
+ *	@brief Wait for a request or an OSC datagram, serving requests meanwhile.
+ *
+ *	@return 1 if a datagram whose address starts with \a prefix arrived
+ *	(timestamped in \a when), 0 on timeout.  Other datagrams are dropped.
+ */
+static int wait_for_osc(const char *prefix, int timeout_ms, uint64_t *when)
+{
+    uint64_t deadline = ns_now() + (uint64_t)timeout_ms * 1000000u;
+
+    for (;;)
+    {
+        struct pollfd fds[2];
+        uint64_t now = ns_now();
+        char datagram[1500];
+        ssize_t len;
+
+        if (now >= deadline)
+        {
+            return 0;
+        }
+
+        fds[0].fd     = osc_fd;
+        fds[0].events = POLLIN;
+        fds[1].fd     = remote_fd;
+        fds[1].events = POLLIN;
+        if (poll(fds, 2, (int)((deadline - now) / 1000000u) + 1) < 0 && errno != EINTR)
+        {
+            return 0;
+        }
+
+        if (fds[1].revents & (POLLHUP | POLLERR))
+        {
+            fprintf(stderr, "wiimotebridged closed the remote\n");
+            exit(1);
+        }
+        if (fds[1].revents & POLLIN)
+        {
+            serve_requests();
+        }
+        if (fds[0].revents & POLLIN)
+        {
+            len = recv(osc_fd, datagram, sizeof(datagram) - 1, 0);
+            if (len > 0)
+            {
+                uint64_t t = ns_now();
+                datagram[len] = '\0';
+                if (prefix && osc_has_prefix(datagram, len, prefix))
+                {
+                    *when = t;
+                    return 1;
+                }
+            }
+        }
+    }
+}
+
+/**
+ *	@brief Spin on the shared memory until the bridge publishes a report
+ *	after the \a reports it had published before.
+ *
+ *	@return 1 if it did (timestamped in \a when), 0 on timeout.
+ */
+static int wait_for_shm(uint64_t reports, int timeout_ms, uint64_t *when)
+{
+    uint64_t deadline = ns_now() + (uint64_t)timeout_ms * 1000000u;
+    wiimote_shm_state_t state;
+
+    while (ns_now() < deadline)
+    {
+        if (wiimote_shm_read(shm, 0, &state) && state.reports != reports)
+        {
+            *when = ns_now();
+            return 1;
+        }
+        /* a renderer reads once per frame; spinning must not starve the
+           bridge when both share a core */
+        sched_yield();
+    }
+    return 0;
+}
+
+/**
+ *	@brief Map the bridge's shared memory once it has set it up.
+ */
+static int map_shm()
+{
+    int fd = shm_open(shm_name, O_RDONLY, 0);
+    void *p;
+
+    if (fd < 0)
+    {
+        perror(shm_name);
+        return 0;
+    }
+    p = mmap(NULL, sizeof(wiimote_shm_t), PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (p == MAP_FAILED || !wiimote_shm_valid((const wiimote_shm_t *)p))
+    {
+        fprintf(stderr, "%s: not set up by wiimotebridged\n", shm_name);
+        return 0;
+    }
+    shm = (const wiimote_shm_t *)p;
+    return 1;
+}
+
+/* discard whatever the bridge still sends for the previous report */
+static void drain(int ms)
+{
+    uint64_t ignored;
+    wait_for_osc(NULL, ms, &ignored);
+}
+
+/**
+ *	@brief Build an input report in the mode the bridge last requested.
+ */
+static size_t build_report(unsigned char *r, uint16_t buttons, int accel_x, int stick_x, int ir_x)
+{
+    size_t len;
+
+    memset(r, 0, 23);
+    r[0] = HID_INPUT;
+    r[2] = buttons >> 8;
+    r[3] = buttons & 0xFF;
+    r[4] = (unsigned char)accel_x;
+    r[5] = 0x80;
+    r[6] = 0x9A;
+
+    if (report_mode == IN_BTN_ACC_IR_EXP)
+    {
+        /* one visible dot pair, the other pair out of view */
+        unsigned x1 = 1023 - (unsigned)ir_x, x2 = 1023 - (unsigned)(ir_x + 200), y = 384;
+
+        r[1]  = IN_BTN_ACC_IR_EXP;
+        r[7]  = x1 & 0xFF;
+        r[8]  = y & 0xFF;
+        r[9]  = ((y >> 8) << 6) | ((x1 >> 8) << 4) | ((y >> 8) << 2) | (x2 >> 8);
+        r[10] = x2 & 0xFF;
+        r[11] = y & 0xFF;
+        memset(r + 12, 0xFF, 5);
+        r[17] = (unsigned char)stick_x;
+        r[18] = 0x80;
+        r[19] = 0x80;
+        r[20] = 0x80;
+        r[21] = 0xB3;
+        r[22] = 0x03;
+        len   = 23;
+    } else
+    {
+        r[1]  = IN_BTN_ACC_EXP;
+        r[7]  = (unsigned char)stick_x;
+        r[8]  = 0x80;
+        r[9]  = 0x80;
+        r[10] = 0x80;
+        r[11] = 0xB3;
+        r[12] = 0x03;
+        len   = 23;
+    }
+
+    return len;
+}
+
+/**
+ *	@brief Send one report and let the bridge settle (button presses that sleep).
+ */
+static void press(uint16_t buttons)
+{
+    unsigned char r[23];
+    send_report(r, build_report(r, buttons, 0x80, 0x80, 400));
+    drain(SETTLE_MS);
+}
+
+static int cmp_u64(const void *a, const void *b)
+{
+    uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+    return x < y ? -1 : x > y;
+}
+
+static uint64_t percentile(const uint64_t *sorted, unsigned n, double p)
+{
+    /* nearest rank */
+    unsigned rank = (unsigned)(p / 100.0 * n + 0.999999);
+    if (rank < 1)
+    {
+        rank = 1;
+    }
+    if (rank > n)
+    {
+        rank = n;
+    }
+    return sorted[rank - 1];
+}
+
+/**
+ *	@brief Measure one path.
+ *
+ *	Alternates between two report variants so every report is a state change.
+ */
+static void run_path(enum path_t path, unsigned samples, uint64_t *lat, unsigned *count, unsigned *lost)
+{
+    char prefix[64];
+    unsigned i;
+
+    switch (path)
+    {
+    case PATH_BUTTON:
+        snprintf(prefix, sizeof(prefix), "/wii/%d/buttons/a", WIIMOTE_ID);
+        break;
+    case PATH_ORIENTATION:
+        snprintf(prefix, sizeof(prefix), "/wii/%d/orientation", WIIMOTE_ID);
+        break;
+    case PATH_NUNCHUK:
+    case PATH_SHM:
+        snprintf(prefix, sizeof(prefix), "/wii/%d/nunchuk/joystick", WIIMOTE_ID);
+        break;
+    default:
+        snprintf(prefix, sizeof(prefix), "/wii/%d/ir", WIIMOTE_ID);
+        break;
+    }
+
+    *count = 0;
+    *lost  = 0;
+    for (i = 0; i < samples; ++i)
+    {
+        unsigned char r[23];
+        size_t len;
+        uint64_t sent, received;
+        wiimote_shm_state_t state;
+        int odd = i & 1;
+        int elapsed_ms;
+
+        switch (path)
+        {
+        case PATH_BUTTON:
+            len = build_report(r, odd ? 0 : BUTTON_A, 0x80, 0x80, 400);
+            break;
+        case PATH_ORIENTATION:
+            len = build_report(r, BUTTON_B, odd ? 0x70 : 0x90, 0x80, 400);
+            break;
+        case PATH_NUNCHUK:
+        case PATH_SHM:
+            len = build_report(r, 0, 0x80, odd ? 0x60 : 0xA0, 400);
+            break;
+        default:
+            len = build_report(r, 0, 0x80, 0x80, odd ? 380 : 420);
+            break;
+        }
+
+        /* the shared memory path waits for the report count to move */
+        if (path == PATH_SHM && !wiimote_shm_read(shm, 0, &state))
+        {
+            state.reports = 0;
+        }
+
+        sent = ns_now();
+        send_report(r, len);
+        if (path == PATH_SHM ? wait_for_shm(state.reports, SAMPLE_TIMEOUT_MS, &received)
+                             : wait_for_osc(prefix, SAMPLE_TIMEOUT_MS, &received))
+        {
+            lat[(*count)++] = received - sent;
+        } else
+        {
+            ++*lost;
+        }
+
+        /* let the rest of this report's messages go by, and pace reports
+           like a real remote so the bridge's rate caps are not hit */
+        elapsed_ms = (int)((ns_now() - sent) / 1000000u);
+        drain(elapsed_ms + 1 < REPORT_INTERVAL_MS ? REPORT_INTERVAL_MS - elapsed_ms : 1);
+    }
+
+    qsort(lat, *count, sizeof(uint64_t), cmp_u64);
+}
+
+static int start_bridge(const char *bridge, int *port, pid_t *pid)
+{
+    int sv[2];
+    struct sockaddr_in addr;
+    socklen_t addrlen = sizeof(addr);
+
+    if (socketpair(AF_UNIX, SOCK_SEQPACKET, 0, sv) < 0)
+    {
+        perror("socketpair");
+        return 0;
+    }
+
+    osc_fd = socket(AF_INET, SOCK_DGRAM, 0);
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    inet_pton(AF_INET, "127.0.0.1", &addr.sin_addr);
+    if (osc_fd < 0 || bind(osc_fd, (struct sockaddr *)&addr, sizeof(addr)) < 0
+        || getsockname(osc_fd, (struct sockaddr *)&addr, &addrlen) < 0)
+    {
+        perror("UDP sink");
+        return 0;
+    }
+    *port = ntohs(addr.sin_port);
+
+    snprintf(shm_name, sizeof(shm_name), "/wiiuse_latency.%d", (int)getpid());
+
+    *pid = fork();
+    if (*pid < 0)
+    {
+        perror("fork");
+        return 0;
+    }
+    if (*pid == 0)
+    {
+        char fd_arg[16], osc_arg[32], id_arg[8];
+
+        close(sv[0]);
+        close(osc_fd);
+        snprintf(fd_arg, sizeof(fd_arg), "%d", sv[1]);
+        snprintf(osc_arg, sizeof(osc_arg), "127.0.0.1:%d", *port);
+        snprintf(id_arg, sizeof(id_arg), "%d", WIIMOTE_ID);
+
+        if (!verbose)
+        {
+            int devnull = open("/dev/null", O_WRONLY);
+            dup2(devnull, STDOUT_FILENO);
+            dup2(devnull, STDERR_FILENO);
+        }
+
+        execl(bridge, bridge, "--virtual", fd_arg, "--osc", osc_arg, "--shm", shm_name, id_arg, (char *)NULL);
+        perror(bridge);
+        _exit(127);
+    }
+
+    close(sv[1]);
+    remote_fd = sv[0];
+    return 1;
+}
+
+/**
+ *	@brief Serve the handshake until the bridge turns on motion sensing,
+ *	which is the last thing it does before entering its main loop.
+ */
+static int wait_for_startup()
+{
+    uint64_t deadline = ns_now() + (uint64_t)STARTUP_TIMEOUT_MS * 1000000u;
+
+    while (ns_now() < deadline)
+    {
+        drain(10);
+        if (report_mode == IN_BTN_ACC_EXP)
+        {
+            drain(SETTLE_MS);
+            return 1;
+        }
+    }
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    const char *bridge = WIIMOTEBRIDGED_PATH;
+    unsigned samples   = DEFAULT_SAMPLES;
+    uint64_t *lat[PATH_COUNT];
+    unsigned count[PATH_COUNT], lost[PATH_COUNT];
+    int port, status, p, i;
+    pid_t pid;
+
+    for (i = 1; i < argc; ++i)
+    {
+        if (!strcmp(argv[i], "-n") && i + 1 < argc)
+        {
+            samples = (unsigned)strtoul(argv[++i], NULL, 10);
+        } else if (!strcmp(argv[i], "--bridge") && i + 1 < argc)
+        {
+            bridge = argv[++i];
+        } else if (!strcmp(argv[i], "-v"))
+        {
+            verbose = 1;
+        } else
+        {
+            fprintf(stderr, "usage: %s [-n samples] [--bridge path/to/wiimotebridged] [-v]\n", argv[0]);
+            return 1;
+        }
+    }
+    if (!samples)
+    {
+        return 1;
+    }
+
+    signal(SIGPIPE, SIG_IGN);
+    init_memory();
+
+    if (!start_bridge(bridge, &port, &pid))
+    {
+        return 1;
+    }
+    if (!wait_for_startup())
+    {
+        fprintf(stderr, "wiimotebridged did not finish the handshake\n");
+        kill(pid, SIGTERM);
+        return 1;
+    }
+    if (!map_shm())
+    {
+        kill(pid, SIGTERM);
+        return 1;
+    }
+
+    for (p = 0; p < PATH_COUNT; ++p)
+    {
+        lat[p] = (uint64_t *)malloc(samples * sizeof(uint64_t));
+        if (!lat[p])
+        {
+            return 1;
+        }
+
+        if (p == PATH_ORIENTATION)
+        {
+            /* orientation is only sent while B is held; pressing it rumbles */
+            press(BUTTON_B);
+        } else if (p == PATH_IR)
+        {
+            /* UP turns the IR camera on, wait for the IR report mode */
+            press(BUTTON_UP);
+            press(0);
+            if (report_mode != IN_BTN_ACC_IR_EXP)
+            {
+                fprintf(stderr, "wiimotebridged did not enable IR reports\n");
+            }
+        }
+
+        run_path((enum path_t)p, samples, lat[p], &count[p], &lost[p]);
+
+        if (p == PATH_ORIENTATION)
+        {
+            press(0);
+        }
+    }
+
+    /* closing the remote makes the bridge see a disconnect and exit */
+    close(remote_fd);
+    shm_unlink(shm_name);
+    for (i = 0; i < 200 && waitpid(pid, &status, WNOHANG) == 0; ++i)
+    {
+        usleep(10000);
+    }
+    if (i == 200)
+    {
+        kill(pid, SIGTERM);
+        waitpid(pid, &status, 0);
+    }
+
+    printf("{\n  \"benchmark\": \"wiiuse_latency\",\n  \"samples\": %u,\n  \"unit\": \"ns\",\n", samples);
+    printf("  \"results\": [\n");
+    for (p = 0; p < PATH_COUNT; ++p)
+    {
+        printf("    {\"path\": \"%s\", \"received\": %u, \"lost\": %u", path_names[p], count[p], lost[p]);
+        if (count[p])
+        {
+            printf(", \"min\": %llu, \"p50\": %llu, \"p99\": %llu, \"p99.9\": %llu, \"max\": %llu",
+                   (unsigned long long)lat[p][0], (unsigned long long)percentile(lat[p], count[p], 50.0),
+                   (unsigned long long)percentile(lat[p], count[p], 99.0),
+                   (unsigned long long)percentile(lat[p], count[p], 99.9),
+                   (unsigned long long)lat[p][count[p] - 1]);
+        }
+        printf("}%s\n", p + 1 < PATH_COUNT ? "," : "");
+        free(lat[p]);
+    }
+    printf("  ]\n}\n");
+
+    return 0;
+}
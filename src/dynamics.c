@@ -40,6 +40,138 @@
 #include <math.h>   /* for atan2f, atanf, sqrt */
 #include <stdlib.h> /* for abs */
 
+/*
+ *	atan(t) in degrees for t in [0, 1], sampled at ATAN_LUT_SIZE + 1 points
+ *	and linearly interpolated.  The interpolation error is at most
+ *	h^2 / 8 * max|atan''| = (1/256)^2 / 8 * 0.65 rad, about 7.1e-5 degrees,
+ *	so table based angles stay within 1e-4 degrees of atan2f().
+ */
+#define ATAN_LUT_SIZE 256
+
+static float g_atan_lut[ATAN_LUT_SIZE + 1];
+static int g_atan_lut_ready = 0;
+
+static float atan_unit_deg(float t)
+{
+    float f = t * ATAN_LUT_SIZE;
+    int i   = (int)f;
+
+    if (i >= ATAN_LUT_SIZE)
+    {
+        i = ATAN_LUT_SIZE - 1;
+    }
+    f -= (float)i;
+
+    return g_atan_lut[i] + f * (g_atan_lut[i + 1] - g_atan_lut[i]);
+}
+
+/*
+ *	atan2(y, x) in degrees from the table.  @a t must be min(|y|, |x|) / max(|y|, |x|),
+ *	which the caller computes from the reciprocal tables without a division.
+ */
+static float atan2_lut_deg(float y, float x, float t)
+{
+    float a = atan_unit_deg(t);
+
+    if (fabsf(y) > fabsf(x))
+    {
+        a = 90.0f - a;
+    }
+    if (x < 0.0f)
+    {
+        a = 180.0f - a;
+    }
+    return (y < 0.0f) ? -a : a;
+}
+
+static float clamp_unit(float v) { return (v < -1.0f) ? -1.0f : ((v > 1.0f) ? 1.0f : v); }
+
+/**
+ *	@brief Build the lookup tables for an accelerometer calibration.
+ *
+ *	@param ac			An accelerometer (accel_t) structure with cal_zero and cal_g set.
+ *	@param lut			[out] Storage for the tables, owned by the caller.
+ *
+ *	Call this whenever the calibration changes.  On success ac->lut points at
+ *	@a lut, and calculate_gforce() and calculate_orientation() read from it
+ *	instead of dividing each sample.  A calibration with a zero 1g value
+ *	leaves ac->lut NULL so those functions keep their exact float path.
+ */
+void accel_build_lut(struct accel_t *ac, struct accel_lut_t *lut)
+{
+    const byte zero[3] = {ac->cal_zero.x, ac->cal_zero.y, ac->cal_zero.z};
+    const byte one[3]  = {ac->cal_g.x, ac->cal_g.y, ac->cal_g.z};
+    int axis, raw;
+
+    ac->lut = NULL;
+
+    if (!lut || !one[0] || !one[1] || !one[2])
+    {
+        return;
+    }
+
+    if (!g_atan_lut_ready)
+    {
+        int i;
+        for (i = 0; i <= ATAN_LUT_SIZE; ++i)
+        {
+            g_atan_lut[i] = RAD_TO_DEGREE(atanf((float)i / ATAN_LUT_SIZE));
+        }
+        g_atan_lut_ready = 1;
+    }
+
+    for (axis = 0; axis < 3; ++axis)
+    {
+        for (raw = 0; raw < 256; ++raw)
+        {
+            /* same expression as the float path, so g-forces are bit-identical */
+            float g = ((float)raw - (float)zero[axis]) / (float)one[axis];
+            float u = fabsf(clamp_unit(g));
+
+            lut->g[axis][raw]   = g;
+            lut->rcp[axis][raw] = (u > 0.0f) ? 1.0f / u : 0.0f;
+        }
+    }
+
+    ac->lut = lut;
+}
+
+/*
+ *	Table driven calculate_orientation(): the tables replace the three
+ *	divisions, and the atan table replaces atan2f.  Pitch still takes one
+ *	square root for the length of the x/z vector.
+ */
+static void calculate_orientation_lut(const struct accel_lut_t *lut, struct vec3b_t *accel,
+                                      struct orient_t *orient)
+{
+    float gx = lut->g[0][accel->x];
+    float gy = lut->g[1][accel->y];
+    float gz = lut->g[2][accel->z];
+    float x  = clamp_unit(gx);
+    float y  = clamp_unit(gy);
+    float z  = clamp_unit(gz);
+
+    /* |g| <= 1 is exactly the abs(raw - cal_zero) <= cal_g test of the float path */
+    if (fabsf(gx) <= 1.0f)
+    {
+        float t    = (fabsf(x) <= fabsf(z)) ? fabsf(x) * lut->rcp[2][accel->z] : fabsf(z) * lut->rcp[0][accel->x];
+        float roll = atan2_lut_deg(x, z, t);
+
+        orient->roll   = roll;
+        orient->a_roll = roll;
+    }
+
+    if (fabsf(gy) <= 1.0f)
+    {
+        float r     = sqrtf(x * x + z * z);
+        float t     = (fabsf(y) <= r) ? ((r > 0.0f) ? fabsf(y) / r : 0.0f) : r * lut->rcp[1][accel->y];
+        float pitch = atan2_lut_deg(y, r, t);
+
+        orient->pitch   = pitch;
+        orient->a_pitch = pitch;
+    }
+}
+
 /**
  *	@brief Calculate the roll, pitch, yaw.
  *
@@ -68,6 +200,17 @@ void calculate_orientation(struct accel_t *ac, struct vec3b_t *accel, struct ori
     /* yaw - set to 0, IR will take care of it if it's enabled */
     orient->yaw = 0.0f;
 
+    if (ac->lut)
+    {
+        calculate_orientation_lut(ac->lut, accel, orient);
+        if (smooth)
+        {
+            apply_smoothing(ac, orient, SMOOTH_ROLL);
+            apply_smoothing(ac, orient, SMOOTH_PITCH);
+        }
+        return;
+    }
+
     /* find out how much it has to move to be 1g */
     xg = (float)ac->cal_g.x;
     yg = (float)ac->cal_g.y;
@@ -143,6 +286,14 @@ void calculate_gforce(struct accel_t *ac, struct vec3b_t *accel, struct gforce_t
 {
     float xg, yg, zg;
 
+    if (ac->lut)
+    {
+        gforce->x = ac->lut->g[0][accel->x];
+        gforce->y = ac->lut->g[1][accel->y];
+        gforce->z = ac->lut->g[2][accel->z];
+        return;
+    }
+
     /* find out how much it has to move to be 1g */
     xg = (float)ac->cal_g.x;
     yg = (float)ac->cal_g.y;
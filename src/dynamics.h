@@ -51,6 +51,8 @@ void calculate_orientation(struct accel_t *ac, struct vec3b_t *accel, struct ori
 void calculate_gforce(struct accel_t *ac, struct vec3b_t *accel, struct gforce_t *gforce);
 void calc_joystick_state(struct joystick_t *js, float x, float y);
 void apply_smoothing(struct accel_t *ac, struct orient_t *orient, int type);
+void accel_build_lut(struct accel_t *ac, struct accel_lut_t *lut);
+void accel_batch_scalar(const struct accel_t *ac, struct accel_batch_t *b);
 /** @} */
 
 #ifdef __cplusplus
@@ -0,0 +1,483 @@
+/*
+ *	wiiuse
+ *
+ *	Written By:
+ *		Melodea Research	< melodea-research/wiimote-bridge >
+ *
+ *	Copyright 2026
+ *
+ *	This file is part of wiiuse.
+ *
+ *	This program is free software; you can redistribute it and/or modify
+ *	it under the terms of the GNU General Public License as published by
+ *	the Free Software Foundation; either version 3 of the License, or
+ *	(at your option) any later version.
+ *
+ *	This program is distributed in the hope that it will be useful,
+ *	but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *	GNU General Public License for more details.
+ *
+ *	You should have received a copy of the GNU General Public License
+ *	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *	$Header$
+ *
+ */
+
+/**
+ *	@file
+ *	@brief Batched accelerometer dynamics.
+ *
+ *	Computes g-force, roll and pitch for a structure-of-arrays buffer of
+ *	raw accelerometer samples, e.g. a replayed capture.  There is a scalar
+ *	reference kernel and SSE2, AVX2 and NEON kernels; the fastest one the
+ *	CPU supports is picked on first use.
+ *
+ *	The vector kernels divide exactly like calculate_gforce(), so g-forces
+ *	match the scalar kernel bit for bit (on 32-bit ARM, which has no vector
+ *	divide, within a few ulp).  Angles use the polynomial atan of Abramowitz
+ *	and Stegun 4.4.49, whose error is below 1e-5 rad; with float rounding the
+ *	angles stay within 1e-3 degrees of the scalar kernel.
+ */
+
+#include "dynamics.h"
+
+#include <math.h>   /* for atan2f, fabsf, sqrtf */
+#include <string.h> /* for memcpy */
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define ACCEL_BATCH_X86
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h> /* for __cpuid, __cpuidex */
+#define ACCEL_BATCH_TARGET(isa)
+#else
+#define ACCEL_BATCH_TARGET(isa) __attribute__((target(isa)))
+#endif
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define ACCEL_BATCH_NEON
+#include <arm_neon.h>
+#endif
+
+#define DEG_PER_RAD (180.0f / WIIMOTE_PI)
+#define HALF_PI (WIIMOTE_PI / 2.0f)
+
+/* atan(t) ~ t * (A1 + A3 t^2 + A5 t^4 + A7 t^6 + A9 t^8) for 0 <= t <= 1 */
+#define ATAN_A1 0.9998660f
+#define ATAN_A3 -0.3302995f
+#define ATAN_A5 0.1801410f
+#define ATAN_A7 -0.0851330f
+#define ATAN_A9 0.0208351f
+
+typedef void (*accel_batch_kernel_t)(const struct accel_t *ac, struct accel_batch_t *b);
+
+static float clamp_unit(float v) { return (v < -1.0f) ? -1.0f : ((v > 1.0f) ? 1.0f : v); }
+
+/* one sample as calculate_gforce() and calculate_orientation() compute it */
+static void accel_batch_one(const struct accel_t *ac, struct accel_batch_t *b, unsigned int i)
+{
+    float gx = ((float)b->x[i] - (float)ac->cal_zero.x) / (float)ac->cal_g.x;
+    float gy = ((float)b->y[i] - (float)ac->cal_zero.y) / (float)ac->cal_g.y;
+    float gz = ((float)b->z[i] - (float)ac->cal_zero.z) / (float)ac->cal_g.z;
+    float x  = clamp_unit(gx);
+    float y  = clamp_unit(gy);
+    float z  = clamp_unit(gz);
+
+    b->gx[i]    = gx;
+    b->gy[i]    = gy;
+    b->gz[i]    = gz;
+    b->roll[i]  = RAD_TO_DEGREE(atan2f(x, z));
+    b->pitch[i] = RAD_TO_DEGREE(atan2f(y, sqrtf(x * x + z * z)));
+}
+
+/**
+ *	@brief Scalar reference kernel.
+ *
+ *	Fills every output for every sample, including the angles of samples
+ *	over 1g, which wiiuse_accel_batch() then replaces.  Exposed so the
+ *	vector kernels can be validated against it.
+ */
+void accel_batch_scalar(const struct accel_t *ac, struct accel_batch_t *b)
+{
+    unsigned int i;
+
+    for (i = 0; i < b->n; ++i)
+    {
+        accel_batch_one(ac, b, i);
+    }
+}
+
+#ifdef ACCEL_BATCH_X86
+
+ACCEL_BATCH_TARGET("sse2")
+static __m128 load4_u8(const byte *p)
+{
+    const __m128i zero = _mm_setzero_si128();
+    int v;
+    __m128i w;
+
+    memcpy(&v, p, sizeof(v));
+    w = _mm_cvtsi32_si128(v);
+    w = _mm_unpacklo_epi8(w, zero);
+    w = _mm_unpacklo_epi16(w, zero);
+    return _mm_cvtepi32_ps(w);
+}
+
+ACCEL_BATCH_TARGET("sse2")
+static __m128 select4(__m128 mask, __m128 a, __m128 b) { return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b)); }
+
+/* atan2(y, x) in degrees */
+ACCEL_BATCH_TARGET("sse2")
+static __m128 atan2_deg4(__m128 y, __m128 x)
+{
+    const __m128 sign = _mm_set1_ps(-0.0f);
+    __m128 ay         = _mm_andnot_ps(sign, y);
+    __m128 ax         = _mm_andnot_ps(sign, x);
+    __m128 t = _mm_div_ps(_mm_min_ps(ay, ax), _mm_max_ps(_mm_max_ps(ay, ax), _mm_set1_ps(1e-30f)));
+    __m128 t2 = _mm_mul_ps(t, t);
+    __m128 r  = _mm_set1_ps(ATAN_A9);
+
+    r = _mm_add_ps(_mm_mul_ps(r, t2), _mm_set1_ps(ATAN_A7));
+    r = _mm_add_ps(_mm_mul_ps(r, t2), _mm_set1_ps(ATAN_A5));
+    r = _mm_add_ps(_mm_mul_ps(r, t2), _mm_set1_ps(ATAN_A3));
+    r = _mm_add_ps(_mm_mul_ps(r, t2), _mm_set1_ps(ATAN_A1));
+    r = _mm_mul_ps(r, t);
+
+    r = select4(_mm_cmpgt_ps(ay, ax), _mm_sub_ps(_mm_set1_ps(HALF_PI), r), r);
+    r = select4(_mm_cmplt_ps(x, _mm_setzero_ps()), _mm_sub_ps(_mm_set1_ps(WIIMOTE_PI), r), r);
+    r = _mm_xor_ps(r, _mm_and_ps(_mm_cmplt_ps(y, _mm_setzero_ps()), sign));
+
+    return _mm_mul_ps(r, _mm_set1_ps(DEG_PER_RAD));
+}
+
+ACCEL_BATCH_TARGET("sse2")
+static void accel_batch_sse2(const struct accel_t *ac, struct accel_batch_t *b)
+{
+    const __m128 zx = _mm_set1_ps((float)ac->cal_zero.x), cx = _mm_set1_ps((float)ac->cal_g.x);
+    const __m128 zy = _mm_set1_ps((float)ac->cal_zero.y), cy = _mm_set1_ps((float)ac->cal_g.y);
+    const __m128 zz = _mm_set1_ps((float)ac->cal_zero.z), cz = _mm_set1_ps((float)ac->cal_g.z);
+    const __m128 lo = _mm_set1_ps(-1.0f), hi = _mm_set1_ps(1.0f);
+    unsigned int i = 0;
+
+    for (; i + 4 <= b->n; i += 4)
+    {
+        __m128 gx = _mm_div_ps(_mm_sub_ps(load4_u8(b->x + i), zx), cx);
+        __m128 gy = _mm_div_ps(_mm_sub_ps(load4_u8(b->y + i), zy), cy);
+        __m128 gz = _mm_div_ps(_mm_sub_ps(load4_u8(b->z + i), zz), cz);
+        __m128 x  = _mm_min_ps(_mm_max_ps(gx, lo), hi);
+        __m128 y  = _mm_min_ps(_mm_max_ps(gy, lo), hi);
+        __m128 z  = _mm_min_ps(_mm_max_ps(gz, lo), hi);
+        __m128 r  = _mm_sqrt_ps(_mm_add_ps(_mm_mul_ps(x, x), _mm_mul_ps(z, z)));
+
+        _mm_storeu_ps(b->gx + i, gx);
+        _mm_storeu_ps(b->gy + i, gy);
+        _mm_storeu_ps(b->gz + i, gz);
+        _mm_storeu_ps(b->roll + i, atan2_deg4(x, z));
+        _mm_storeu_ps(b->pitch + i, atan2_deg4(y, r));
+    }
+
+    for (; i < b->n; ++i)
+    {
+        accel_batch_one(ac, b, i);
+    }
+}
+
+ACCEL_BATCH_TARGET("avx2")
+static __m256 load8_u8(const byte *p)
+{
+    return _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i *)p)));
+}
+
+ACCEL_BATCH_TARGET("avx2")
+static __m256 atan2_deg8(__m256 y, __m256 x)
+{
+    const __m256 sign = _mm256_set1_ps(-0.0f);
+    const __m256 zero = _mm256_setzero_ps();
+    __m256 ay         = _mm256_andnot_ps(sign, y);
+    __m256 ax         = _mm256_andnot_ps(sign, x);
+    __m256 t =
+        _mm256_div_ps(_mm256_min_ps(ay, ax), _mm256_max_ps(_mm256_max_ps(ay, ax), _mm256_set1_ps(1e-30f)));
+    __m256 t2 = _mm256_mul_ps(t, t);
+    __m256 r  = _mm256_set1_ps(ATAN_A9);
+
+    r = _mm256_add_ps(_mm256_mul_ps(r, t2), _mm256_set1_ps(ATAN_A7));
+    r = _mm256_add_ps(_mm256_mul_ps(r, t2), _mm256_set1_ps(ATAN_A5));
+    r = _mm256_add_ps(_mm256_mul_ps(r, t2), _mm256_set1_ps(ATAN_A3));
+    r = _mm256_add_ps(_mm256_mul_ps(r, t2), _mm256_set1_ps(ATAN_A1));
+    r = _mm256_mul_ps(r, t);
+
+    r = _mm256_blendv_ps(r, _mm256_sub_ps(_mm256_set1_ps(HALF_PI), r), _mm256_cmp_ps(ay, ax, _CMP_GT_OQ));
+    r = _mm256_blendv_ps(r, _mm256_sub_ps(_mm256_set1_ps(WIIMOTE_PI), r), _mm256_cmp_ps(x, zero, _CMP_LT_OQ));
+    r = _mm256_xor_ps(r, _mm256_and_ps(_mm256_cmp_ps(y, zero, _CMP_LT_OQ), sign));
+
+    return _mm256_mul_ps(r, _mm256_set1_ps(DEG_PER_RAD));
+}
+
+ACCEL_BATCH_TARGET("avx2")
+static void accel_batch_avx2(const struct accel_t *ac, struct accel_batch_t *b)
+{
+    const __m256 zx = _mm256_set1_ps((float)ac->cal_zero.x), cx = _mm256_set1_ps((float)ac->cal_g.x);
+    const __m256 zy = _mm256_set1_ps((float)ac->cal_zero.y), cy = _mm256_set1_ps((float)ac->cal_g.y);
+    const __m256 zz = _mm256_set1_ps((float)ac->cal_zero.z), cz = _mm256_set1_ps((float)ac->cal_g.z);
+    const __m256 lo = _mm256_set1_ps(-1.0f), hi = _mm256_set1_ps(1.0f);
+    unsigned int i = 0;
+
+    for (; i + 8 <= b->n; i += 8)
+    {
+        __m256 gx = _mm256_div_ps(_mm256_sub_ps(load8_u8(b->x + i), zx), cx);
+        __m256 gy = _mm256_div_ps(_mm256_sub_ps(load8_u8(b->y + i), zy), cy);
+        __m256 gz = _mm256_div_ps(_mm256_sub_ps(load8_u8(b->z + i), zz), cz);
+        __m256 x  = _mm256_min_ps(_mm256_max_ps(gx, lo), hi);
+        __m256 y  = _mm256_min_ps(_mm256_max_ps(gy, lo), hi);
+        __m256 z  = _mm256_min_ps(_mm256_max_ps(gz, lo), hi);
+        __m256 r  = _mm256_sqrt_ps(_mm256_add_ps(_mm256_mul_ps(x, x), _mm256_mul_ps(z, z)));
+
+        _mm256_storeu_ps(b->gx + i, gx);
+        _mm256_storeu_ps(b->gy + i, gy);
+        _mm256_storeu_ps(b->gz + i, gz);
+        _mm256_storeu_ps(b->roll + i, atan2_deg8(x, z));
+        _mm256_storeu_ps(b->pitch + i, atan2_deg8(y, r));
+    }
+
+    for (; i < b->n; ++i)
+    {
+        accel_batch_one(ac, b, i);
+    }
+}
+
+#endif /* ACCEL_BATCH_X86 */
+
+#ifdef ACCEL_BATCH_NEON
+
+static float32x4_t div4(float32x4_t n, float32x4_t d)
+{
+#ifdef __aarch64__
+    return vdivq_f32(n, d);
+#else
+    /* reciprocal estimate and two Newton-Raphson steps */
+    float32x4_t r = vrecpeq_f32(d);
+    r             = vmulq_f32(vrecpsq_f32(d, r), r);
+    r             = vmulq_f32(vrecpsq_f32(d, r), r);
+    return vmulq_f32(n, r);
+#endif
+}
+
+static float32x4_t sqrt4(float32x4_t s)
+{
+#ifdef __aarch64__
+    return vsqrtq_f32(s);
+#else
+    float32x4_t e = vrsqrteq_f32(s);
+    e             = vmulq_f32(vrsqrtsq_f32(vmulq_f32(s, e), e), e);
+    e             = vmulq_f32(vrsqrtsq_f32(vmulq_f32(s, e), e), e);
+    /* s * 1/sqrt(s) is NaN for s == 0 */
+    return vbslq_f32(vceqq_f32(s, vdupq_n_f32(0.0f)), s, vmulq_f32(s, e));
+#endif
+}
+
+static float32x4_t atan2_deg_neon(float32x4_t y, float32x4_t x)
+{
+    const float32x4_t zero = vdupq_n_f32(0.0f);
+    float32x4_t ay         = vabsq_f32(y);
+    float32x4_t ax         = vabsq_f32(x);
+    float32x4_t t  = div4(vminq_f32(ay, ax), vmaxq_f32(vmaxq_f32(ay, ax), vdupq_n_f32(1e-30f)));
+    float32x4_t t2 = vmulq_f32(t, t);
+    float32x4_t r  = vdupq_n_f32(ATAN_A9);
+    uint32x4_t neg;
+
+    r = vmlaq_f32(vdupq_n_f32(ATAN_A7), r, t2);
+    r = vmlaq_f32(vdupq_n_f32(ATAN_A5), r, t2);
+    r = vmlaq_f32(vdupq_n_f32(ATAN_A3), r, t2);
+    r = vmlaq_f32(vdupq_n_f32(ATAN_A1), r, t2);
+    r = vmulq_f32(r, t);
+
+    r   = vbslq_f32(vcgtq_f32(ay, ax), vsubq_f32(vdupq_n_f32(HALF_PI), r), r);
+    r   = vbslq_f32(vcltq_f32(x, zero), vsubq_f32(vdupq_n_f32(WIIMOTE_PI), r), r);
+    neg = vcltq_f32(y, zero);
+    r   = vbslq_f32(neg, vnegq_f32(r), r);
+
+    return vmulq_f32(r, vdupq_n_f32(DEG_PER_RAD));
+}
+
+static void accel_batch_neon(const struct accel_t *ac, struct accel_batch_t *b)
+{
+    const float32x4_t zx = vdupq_n_f32((float)ac->cal_zero.x), cx = vdupq_n_f32((float)ac->cal_g.x);
+    const float32x4_t zy = vdupq_n_f32((float)ac->cal_zero.y), cy = vdupq_n_f32((float)ac->cal_g.y);
+    const float32x4_t zz = vdupq_n_f32((float)ac->cal_zero.z), cz = vdupq_n_f32((float)ac->cal_g.z);
+    const float32x4_t lo = vdupq_n_f32(-1.0f), hi = vdupq_n_f32(1.0f);
+    unsigned int i = 0;
+
+    for (; i + 8 <= b->n; i += 8)
+    {
+        uint16x8_t rx = vmovl_u8(vld1_u8(b->x + i));
+        uint16x8_t ry = vmovl_u8(vld1_u8(b->y + i));
+        uint16x8_t rz = vmovl_u8(vld1_u8(b->z + i));
+        int half;
+
+        for (half = 0; half < 2; ++half)
+        {
+            uint16x4_t hx = half ? vget_high_u16(rx) : vget_low_u16(rx);
+            uint16x4_t hy = half ? vget_high_u16(ry) : vget_low_u16(ry);
+            uint16x4_t hz = half ? vget_high_u16(rz) : vget_low_u16(rz);
+            unsigned int j = i + 4 * half;
+
+            float32x4_t gx = div4(vsubq_f32(vcvtq_f32_u32(vmovl_u16(hx)), zx), cx);
+            float32x4_t gy = div4(vsubq_f32(vcvtq_f32_u32(vmovl_u16(hy)), zy), cy);
+            float32x4_t gz = div4(vsubq_f32(vcvtq_f32_u32(vmovl_u16(hz)), zz), cz);
+            float32x4_t x  = vminq_f32(vmaxq_f32(gx, lo), hi);
+            float32x4_t y  = vminq_f32(vmaxq_f32(gy, lo), hi);
+            float32x4_t z  = vminq_f32(vmaxq_f32(gz, lo), hi);
+            float32x4_t r  = sqrt4(vmlaq_f32(vmulq_f32(x, x), z, z));
+
+            vst1q_f32(b->gx + j, gx);
+            vst1q_f32(b->gy + j, gy);
+            vst1q_f32(b->gz + j, gz);
+            vst1q_f32(b->roll + j, atan2_deg_neon(x, z));
+            vst1q_f32(b->pitch + j, atan2_deg_neon(y, r));
+        }
+    }
+
+    for (; i < b->n; ++i)
+    {
+        accel_batch_one(ac, b, i);
+    }
+}
+
+#endif /* ACCEL_BATCH_NEON */
+
+static accel_batch_kernel_t g_kernel = NULL;
+static const char *g_kernel_name     = "scalar";
+
+#if defined(ACCEL_BATCH_X86) && defined(_MSC_VER)
+static int cpu_has_avx2()
+{
+    int info[4];
+
+    __cpuid(info, 1);
+    /* AVX and OSXSAVE, and the OS saves the YMM registers */
+    if ((info[2] & (1 << 27)) == 0 || (info[2] & (1 << 28)) == 0 || (_xgetbv(0) & 6) != 6)
+    {
+        return 0;
+    }
+    __cpuidex(info, 7, 0);
+    return (info[1] & (1 << 5)) != 0;
+}
+
+static int cpu_has_sse2()
+{
+    int info[4];
+
+    __cpuid(info, 1);
+    return (info[3] & (1 << 26)) != 0;
+}
+#elif defined(ACCEL_BATCH_X86)
+static int cpu_has_avx2()
+{
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2");
+}
+
+static int cpu_has_sse2()
+{
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("sse2");
+}
+#endif
+
+static void select_kernel()
+{
+    g_kernel      = accel_batch_scalar;
+    g_kernel_name = "scalar";
+
+#if defined(ACCEL_BATCH_X86)
+    if (cpu_has_avx2())
+    {
+        g_kernel      = accel_batch_avx2;
+        g_kernel_name = "avx2";
+    } else if (cpu_has_sse2())
+    {
+        g_kernel      = accel_batch_sse2;
+        g_kernel_name = "sse2";
+    }
+#elif defined(ACCEL_BATCH_NEON)
+    /* built for NEON, so every CPU this runs on has it */
+    g_kernel      = accel_batch_neon;
+    g_kernel_name = "neon";
+#endif
+
+    WIIUSE_DEBUG("Using the %s accelerometer batch kernel.", g_kernel_name);
+}
+
+/**
+ *	@brief Name of the kernel wiiuse_accel_batch() uses on this CPU.
+ *
+ *	One of "scalar", "sse2", "avx2" or "neon".
+ */
+const char *wiiuse_accel_batch_kernel()
+{
+    if (!g_kernel)
+    {
+        select_kernel();
+    }
+    return g_kernel_name;
+}
+
+/**
+ *	@brief Calculate g-force, roll and pitch for a buffer of raw samples.
+ *
+ *	@param ac		An accelerometer (accel_t) structure with the calibration.
+ *	@param batch	The sample buffers, see accel_batch_t.
+ *	@param orient	[in/out] Orientation before the first sample, updated to
+ *					the orientation after the last one.  May be NULL.
+ *
+ *	Like calculate_orientation(), a sample whose x (y) axis reads more than
+ *	1g keeps the roll (pitch) of the sample before it; @a orient supplies
+ *	the angles before the first sample.  Smoothing is not applied.
+ */
+void wiiuse_accel_batch(const struct accel_t *ac, struct accel_batch_t *batch, struct orient_t *orient)
+{
+    float roll  = orient ? orient->a_roll : 0.0f;
+    float pitch = orient ? orient->a_pitch : 0.0f;
+    unsigned int i;
+
+    if (!ac || !batch || !batch->n)
+    {
+        return;
+    }
+
+    if (!g_kernel)
+    {
+        select_kernel();
+    }
+    g_kernel(ac, batch);
+
+    /* carry the last reliable angle over samples that read more than 1g */
+    for (i = 0; i < batch->n; ++i)
+    {
+        if (fabsf(batch->gx[i]) <= 1.0f)
+        {
+            roll = batch->roll[i];
+        } else
+        {
+            batch->roll[i] = roll;
+        }
+
+        if (fabsf(batch->gy[i]) <= 1.0f)
+        {
+            pitch = batch->pitch[i];
+        } else
+        {
+            batch->pitch[i] = pitch;
+        }
+    }
+
+    if (orient)
+    {
+        orient->roll    = roll;
+        orient->pitch   = pitch;
+        orient->yaw     = 0.0f;
+        orient->a_roll  = roll;
+        orient->a_pitch = pitch;
+    }
+}
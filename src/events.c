@@ -39,6 +39,8 @@
 
 #include "classic.h"       /* for classic_ctrl_disconnected, etc */
 #include "dynamics.h"      /* for calculate_gforce, etc */
+#include "filter.h"        /* for filter_channel */
+#include "fusion.h"        /* for fusion_update */
 #include "guitar_hero_3.h" /* for guitar_hero_3_disconnected, etc */
 #include "io.h"            /* for wiiuse_read_data_sync, etc */
 #include "ir.h"            /* for calculate_basic_ir, etc */
@@ -59,6 +61,7 @@ static void handle_expansion(struct wiimote_t *wm, byte *msg);
 
 static void save_state(struct wiimote_t *wm);
 static int state_changed(struct wiimote_t *wm);
+static int propagate_queued_reports(struct wiimote_t **wm, int wiimotes);
 
 /**
  *	@brief Poll the wiimotes for any events.
@@ -71,8 +74,72 @@ static int state_changed(struct wiimote_t *wm);
  *	It is necessary to poll the wiimote devices for events
  *	that occur.  If an event occurs on a particular wiimote,
  *	the event variable will be set.
+ *
+ *	Input that arrived during a synchronous operation (see
+ *	wiiuse_wait_report()) is delivered first, one report per wiimote per call.
+ *	Each call also plays the rumble patterns (see wiiuse_rumble_update()).
  */
-int wiiuse_poll(struct wiimote_t **wm, int wiimotes) { return wiiuse_os_poll(wm, wiimotes); }
+int wiiuse_poll(struct wiimote_t **wm, int wiimotes)
+{
+    int evnt;
+
+    /* switch the rumble motors that are due; this never waits */
+    wiiuse_rumble_update(wm, wiimotes);
+
+    evnt = propagate_queued_reports(wm, wiimotes);
+    if (evnt > 0)
+    {
+        return evnt;
+    }
+
+    return wiiuse_os_poll(wm, wiimotes);
+}
+
+/**
+ *	@brief Propagate the oldest queued report of each wiimote.
+ *
+ *	@param wm		An array of pointers to wiimote_t structures.
+ *	@param wiimotes	The number of wiimote_t structures in the \a wm array.
+ *
+ *	@return Returns number of wiimotes that an event has occurred on.
+ */
+static int propagate_queued_reports(struct wiimote_t **wm, int wiimotes)
+{
+    byte buf[MAX_PAYLOAD];
+    int queued = 0;
+    int evnt   = 0;
+    int i;
+
+    if (!wm)
+    {
+        return 0;
+    }
+
+    for (i = 0; i < wiimotes; ++i)
+    {
+        if (wm[i]->report_queue)
+        {
+            queued = 1;
+            break;
+        }
+    }
+    if (!queued)
+    {
+        return 0;
+    }
+
+    for (i = 0; i < wiimotes; ++i)
+    {
+        wm[i]->event = WIIUSE_NONE;
+        if (wiiuse_dequeue_report(wm[i], buf))
+        {
+            propagate_event(wm[i], buf[0], buf + 1);
+            evnt += (wm[i]->event != WIIUSE_NONE);
+        }
+    }
+
+    return evnt;
+}
 
 int wiiuse_update(struct wiimote_t **wiimotes, int nwiimotes, wiiuse_update_cb callback)
 {
@@ -96,6 +163,7 @@ int wiiuse_update(struct wiimote_t **wiimotes, int nwiimotes, wiiuse_update_cb c
                 s.orient           = wiimotes[i]->orient;
                 s.gforce           = wiimotes[i]->gforce;
                 s.ir               = wiimotes[i]->ir;
+                s.ir_pose          = wiimotes[i]->ir_pose;
                 s.buttons          = wiimotes[i]->btns;
                 s.buttons_held     = wiimotes[i]->btns_held;
                 s.buttons_released = wiimotes[i]->btns_released;
@@ -176,130 +244,194 @@ static void handle_wm_accel(struct wiimote_t *wm, byte *msg)
 
     /* calculate the gforces on each axis */
     calculate_gforce(&wm->accel_calib, &wm->accel, &wm->gforce);
+
+    filter_channel(wm, WIIUSE_FILTER_ORIENT);
+    filter_channel(wm, WIIUSE_FILTER_GFORCE);
 }
 
 /**
- *	@brief Analyze the event that occurred on a wiimote.
+ *	@brief Keep the first half (0x3e) of a full mode IR frame.
+ *
+ *	@param wm		Pointer to a wiimote_t structure.
+ *	@param msg		The message specified in the event packet.
+ */
+static void stash_interleaved(struct wiimote_t *wm, byte *msg)
+{
+    memcpy(wm->ir_half, msg, sizeof(wm->ir_half));
+    wm->ir_half_us    = wm->timestamp_us;
+    wm->ir_half_valid = 1;
+}
+
+/**
+ *	@brief Decode a full mode IR frame once its second half (0x3f) arrived.
  *
  *	@param wm		Pointer to a wiimote_t structure.
- *	@param event	The event that occurred.
  *	@param msg		The message specified in the event packet.
  *
- *	Pass the event to the registered event callback.
+ *	The frame takes the timestamp of its first half.  The accelerometer
+ *	is split over both halves: x and y in the accel byte of each, z in
+ *	the unused bits 5 and 6 of the button bytes.
  */
-void propagate_event(struct wiimote_t *wm, byte event, byte *msg)
+static void decode_interleaved(struct wiimote_t *wm, byte *msg)
 {
-    save_state(wm);
+    const byte *a = wm->ir_half;
+    byte accel[5];
 
-    switch (event)
+    if (!wm->ir_half_valid)
     {
-    case WM_RPT_BTN:
-    {
-        /* button */
-        wiiuse_pressed_buttons(wm, msg);
-        break;
+        /* lost the first half */
+        return;
     }
-    case WM_RPT_BTN_ACC:
-    {
-        /* button - motion */
-        wiiuse_pressed_buttons(wm, msg);
+    wm->ir_half_valid = 0;
+    wm->timestamp_us  = wm->ir_half_us;
 
-        handle_wm_accel(wm, msg);
+    accel[2] = a[2];
+    accel[3] = msg[2];
+    accel[4] = ((a[1] & 0x60) << 1) | ((a[0] & 0x60) >> 1) | ((msg[1] & 0x60) >> 3) | ((msg[0] & 0x60) >> 5);
+    handle_wm_accel(wm, accel);
 
-        break;
-    }
-    case WM_RPT_READ:
-    {
-        /* data read */
-        event_data_read(wm, msg);
+    calculate_full_ir(wm, a + 3, msg + 3);
+}
 
-        /* yeah buttons may be pressed, but this wasn't an "event" */
-        return;
+/*
+ * Layout of the data reports (0x30 - 0x3f).  Offsets are into msg, i.e. the
+ * report without its id byte:
+ *
+ *   X(id, name, buttons, accel, ir, ir offset, expansion, expansion offset)
+ *
+ * buttons, accel and expansion are 0 or 1, ir is NONE, BASIC, EXTENDED, FULL_A
+ * or FULL_B.
+ * Buttons always sit at msg[0..1] and accel at msg[2..4].  One decoder
+ * function per row is generated below, so the per-field checks are resolved
+ * at compile time.  Ids missing from the table (0x38 - 0x3c) are not defined
+ * by the hardware.
+ *
+ * 0x3e/0x3f carry interleaved halves of the full IR mode (FULL_A, FULL_B).
+ * The first half is kept until the second arrives, then the frame is decoded
+ * as a whole, see decode_interleaved().
+ */
+#define WIIUSE_DATA_REPORTS(X)                                                                           \
+    X(WM_RPT_BTN, btn, 1, 0, NONE, 0, 0, 0)                                                              \
+    X(WM_RPT_BTN_ACC, btn_acc, 1, 1, NONE, 0, 0, 0)                                                      \
+    X(WM_RPT_BTN_EXP_8, btn_exp_8, 1, 0, NONE, 0, 1, 2)                                                  \
+    X(WM_RPT_BTN_ACC_IR, btn_acc_ir, 1, 1, EXTENDED, 5, 0, 0)                                            \
+    X(WM_RPT_BTN_EXP, btn_exp, 1, 0, NONE, 0, 1, 2)                                                      \
+    X(WM_RPT_BTN_ACC_EXP, btn_acc_exp, 1, 1, NONE, 0, 1, 5)                                              \
+    X(WM_RPT_BTN_IR_EXP, btn_ir_exp, 1, 0, BASIC, 2, 1, 12)                                              \
+    X(WM_RPT_BTN_ACC_IR_EXP, btn_acc_ir_exp, 1, 1, BASIC, 5, 1, 15)                                      \
+    X(WM_RPT_EXP_21, exp_21, 0, 0, NONE, 0, 1, 0)                                                        \
+    X(WM_RPT_INTERLEAVED_A, interleaved_a, 1, 0, FULL_A, 0, 0, 0)                                        \
+    X(WM_RPT_INTERLEAVED_B, interleaved_b, 1, 0, FULL_B, 0, 0, 0)
+
+#define DECODE_IR_NONE(wm, data)
+#define DECODE_IR_BASIC(wm, data) calculate_basic_ir(wm, data)
+#define DECODE_IR_EXTENDED(wm, data) calculate_extended_ir(wm, data)
+#define DECODE_IR_FULL_A(wm, data) stash_interleaved(wm, data)
+#define DECODE_IR_FULL_B(wm, data) decode_interleaved(wm, data)
+
+/* the expansion is handled before the IR, as it always has been */
+#define DEFINE_REPORT_DECODER(id, name, btns, accel, ir, ir_off, exp, exp_off)                           \
+    static void decode_##name(struct wiimote_t *wm, byte *msg)                                           \
+    {                                                                                                    \
+        if (btns)                                                                                        \
+            wiiuse_pressed_buttons(wm, msg);                                                             \
+        if (accel)                                                                                       \
+            handle_wm_accel(wm, msg);                                                                    \
+        if (exp)                                                                                         \
+            handle_expansion(wm, msg + exp_off);                                                         \
+        DECODE_IR_##ir(wm, msg + ir_off);                                                                \
     }
-    case WM_RPT_CTRL_STATUS:
-    {
-        /* controller status */
-        event_status(wm, msg);
 
-        /* don't execute the event callback */
-        return;
-    }
-    case WM_RPT_BTN_EXP_8:
-    case WM_RPT_BTN_EXP:
-    {
-        /* button - expansion */
-        wiiuse_pressed_buttons(wm, msg);
-        handle_expansion(wm, msg + 2);
+WIIUSE_DATA_REPORTS(DEFINE_REPORT_DECODER)
 
-        break;
-    }
-    case WM_RPT_BTN_ACC_EXP:
-    {
-        /* button - motion - expansion */
-        wiiuse_pressed_buttons(wm, msg);
+typedef void (*report_decoder_t)(struct wiimote_t *wm, byte *msg);
 
-        handle_wm_accel(wm, msg);
+#define REPORT_DECODER_ENTRY(id, name, btns, accel, ir, ir_off, exp, exp_off) [(id)-WM_RPT_BTN] = decode_##name,
 
-        handle_expansion(wm, msg + 5);
+/** @brief Decoders for the data reports, indexed by report id - WM_RPT_BTN */
+static const report_decoder_t report_decoders[16] = {WIIUSE_DATA_REPORTS(REPORT_DECODER_ENTRY)};
 
-        break;
-    }
-    case WM_RPT_BTN_ACC_IR:
+/**
+ *	@brief Analyze the event that occurred on a wiimote.
+ *
+ *	@param wm		Pointer to a wiimote_t structure.
+ *	@param event	The event that occurred.
+ *	@param msg		The message specified in the event packet.
+ *
+ *	Pass the event to the registered event callback.
+ */
+void propagate_event(struct wiimote_t *wm, byte event, byte *msg)
+{
+    if ((event & 0xF0) == WM_RPT_BTN && WIIMOTE_IS_FLAG_SET(wm, WIIUSE_RAW_REPORTS))
     {
-        /* button - motion - ir */
-        wiiuse_pressed_buttons(wm, msg);
-
-        handle_wm_accel(wm, msg);
-
-        /* ir */
-        calculate_extended_ir(wm, msg + 5);
-
-        break;
+        /* decoded elsewhere, see wiiuse_decode_report(); only the buttons
+           are kept, for the application's own controls */
+        if (!wm->raw_report_len || wm->raw_report_len > WIIUSE_RAW_REPORT_LEN)
+        {
+            wm->raw_report_len = WIIUSE_RAW_REPORT_LEN;
+        }
+        wm->raw_report[0] = event;
+        memcpy(wm->raw_report + 1, msg, wm->raw_report_len - 1);
+        if (event != WM_RPT_EXP_21)
+        {
+            wiiuse_pressed_buttons(wm, msg);
+        }
+        wm->event = WIIUSE_EVENT;
+        return;
     }
-    case WM_RPT_BTN_IR_EXP:
-    {
-        /* button - ir - expansion */
-        wiiuse_pressed_buttons(wm, msg);
-        handle_expansion(wm, msg + 12);
 
-        /* ir */
-        calculate_basic_ir(wm, msg + 2);
+    save_state(wm);
 
-        break;
-    }
-    case WM_RPT_BTN_ACC_IR_EXP:
+    if ((event & 0xF0) == WM_RPT_BTN)
     {
-        /* button - motion - ir - expansion */
-        wiiuse_pressed_buttons(wm, msg);
-
-        handle_wm_accel(wm, msg);
-
-        handle_expansion(wm, msg + 15);
+        /* data report, see WIIUSE_DATA_REPORTS */
+        report_decoder_t decode = report_decoders[event & 0x0F];
+        if (!decode)
+        {
+            WIIUSE_WARNING("Undefined data report, can not handle it [Code 0x%x].", event);
+            return;
+        }
+        decode(wm, msg);
+    } else
+    {
+        switch (event)
+        {
+        case WM_RPT_READ:
+        {
+            /* data read */
+            event_data_read(wm, msg);
 
-        /* ir */
-        calculate_basic_ir(wm, msg + 5);
+            /* yeah buttons may be pressed, but this wasn't an "event" */
+            return;
+        }
+        case WM_RPT_CTRL_STATUS:
+        {
+            /* controller status */
+            event_status(wm, msg);
 
-        break;
-    }
+            /* don't execute the event callback */
+            return;
+        }
 
-    /*
-     * FIXME: this gets triggered only when the Wiimote sends 0x22
-     * Acknowledge output report, return function result. This is unfortunately sent only
-     * rarely, typically when there is an error (e.g. reading from an invalid address) and
-     * *must not* be relied on to call the write callbacks. The report can also appear unsolicited
-     * during synchronous handshake, where it would produce spurious error messages. That's why
-     * it is disabled.
-     */
-    case WM_RPT_WRITE:
-    {
-        /* event_data_write(wm, msg); */
-        break;
-    }
-    default:
-    {
-        WIIUSE_WARNING("Unknown event, can not handle it [Code 0x%x].", event);
-        return;
-    }
+        /*
+         * FIXME: this gets triggered only when the Wiimote sends 0x22
+         * Acknowledge output report, return function result. This is unfortunately sent only
+         * rarely, typically when there is an error (e.g. reading from an invalid address) and
+         * *must not* be relied on to call the write callbacks. The report can also appear unsolicited
+         * during synchronous handshake, where it would produce spurious error messages. That's why
+         * it is disabled.
+         */
+        case WM_RPT_WRITE:
+        {
+            /* event_data_write(wm, msg); */
+            break;
+        }
+        default:
+        {
+            WIIUSE_WARNING("Unknown event, can not handle it [Code 0x%x].", event);
+            return;
+        }
+        }
     }
 
     /* was there an event? */
@@ -659,20 +791,32 @@ static void handle_expansion(struct wiimote_t *wm, byte *msg)
     {
     case EXP_NUNCHUK:
         nunchuk_event(&wm->exp.nunchuk, msg);
+        filter_channel(wm, WIIUSE_FILTER_NUNCHUK_JS);
         break;
     case EXP_CLASSIC:
         classic_ctrl_event(&wm->exp.classic, msg);
+        filter_channel(wm, WIIUSE_FILTER_CLASSIC_LJS);
+        filter_channel(wm, WIIUSE_FILTER_CLASSIC_RJS);
         break;
     case EXP_GUITAR_HERO_3:
         guitar_hero_3_event(&wm->exp.gh3, msg);
         break;
     case EXP_WII_BOARD:
         wii_board_event(&wm->exp.wb, msg);
+        filter_channel(wm, WIIUSE_FILTER_WII_BOARD);
         break;
     case EXP_MOTION_PLUS:
     case EXP_MOTION_PLUS_CLASSIC:
     case EXP_MOTION_PLUS_NUNCHUK:
-        motion_plus_event(&wm->exp.mp, wm->exp.type, msg);
+        if (motion_plus_event(&wm->exp.mp, wm->exp.type, msg))
+        {
+            motion_plus_track_bias(wm);
+            filter_channel(wm, WIIUSE_FILTER_MOTION_PLUS);
+            fusion_update(wm);
+        } else if (wm->exp.type == EXP_MOTION_PLUS_NUNCHUK)
+        {
+            filter_channel(wm, WIIUSE_FILTER_NUNCHUK_JS);
+        }
         break;
     default:
         break;
@@ -0,0 +1,534 @@
+/*
+ *	wiiuse
+ *
+ *	Written By:
+ *		Melodea Research	< melodea-research/wiimote-bridge >
+ *
+ *	Copyright 2026
+ *
+ *	This file is part of wiiuse.
+ *
+ *	This program is free software; you can redistribute it and/or modify
+ *	it under the terms of the GNU General Public License as published by
+ *	the Free Software Foundation; either version 3 of the License, or
+ *	(at your option) any later version.
+ *
+ *	This program is distributed in the hope that it will be useful,
+ *	but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *	GNU General Public License for more details.
+ *
+ *	You should have received a copy of the GNU General Public License
+ *	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *	$Header$
+ *
+ */
+
+/**
+ *	@file
+ *	@brief Per-channel filter chains.
+ *
+ *	A filter chain runs a sample of up to WIIUSE_FILTER_MAX_DIM values
+ *	through up to WIIUSE_FILTER_MAX_STAGES stages, in the order they were
+ *	added.  The stages are:
+ *
+ *	- One Euro (G. Casiez, N. Roussel, D. Vogel 2012): a low pass whose
+ *	  cutoff rises with the speed of the signal, so it removes jitter at
+ *	  rest without lagging fast moves.
+ *	- EMA: fixed weight exponential moving average.
+ *	- Median of the last N samples, for single-report spikes.
+ *	- Deadband: holds the output until the input moves more than the
+ *	  dead zone away from it.
+ *
+ *	Chains attached with wiiuse_set_filter() run once per data report that
+ *	refreshes their channel, after the value was decoded and before the
+ *	event is generated, so thresholds and callbacks see filtered values.
+ */
+
+#include "filter.h"
+
+#include <math.h>   /* for fabsf, lroundf */
+#include <string.h> /* for memset */
+
+/* sample period assumed when the timestamps do not advance (100 Hz) */
+#define FILTER_DEFAULT_DT 0.01f
+
+enum filter_stage_type_t
+{
+    FILTER_ONE_EURO = 1,
+    FILTER_EMA,
+    FILTER_MEDIAN,
+    FILTER_DEADBAND
+};
+
+/** @brief Values per sample of each wiimote channel */
+static const unsigned int channel_dim[WIIUSE_FILTER_NUM_CHANNELS] = {
+    3, /* WIIUSE_FILTER_ORIENT */
+    3, /* WIIUSE_FILTER_GFORCE */
+    2, /* WIIUSE_FILTER_IR */
+    2, /* WIIUSE_FILTER_NUNCHUK_JS */
+    2, /* WIIUSE_FILTER_CLASSIC_LJS */
+    2, /* WIIUSE_FILTER_CLASSIC_RJS */
+    4, /* WIIUSE_FILTER_WII_BOARD */
+    3, /* WIIUSE_FILTER_MOTION_PLUS */
+};
+
+/* weight of the new sample of a first order low pass with cutoff fc (Hz) */
+static float low_pass_alpha(float dt, float fc)
+{
+    float tau = 1.0f / (2.0f * WIIMOTE_PI * fc);
+    return 1.0f / (1.0f + tau / dt);
+}
+
+/* wrap an angle difference to [-180, 180) */
+static float wrap_180(float a)
+{
+    return a - 360.0f * floorf((a + 180.0f) / 360.0f);
+}
+
+static float median_of(const float *v, unsigned int n)
+{
+    float s[WIIUSE_FILTER_MAX_MEDIAN];
+    unsigned int i, j;
+
+    /* insertion sort, n is at most 9 */
+    for (i = 0; i < n; ++i)
+    {
+        float x = v[i];
+        for (j = i; j > 0 && s[j - 1] > x; --j)
+        {
+            s[j] = s[j - 1];
+        }
+        s[j] = x;
+    }
+    return s[n / 2];
+}
+
+static void stage_update(struct filter_stage_t *st, unsigned int dim, int first, float dt, float *v)
+{
+    unsigned int i, k;
+
+    switch (st->type)
+    {
+    case FILTER_ONE_EURO:
+        for (i = 0; i < dim; ++i)
+        {
+            if (first)
+            {
+                st->one_euro.x[i]  = v[i];
+                st->one_euro.dx[i] = 0.0f;
+            } else
+            {
+                float dx = (v[i] - st->one_euro.x[i]) / dt;
+                float cutoff;
+
+                st->one_euro.dx[i] += low_pass_alpha(dt, st->one_euro.d_cutoff) * (dx - st->one_euro.dx[i]);
+                cutoff = st->one_euro.min_cutoff + st->one_euro.beta * fabsf(st->one_euro.dx[i]);
+                st->one_euro.x[i] += low_pass_alpha(dt, cutoff) * (v[i] - st->one_euro.x[i]);
+            }
+            v[i] = st->one_euro.x[i];
+        }
+        break;
+
+    case FILTER_EMA:
+        for (i = 0; i < dim; ++i)
+        {
+            if (first)
+            {
+                st->ema.y[i] = v[i];
+            } else
+            {
+                st->ema.y[i] += st->ema.alpha * (v[i] - st->ema.y[i]);
+            }
+            v[i] = st->ema.y[i];
+        }
+        break;
+
+    case FILTER_MEDIAN:
+        for (i = 0; i < dim; ++i)
+        {
+            if (first)
+            {
+                for (k = 0; k < st->median.n; ++k)
+                {
+                    st->median.hist[i][k] = v[i];
+                }
+            }
+            st->median.hist[i][st->median.head] = v[i];
+            v[i]                                = median_of(st->median.hist[i], st->median.n);
+        }
+        st->median.head = (st->median.head + 1) % st->median.n;
+        break;
+
+    case FILTER_DEADBAND:
+        for (i = 0; i < dim; ++i)
+        {
+            float d = v[i] - st->deadband.y[i];
+
+            if (first)
+            {
+                st->deadband.y[i] = v[i];
+            } else if (d > st->deadband.width)
+            {
+                st->deadband.y[i] = v[i] - st->deadband.width;
+            } else if (d < -st->deadband.width)
+            {
+                st->deadband.y[i] = v[i] + st->deadband.width;
+            }
+            v[i] = st->deadband.y[i];
+        }
+        break;
+
+    default:
+        break;
+    }
+}
+
+static struct filter_stage_t *add_stage(struct filter_chain_t *fc, int type)
+{
+    struct filter_stage_t *st;
+
+    if (!fc)
+    {
+        return NULL;
+    }
+    if (fc->num_stages >= WIIUSE_FILTER_MAX_STAGES)
+    {
+        WIIUSE_ERROR("Filter chain already has %i stages.", WIIUSE_FILTER_MAX_STAGES);
+        return NULL;
+    }
+
+    st = &fc->stage[fc->num_stages++];
+    memset(st, 0, sizeof(*st));
+    st->type   = type;
+    fc->primed = 0;
+    return st;
+}
+
+/**
+ *	@brief Set up an empty filter chain.
+ *
+ *	@param fc		Pointer to a filter_chain_t structure.
+ *	@param dim		Values per sample, 1 to WIIUSE_FILTER_MAX_DIM.
+ *
+ *	An empty chain passes samples through unchanged.
+ */
+void wiiuse_filter_init(struct filter_chain_t *fc, unsigned int dim)
+{
+    if (!fc)
+    {
+        return;
+    }
+
+    memset(fc, 0, sizeof(*fc));
+    if (dim == 0 || dim > WIIUSE_FILTER_MAX_DIM)
+    {
+        WIIUSE_ERROR("Filter chain dimension %u out of range, using %i.", dim, WIIUSE_FILTER_MAX_DIM);
+        dim = WIIUSE_FILTER_MAX_DIM;
+    }
+    fc->dim = dim;
+}
+
+/**
+ *	@brief Forget the history of a filter chain.
+ *
+ *	@param fc		Pointer to a filter_chain_t structure.
+ *
+ *	The next sample passes through unchanged and restarts every stage.
+ */
+void wiiuse_filter_reset(struct filter_chain_t *fc)
+{
+    if (fc)
+    {
+        fc->primed  = 0;
+        fc->last_us = 0;
+    }
+}
+
+/**
+ *	@brief Append a One Euro stage.
+ *
+ *	@param fc			Pointer to a filter_chain_t structure.
+ *	@param min_cutoff	Cutoff frequency at rest in Hz, lower removes more jitter.
+ *	@param beta			Cutoff increase per unit/s of speed, higher lags less.
+ *	@param d_cutoff		Cutoff of the speed estimate in Hz, 1 is usually fine.
+ *
+ *	@return 1 on success, 0 if the chain is full or a parameter is invalid.
+ */
+int wiiuse_filter_add_one_euro(struct filter_chain_t *fc, float min_cutoff, float beta, float d_cutoff)
+{
+    struct filter_stage_t *st;
+
+    if (min_cutoff <= 0.0f || d_cutoff <= 0.0f || beta < 0.0f)
+    {
+        WIIUSE_ERROR("Invalid One Euro filter parameters.");
+        return 0;
+    }
+    if (!(st = add_stage(fc, FILTER_ONE_EURO)))
+    {
+        return 0;
+    }
+
+    st->one_euro.min_cutoff = min_cutoff;
+    st->one_euro.beta       = beta;
+    st->one_euro.d_cutoff   = d_cutoff;
+    return 1;
+}
+
+/**
+ *	@brief Append an exponential moving average stage.
+ *
+ *	@param fc		Pointer to a filter_chain_t structure.
+ *	@param alpha	Weight of the new sample, (0, 1].  1 passes samples through.
+ *
+ *	@return 1 on success, 0 if the chain is full or \a alpha is invalid.
+ */
+int wiiuse_filter_add_ema(struct filter_chain_t *fc, float alpha)
+{
+    struct filter_stage_t *st;
+
+    if (alpha <= 0.0f || alpha > 1.0f)
+    {
+        WIIUSE_ERROR("Invalid EMA filter alpha %f.", alpha);
+        return 0;
+    }
+    if (!(st = add_stage(fc, FILTER_EMA)))
+    {
+        return 0;
+    }
+
+    st->ema.alpha = alpha;
+    return 1;
+}
+
+/**
+ *	@brief Append a median stage.
+ *
+ *	@param fc		Pointer to a filter_chain_t structure.
+ *	@param n		Window length, odd and at most WIIUSE_FILTER_MAX_MEDIAN.
+ *
+ *	@return 1 on success, 0 if the chain is full or \a n is invalid.
+ *
+ *	Delays the signal by (n - 1) / 2 samples.
+ */
+int wiiuse_filter_add_median(struct filter_chain_t *fc, unsigned int n)
+{
+    struct filter_stage_t *st;
+
+    if (n == 0 || n > WIIUSE_FILTER_MAX_MEDIAN || !(n & 1))
+    {
+        WIIUSE_ERROR("Invalid median filter length %u.", n);
+        return 0;
+    }
+    if (!(st = add_stage(fc, FILTER_MEDIAN)))
+    {
+        return 0;
+    }
+
+    st->median.n = n;
+    return 1;
+}
+
+/**
+ *	@brief Append a deadband stage.
+ *
+ *	@param fc		Pointer to a filter_chain_t structure.
+ *	@param width	How far the input may move from the output before the
+ *					output follows, in the units of the channel.
+ *
+ *	@return 1 on success, 0 if the chain is full or \a width is negative.
+ */
+int wiiuse_filter_add_deadband(struct filter_chain_t *fc, float width)
+{
+    struct filter_stage_t *st;
+
+    if (width < 0.0f)
+    {
+        WIIUSE_ERROR("Invalid deadband width %f.", width);
+        return 0;
+    }
+    if (!(st = add_stage(fc, FILTER_DEADBAND)))
+    {
+        return 0;
+    }
+
+    st->deadband.width = width;
+    return 1;
+}
+
+/**
+ *	@brief Run one sample through a filter chain.
+ *
+ *	@param fc			Pointer to a filter_chain_t structure.
+ *	@param in			fc->dim input values.
+ *	@param out			[out] fc->dim filtered values, may be \a in.
+ *	@param timestamp_us	Time of the sample in microseconds, e.g.
+ *						wiimote_t.timestamp_us.  0 assumes 100 Hz.
+ */
+void wiiuse_filter_update(struct filter_chain_t *fc, const float *in, float *out, uint64_t timestamp_us)
+{
+    float v[WIIUSE_FILTER_MAX_DIM];
+    float dt = FILTER_DEFAULT_DT;
+    int first;
+    unsigned int i;
+
+    if (!fc)
+    {
+        return;
+    }
+
+    first = !fc->primed;
+    if (!first && fc->last_us && timestamp_us > fc->last_us)
+    {
+        dt = (float)(timestamp_us - fc->last_us) * 1e-6f;
+    }
+    fc->last_us = timestamp_us;
+    fc->primed  = 1;
+
+    for (i = 0; i < fc->dim; ++i)
+    {
+        v[i] = in[i];
+    }
+    for (i = 0; i < fc->num_stages; ++i)
+    {
+        stage_update(&fc->stage[i], fc->dim, first, dt, v);
+    }
+    for (i = 0; i < fc->dim; ++i)
+    {
+        fc->out[i] = v[i];
+        out[i]     = v[i];
+    }
+}
+
+/**
+ *	@brief Attach a filter chain to a wiimote channel.
+ *
+ *	@param wm		Pointer to a wiimote_t structure.
+ *	@param channel	The channel to filter.
+ *	@param fc		Pointer to a filter_chain_t structure, or NULL to detach.
+ *					Its dimension must match the channel (see filter_channel_t).
+ *
+ *	@return 1 on success, 0 on failure.
+ *
+ *	The chain is not copied and must outlive the attachment.  It is reset
+ *	here and whenever its channel stops reporting (IR out of view).  Angles
+ *	on WIIUSE_FILTER_ORIENT are filtered across the +-180 degree wrap; turn
+ *	off WIIUSE_SMOOTHING when filtering it to avoid smoothing twice.
+ */
+int wiiuse_set_filter(struct wiimote_t *wm, enum filter_channel_t channel, struct filter_chain_t *fc)
+{
+    if (!wm || channel < 0 || channel >= WIIUSE_FILTER_NUM_CHANNELS)
+    {
+        return 0;
+    }
+    if (fc && fc->dim != channel_dim[channel])
+    {
+        WIIUSE_ERROR("Filter chain has %u values, channel %i needs %u.", fc->dim, channel, channel_dim[channel]);
+        return 0;
+    }
+
+    wiiuse_filter_reset(fc);
+    wm->filters[channel] = fc;
+    return 1;
+}
+
+/**
+ *	@brief Run the chain attached to a channel over its freshly decoded values.
+ *
+ *	@param wm		Pointer to a wiimote_t structure.
+ *	@param channel	The channel that was just decoded.
+ */
+void filter_channel(struct wiimote_t *wm, enum filter_channel_t channel)
+{
+    struct filter_chain_t *fc = wm->filters[channel];
+    float v[WIIUSE_FILTER_MAX_DIM];
+    unsigned int i;
+
+    if (!fc)
+    {
+        return;
+    }
+
+    switch (channel)
+    {
+    case WIIUSE_FILTER_ORIENT:
+    {
+        float *a[3] = {&wm->orient.roll, &wm->orient.pitch, &wm->orient.yaw};
+
+        /* unwrap against the previous output so +-180 is not a jump */
+        for (i = 0; i < 3; ++i)
+        {
+            v[i] = fc->primed ? fc->out[i] + wrap_180(*a[i] - fc->out[i]) : *a[i];
+        }
+        wiiuse_filter_update(fc, v, v, wm->timestamp_us);
+        for (i = 0; i < 3; ++i)
+        {
+            *a[i] = wrap_180(v[i]);
+        }
+        return;
+    }
+    case WIIUSE_FILTER_GFORCE:
+        v[0] = wm->gforce.x;
+        v[1] = wm->gforce.y;
+        v[2] = wm->gforce.z;
+        wiiuse_filter_update(fc, v, v, wm->timestamp_us);
+        wm->gforce.x = v[0];
+        wm->gforce.y = v[1];
+        wm->gforce.z = v[2];
+        return;
+
+    case WIIUSE_FILTER_IR:
+        if (!wm->ir.num_dots && !wm->ir.coasting)
+        {
+            wiiuse_filter_reset(fc);
+            return;
+        }
+        v[0] = (float)wm->ir.x;
+        v[1] = (float)wm->ir.y;
+        wiiuse_filter_update(fc, v, v, wm->timestamp_us);
+        wm->ir.x = (int)lroundf(v[0]);
+        wm->ir.y = (int)lroundf(v[1]);
+        return;
+
+    case WIIUSE_FILTER_NUNCHUK_JS:
+    case WIIUSE_FILTER_CLASSIC_LJS:
+    case WIIUSE_FILTER_CLASSIC_RJS:
+    {
+        struct joystick_t *js = (channel == WIIUSE_FILTER_NUNCHUK_JS)
+                                    ? &wm->exp.nunchuk.js
+                                    : (channel == WIIUSE_FILTER_CLASSIC_LJS) ? &wm->exp.classic.ljs
+                                                                             : &wm->exp.classic.rjs;
+        v[0] = js->x;
+        v[1] = js->y;
+        wiiuse_filter_update(fc, v, v, wm->timestamp_us);
+        js->x = v[0];
+        js->y = v[1];
+        return;
+    }
+    case WIIUSE_FILTER_WII_BOARD:
+        v[0] = wm->exp.wb.tl;
+        v[1] = wm->exp.wb.tr;
+        v[2] = wm->exp.wb.bl;
+        v[3] = wm->exp.wb.br;
+        wiiuse_filter_update(fc, v, v, wm->timestamp_us);
+        wm->exp.wb.tl = v[0];
+        wm->exp.wb.tr = v[1];
+        wm->exp.wb.bl = v[2];
+        wm->exp.wb.br = v[3];
+        return;
+
+    case WIIUSE_FILTER_MOTION_PLUS:
+        v[0] = wm->exp.mp.angle_rate_gyro.roll;
+        v[1] = wm->exp.mp.angle_rate_gyro.pitch;
+        v[2] = wm->exp.mp.angle_rate_gyro.yaw;
+        wiiuse_filter_update(fc, v, v, wm->timestamp_us);
+        wm->exp.mp.angle_rate_gyro.roll  = v[0];
+        wm->exp.mp.angle_rate_gyro.pitch = v[1];
+        wm->exp.mp.angle_rate_gyro.yaw   = v[2];
+        return;
+
+    default:
+        return;
+    }
+}
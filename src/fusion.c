@@ -0,0 +1,261 @@
+/*
+ *	wiiuse
+ *
+ *	Written By:
+ *		Melodea Research	< melodea-research/wiimote-bridge >
+ *
+ *	Copyright 2026
+ *
+ *	This file is part of wiiuse.
+ *
+ *	This program is free software; you can redistribute it and/or modify
+ *	it under the terms of the GNU General Public License as published by
+ *	the Free Software Foundation; either version 3 of the License, or
+ *	(at your option) any later version.
+ *
+ *	This program is distributed in the hope that it will be useful,
+ *	but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *	GNU General Public License for more details.
+ *
+ *	You should have received a copy of the GNU General Public License
+ *	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *	$Header$
+ *
+ */
+
+/**
+ *	@file
+ *	@brief Motion Plus sensor fusion.
+ *
+ *	Fuses the Motion Plus angle rates with the wiimote accelerometer into
+ *	an orientation quaternion, using Madgwick's gradient descent filter
+ *	(IMU variant, S. Madgwick 2010).  The gyro is integrated over the real
+ *	time between reports; the accelerometer pulls roll and pitch towards
+ *	gravity at a rate set by wiiuse_set_fusion_gain().  Yaw has no absolute
+ *	reference and drifts slowly.
+ *
+ *	Body axes are those of the accelerometer.  The gyro rates are mapped so
+ *	that a positive rate grows the matching calculate_orientation() angle:
+ *	x = pitch, y = -roll, z = yaw.
+ */
+
+#include "fusion.h"
+
+#include <math.h> /* for atan2f, fabsf, sqrtf */
+
+/* report period assumed when the timestamps do not advance (100 Hz) */
+#define FUSION_DEFAULT_DT 0.01f
+
+/* longer gaps (lost reports, paused polling) are integrated as this long */
+#define FUSION_MAX_DT 0.1f
+
+/* the accelerometer only corrects the attitude while it reads close to 1g */
+#define FUSION_MIN_G 0.7f
+#define FUSION_MAX_G 1.3f
+
+static float inv_sqrt(float v) { return 1.0f / sqrtf(v); }
+
+/* gravity ("up") in the wiimote frame for the current quaternion */
+static void fusion_gravity(const struct quat_t *q, float *vx, float *vy, float *vz)
+{
+    *vx = 2.0f * (q->x * q->z - q->w * q->y);
+    *vy = 2.0f * (q->y * q->z + q->w * q->x);
+    *vz = q->w * q->w - q->x * q->x - q->y * q->y + q->z * q->z;
+}
+
+/* the quaternion that puts the measured gravity straight up */
+static void fusion_align(struct quat_t *q, float ax, float ay, float az)
+{
+    float n = ax * ax + ay * ay + az * az;
+
+    if (n <= 0.0f)
+    {
+        q->w = 1.0f;
+        q->x = q->y = q->z = 0.0f;
+        return;
+    }
+
+    n = inv_sqrt(n);
+    ax *= n;
+    ay *= n;
+    az *= n;
+
+    if (az < -0.9999f)
+    {
+        /* upside down, half a turn about x */
+        q->w = 0.0f;
+        q->x = 1.0f;
+        q->y = q->z = 0.0f;
+        return;
+    }
+
+    /* shortest arc from the measured gravity to the earth z axis */
+    q->w = 1.0f + az;
+    q->x = ay;
+    q->y = -ax;
+    q->z = 0.0f;
+
+    n = inv_sqrt(q->w * q->w + q->x * q->x + q->y * q->y);
+    q->w *= n;
+    q->x *= n;
+    q->y *= n;
+}
+
+/**
+ *	@brief Restart the fusion, e.g. after the gyro was recalibrated.
+ *
+ *	@param mp		Pointer to a motion_plus_t structure.
+ *
+ *	The next gyro frame aligns the quaternion with gravity again.
+ */
+void fusion_reset(struct motion_plus_t *mp)
+{
+    mp->quat.w = mp->quat.x = mp->quat.y = mp->quat.z = 0.0f;
+    mp->linear_accel.x = mp->linear_accel.y = mp->linear_accel.z = 0.0f;
+    mp->fusion_time_us = 0;
+}
+
+/**
+ *	@brief Fuse the latest Motion Plus gyro frame with the accelerometer.
+ *
+ *	@param wm		Pointer to a wiimote_t structure with Motion Plus.
+ *
+ *	Called for every gyro frame, after the accelerometer of the same report
+ *	was decoded.  Updates exp.mp.quat, exp.mp.orient (degrees, roll and
+ *	pitch as calculate_orientation() defines them) and exp.mp.linear_accel.
+ */
+void fusion_update(struct wiimote_t *wm)
+{
+    struct motion_plus_t *mp = &wm->exp.mp;
+    struct quat_t *q         = &mp->quat;
+    int use_acc              = WIIUSE_USING_ACC(wm);
+    float ax = wm->gforce.x, ay = wm->gforce.y, az = wm->gforce.z;
+    float gx, gy, gz, dt, norm, vx, vy, vz;
+    float q0, q1, q2, q3, qd0, qd1, qd2, qd3;
+
+    if (q->w == 0.0f && q->x == 0.0f && q->y == 0.0f && q->z == 0.0f)
+    {
+        if (use_acc)
+        {
+            fusion_align(q, ax, ay, az);
+        } else
+        {
+            q->w = 1.0f;
+        }
+        dt = 0.0f;
+    } else if (wm->timestamp_us > mp->fusion_time_us && mp->fusion_time_us)
+    {
+        dt = (float)(wm->timestamp_us - mp->fusion_time_us) * 1e-6f;
+        if (dt > FUSION_MAX_DT)
+        {
+            dt = FUSION_MAX_DT;
+        }
+    } else
+    {
+        dt = FUSION_DEFAULT_DT;
+    }
+    mp->fusion_time_us = wm->timestamp_us;
+
+    gx = DEGREE_TO_RAD(mp->angle_rate_gyro.pitch);
+    gy = -DEGREE_TO_RAD(mp->angle_rate_gyro.roll);
+    gz = DEGREE_TO_RAD(mp->angle_rate_gyro.yaw);
+
+    q0 = q->w;
+    q1 = q->x;
+    q2 = q->y;
+    q3 = q->z;
+
+    /* rate of change of the quaternion from the gyro */
+    qd0 = 0.5f * (-q1 * gx - q2 * gy - q3 * gz);
+    qd1 = 0.5f * (q0 * gx + q2 * gz - q3 * gy);
+    qd2 = 0.5f * (q0 * gy - q1 * gz + q3 * gx);
+    qd3 = 0.5f * (q0 * gz + q1 * gy - q2 * gx);
+
+    norm = ax * ax + ay * ay + az * az;
+    if (use_acc && wm->fusion_gain > 0.0f && norm > FUSION_MIN_G * FUSION_MIN_G
+        && norm < FUSION_MAX_G * FUSION_MAX_G)
+    {
+        float s0, s1, s2, s3;
+        float _2q0 = 2.0f * q0, _2q1 = 2.0f * q1, _2q2 = 2.0f * q2, _2q3 = 2.0f * q3;
+        float _4q0 = 4.0f * q0, _4q1 = 4.0f * q1, _4q2 = 4.0f * q2;
+        float _8q1 = 8.0f * q1, _8q2 = 8.0f * q2;
+        float q0q0 = q0 * q0, q1q1 = q1 * q1, q2q2 = q2 * q2, q3q3 = q3 * q3;
+
+        norm = inv_sqrt(norm);
+        ax *= norm;
+        ay *= norm;
+        az *= norm;
+
+        /* gradient of the error between the estimated and measured gravity */
+        s0 = _4q0 * q2q2 + _2q2 * ax + _4q0 * q1q1 - _2q1 * ay;
+        s1 = _4q1 * q3q3 - _2q3 * ax + 4.0f * q0q0 * q1 - _2q0 * ay - _4q1 + _8q1 * q1q1 + _8q1 * q2q2 + _4q1 * az;
+        s2 = 4.0f * q0q0 * q2 + _2q0 * ax + _4q2 * q3q3 - _2q3 * ay - _4q2 + _8q2 * q1q1 + _8q2 * q2q2 + _4q2 * az;
+        s3 = 4.0f * q1q1 * q3 - _2q1 * ax + 4.0f * q2q2 * q3 - _2q2 * ay;
+
+        norm = s0 * s0 + s1 * s1 + s2 * s2 + s3 * s3;
+        if (norm > 0.0f)
+        {
+            norm = inv_sqrt(norm);
+            qd0 -= wm->fusion_gain * s0 * norm;
+            qd1 -= wm->fusion_gain * s1 * norm;
+            qd2 -= wm->fusion_gain * s2 * norm;
+            qd3 -= wm->fusion_gain * s3 * norm;
+        }
+    }
+
+    q0 += qd0 * dt;
+    q1 += qd1 * dt;
+    q2 += qd2 * dt;
+    q3 += qd3 * dt;
+
+    norm = inv_sqrt(q0 * q0 + q1 * q1 + q2 * q2 + q3 * q3);
+    q->w = q0 * norm;
+    q->x = q1 * norm;
+    q->y = q2 * norm;
+    q->z = q3 * norm;
+
+    fusion_gravity(q, &vx, &vy, &vz);
+
+    mp->orient.roll    = RAD_TO_DEGREE(atan2f(vx, vz));
+    mp->orient.pitch   = RAD_TO_DEGREE(atan2f(vy, sqrtf(vx * vx + vz * vz)));
+    mp->orient.yaw     = RAD_TO_DEGREE(atan2f(2.0f * (q->w * q->z + q->x * q->y),
+                                               1.0f - 2.0f * (q->y * q->y + q->z * q->z)));
+    mp->orient.a_roll  = mp->orient.roll;
+    mp->orient.a_pitch = mp->orient.pitch;
+
+    if (use_acc)
+    {
+        mp->linear_accel.x = wm->gforce.x - vx;
+        mp->linear_accel.y = wm->gforce.y - vy;
+        mp->linear_accel.z = wm->gforce.z - vz;
+    }
+}
+
+/**
+ *	@brief Set how strongly the accelerometer corrects the Motion Plus fusion.
+ *
+ *	@param wm		Pointer to a wiimote_t structure.
+ *	@param gain		Madgwick beta in rad/s.  0 integrates the gyro alone;
+ *					larger values follow the accelerometer faster but let
+ *					linear acceleration tilt the estimate.
+ *
+ *	@return Returns the old gain.
+ *
+ *	The default is WIIUSE_DEFAULT_FUSION_GAIN (0.1).
+ */
+float wiiuse_set_fusion_gain(struct wiimote_t *wm, float gain)
+{
+    float old;
+
+    if (!wm)
+    {
+        return 0.0f;
+    }
+
+    old             = wm->fusion_gain;
+    wm->fusion_gain = (gain > 0.0f) ? gain : 0.0f;
+
+    return old;
+}
@@ -0,0 +1,52 @@
+/*
+ *	wiiuse
+ *
+ *	Written By:
+ *		Melodea Research	< melodea-research/wiimote-bridge >
+ *
+ *	Copyright 2026
+ *
+ *	This file is part of wiiuse.
+ *
+ *	This program is free software; you can redistribute it and/or modify
+ *	it under the terms of the GNU General Public License as published by
+ *	the Free Software Foundation; either version 3 of the License, or
+ *	(at your option) any later version.
+ *
+ *	This program is distributed in the hope that it will be useful,
+ *	but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *	GNU General Public License for more details.
+ *
+ *	You should have received a copy of the GNU General Public License
+ *	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *	$Header$
+ *
+ */
+
+/**
+ *	@file
+ *	@brief Motion Plus sensor fusion.
+ */
+
+#ifndef FUSION_H_INCLUDED
+#define FUSION_H_INCLUDED
+
+#include "wiiuse_internal.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** @defgroup internal_fusion Internal: Sensor Fusion */
+/** @{ */
+void fusion_update(struct wiimote_t *wm);
+void fusion_reset(struct motion_plus_t *mp);
+/** @} */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* FUSION_H_INCLUDED */
@@ -0,0 +1,248 @@
+/*
+ *	wiiuse
+ *
+ *	Written By:
+ *		Melodea Research	< melodea-research/wiimote-bridge >
+ *
+ *	Copyright 2026
+ *
+ *	This file is part of wiiuse.
+ *
+ *	This program is free software; you can redistribute it and/or modify
+ *	it under the terms of the GNU General Public License as published by
+ *	the Free Software Foundation; either version 3 of the License, or
+ *	(at your option) any later version.
+ *
+ *	This program is distributed in the hope that it will be useful,
+ *	but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *	GNU General Public License for more details.
+ *
+ *	You should have received a copy of the GNU General Public License
+ *	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *	$Header$
+ *
+ */
+
+/**
+ *	@file
+ *	@brief Rumble patterns played without blocking.
+ *
+ *	Each remote has a queue of timed steps.  wiiuse_rumble_update(), which
+ *	wiiuse_poll() calls every time, switches the rumble bit whenever a step
+ *	ends or its duty cycle calls for it, so the caller never sleeps to time
+ *	a pulse.  Intensities below 1 switch the motor on for that fraction of
+ *	every HAPTICS_PWM_PERIOD_US.
+ */
+
+#include "wiiuse_internal.h"
+
+#include "os.h" /* for wiiuse_os_ticks_us */
+
+/**
+ *	@brief Drive the rumble bit, sending a report only when it changes.
+ */
+static void set_motor(struct wiimote_t *wm, int on)
+{
+    if (!on != !WIIMOTE_IS_SET(wm, WIIMOTE_STATE_RUMBLE))
+    {
+        wiiuse_rumble(wm, on);
+    }
+}
+
+/**
+ *	@brief Advance the pattern of one remote to \a now.
+ */
+static void haptics_update(struct wiimote_t *wm, uint64_t now)
+{
+    struct haptics_t *h = wm->haptics;
+
+    while (h->count && now >= h->next_us)
+    {
+        const struct rumble_step_t *step = &h->steps[h->head];
+        uint64_t end;
+        int on;
+
+        if (!h->start_us)
+        {
+            h->start_us = now;
+        }
+        end = h->start_us + (uint64_t)step->duration_ms * 1000;
+
+        if (now >= end)
+        {
+            /* the next step starts where this one ended, so patterns do not drift */
+            h->head     = (h->head + 1) % WIIUSE_RUMBLE_QUEUE_LEN;
+            h->start_us = --h->count ? end : 0;
+            h->next_us  = 0;
+            continue;
+        }
+
+        if (step->intensity >= 1.0f || step->intensity <= 0.0f)
+        {
+            on         = step->intensity > 0.0f;
+            h->next_us = end;
+        } else
+        {
+            uint64_t on_us = (uint64_t)(step->intensity * HAPTICS_PWM_PERIOD_US);
+            uint64_t phase = (now - h->start_us) % HAPTICS_PWM_PERIOD_US;
+
+            on         = phase < on_us;
+            h->next_us = now + (on ? on_us : HAPTICS_PWM_PERIOD_US) - phase;
+            if (h->next_us > end)
+            {
+                h->next_us = end;
+            }
+        }
+        set_motor(wm, on);
+        return;
+    }
+
+    if (!h->count)
+    {
+        set_motor(wm, 0);
+        h->next_us = 0;
+    }
+}
+
+/**
+ *	@brief Queue a rumble pattern.
+ *
+ *	@param wm		Pointer to a wiimote_t structure.
+ *	@param steps	Steps to play one after the other.
+ *	@param count	Number of steps.
+ *
+ *	@return The number of steps queued, fewer than \a count if the queue
+ *	(WIIUSE_RUMBLE_QUEUE_LEN steps) filled up, -1 if not connected.
+ *
+ *	The steps play after those already queued.  The pattern advances with
+ *	wiiuse_poll(), or wiiuse_rumble_update() for callers that do not poll.
+ */
+int wiiuse_rumble_pattern(struct wiimote_t *wm, const struct rumble_step_t *steps, int count)
+{
+    struct haptics_t *h;
+    int i;
+
+    if (!wm || !WIIMOTE_IS_CONNECTED(wm))
+    {
+        return -1;
+    }
+
+    h = wm->haptics;
+    for (i = 0; i < count && h->count < WIIUSE_RUMBLE_QUEUE_LEN; ++i)
+    {
+        h->steps[(h->head + h->count) % WIIUSE_RUMBLE_QUEUE_LEN] = steps[i];
+        h->count++;
+    }
+    if (i < count)
+    {
+        WIIUSE_WARNING("Rumble queue full, dropped %i steps [id %i].", count - i, wm->unid);
+    }
+
+    /* start right away rather than at the next poll */
+    haptics_update(wm, wiiuse_os_ticks_us());
+    return i;
+}
+
+/**
+ *	@brief Queue a single rumble pulse.
+ *
+ *	@param wm			Pointer to a wiimote_t structure.
+ *	@param duration_ms	Length of the pulse.
+ *	@param intensity	0 to 1, see rumble_step_t.
+ *
+ *	@return 1 if queued, 0 if the queue is full, -1 if not connected.
+ */
+int wiiuse_rumble_pulse(struct wiimote_t *wm, unsigned int duration_ms, float intensity)
+{
+    struct rumble_step_t step;
+
+    step.duration_ms = duration_ms;
+    step.intensity   = intensity;
+    return wiiuse_rumble_pattern(wm, &step, 1);
+}
+
+/**
+ *	@brief Drop the queued rumble pattern and stop the motor.
+ *
+ *	@param wm		Pointer to a wiimote_t structure.
+ */
+void wiiuse_rumble_stop(struct wiimote_t *wm)
+{
+    if (!wm)
+    {
+        return;
+    }
+
+    wm->haptics->count    = 0;
+    wm->haptics->start_us = 0;
+    wm->haptics->next_us  = 0;
+    set_motor(wm, 0);
+}
+
+/**
+ *	@brief Play the rumble patterns of several remotes up to now.
+ *
+ *	@param wm		An array of pointers to wiimote_t structures.
+ *	@param wiimotes	The number of wiimote_t structures in the \a wm array.
+ *
+ *	Called by wiiuse_poll().  Only switches motors whose time has come,
+ *	so it is cheap to call often.
+ */
+void wiiuse_rumble_update(struct wiimote_t **wm, int wiimotes)
+{
+    uint64_t now = 0;
+    int i;
+
+    if (!wm)
+    {
+        return;
+    }
+
+    for (i = 0; i < wiimotes; ++i)
+    {
+        if (!wm[i]->haptics->count || !WIIMOTE_IS_CONNECTED(wm[i]))
+        {
+            continue;
+        }
+        if (!now)
+        {
+            now = wiiuse_os_ticks_us();
+        }
+        haptics_update(wm[i], now);
+    }
+}
+
+/**
+ *	@brief When the rumble patterns next need wiiuse_rumble_update().
+ *
+ *	@param wm		An array of pointers to wiimote_t structures.
+ *	@param wiimotes	The number of wiimote_t structures in the \a wm array.
+ *
+ *	@return The earliest time, on the wiiuse_os_ticks_us() clock like
+ *	wiimote_t.timestamp_us, at which a motor must switch, or 0 if no
+ *	pattern is playing.  A loop that waits on its own should wake up by
+ *	then.
+ */
+uint64_t wiiuse_rumble_deadline(struct wiimote_t **wm, int wiimotes)
+{
+    uint64_t deadline = 0;
+    int i;
+
+    if (!wm)
+    {
+        return 0;
+    }
+
+    for (i = 0; i < wiimotes; ++i)
+    {
+        const struct haptics_t *h = wm[i]->haptics;
+
+        if (h->count && WIIMOTE_IS_CONNECTED(wm[i]) && (!deadline || h->next_us < deadline))
+        {
+            deadline = h->next_us;
+        }
+    }
+    return deadline;
+}
@@ -32,13 +32,15 @@
  */
 
 #include "io.h"
-#include "events.h" /* for propagate_event */
-#include "ir.h"     /* for wiiuse_set_ir_mode */
+#include "dynamics.h" /* for accel_build_lut */
+#include "events.h"   /* for propagate_event */
+#include "ir.h"       /* for wiiuse_set_ir_mode */
 #include "wiiuse_internal.h"
 
 #include "os.h" /* for wiiuse_os_* */
 
 #include <stdlib.h> /* for free, malloc */
+#include <string.h> /* for memcpy, memcmp, memset */
 
 /**
  *  @brief Find a wiimote or wiimotes.
@@ -107,6 +109,116 @@ int wiiuse_connect(struct wiimote_t **wm, int wiimotes) { return wiiuse_os_conne
  */
 void wiiuse_disconnect(struct wiimote_t *wm) { wiiuse_os_disconnect(wm); }
 
+/**
+ *  @brief Keep an input report for the next call to wiiuse_poll().
+ *
+ *  @param wm     Pointer to a wiimote_t structure.
+ *  @param buf    The report, buf[0] being the report id.
+ *  @param len    Length of the report in bytes, as read.
+ *
+ *  A report identical to the newest queued one only repeats known state and
+ *  is not stored again.  If the queue is full the oldest report is dropped.
+ */
+static void wiiuse_queue_report(struct wiimote_t *wm, const byte *buf, int len)
+{
+    struct queued_report_t *rpt;
+    struct queued_report_t *tail = NULL;
+    int count                    = 0;
+
+    if (len > MAX_PAYLOAD)
+    {
+        len = MAX_PAYLOAD;
+    }
+
+    for (rpt = wm->report_queue; rpt; rpt = rpt->next)
+    {
+        tail = rpt;
+        ++count;
+    }
+
+    if (tail && tail->len == len && !memcmp(tail->data, buf, len))
+    {
+        return;
+    }
+
+    if (count >= WIIUSE_MAX_QUEUED_REPORTS)
+    {
+        /* reuse the oldest entry as the new tail */
+        rpt              = wm->report_queue;
+        wm->report_queue = rpt->next;
+        WIIUSE_DEBUG("(id %i) report queue full, dropping report 0x%x", wm->unid, rpt->data[0]);
+        if (!wm->report_queue)
+        {
+            tail = NULL;
+        }
+    } else
+    {
+        rpt = (struct queued_report_t *)malloc(sizeof(struct queued_report_t));
+        if (!rpt)
+        {
+            return;
+        }
+    }
+
+    memset(rpt->data, 0, sizeof(rpt->data));
+    memcpy(rpt->data, buf, len);
+    rpt->len          = (byte)len;
+    rpt->timestamp_us = wiiuse_os_ticks_us();
+    rpt->next         = NULL;
+
+    if (tail)
+    {
+        tail->next = rpt;
+    } else
+    {
+        wm->report_queue = rpt;
+    }
+}
+
+/**
+ *  @brief Take the oldest report queued by wiiuse_wait_report().
+ *
+ *  Sets wm->timestamp_us to the time the report was received, and
+ *  wm->raw_report_len to its length.
+ *
+ *  @param wm     Pointer to a wiimote_t structure.
+ *  @param buf    Buffer of at least MAX_PAYLOAD bytes to receive the report.
+ *
+ *  @return 1 if a report was copied to \a buf, 0 if the queue was empty.
+ */
+int wiiuse_dequeue_report(struct wiimote_t *wm, byte *buf)
+{
+    struct queued_report_t *rpt = wm->report_queue;
+
+    if (!rpt)
+    {
+        return 0;
+    }
+
+    memcpy(buf, rpt->data, MAX_PAYLOAD);
+    wm->raw_report_len = rpt->len;
+    wm->timestamp_us   = rpt->timestamp_us;
+    wm->report_queue = rpt->next;
+    free(rpt);
+
+    return 1;
+}
+
+/**
+ *  @brief Discard every report queued by wiiuse_wait_report().
+ *
+ *  @param wm     Pointer to a wiimote_t structure.
+ */
+void wiiuse_flush_report_queue(struct wiimote_t *wm)
+{
+    while (wm->report_queue)
+    {
+        struct queued_report_t *rpt = wm->report_queue;
+        wm->report_queue            = rpt->next;
+        free(rpt);
+    }
+}
+
 /**
 *    @brief Wait until specified report arrives and return it
 *
@@ -116,7 +228,12 @@ void wiiuse_disconnect(struct wiimote_t *wm) { wiiuse_os_disconnect(wm); }
 *    @param timeout_ms     timeout in ms, 0 = wait forever
 *
 *    Synchronous/blocking, this function will not return until it receives the specified
-*    report from the Wiimote or timeout occurs.
+*    report from the Wiimote or timeout occurs.  The thread sleeps in
+*    wiiuse_os_wait() until data arrives or the deadline passes.
+*
+*    Input reports (0x30 and up) arriving in the meantime are queued and handed
+*    out by the next wiiuse_poll() instead of being dropped.  Stray replies to
+*    other requests (status, read, write acknowledgements) are still discarded.
 *
 *    Returns 1 on success, -1 on failure.
 *
@@ -124,37 +241,55 @@ void wiiuse_disconnect(struct wiimote_t *wm) { wiiuse_os_disconnect(wm); }
 int wiiuse_wait_report(struct wiimote_t *wm, int report, byte *buffer, int bufferLength,
                        unsigned long timeout_ms)
 {
-
-    int result            = 1;
-    unsigned long elapsed = 0;
-    unsigned long start   = wiiuse_os_ticks();
+    unsigned long start = wiiuse_os_ticks();
+    unsigned long elapsed;
+    unsigned long remaining = 0;
+    int rc;
 
     for (;;)
     {
-        if (wiiuse_os_read(wm, buffer, bufferLength) > 0)
+        if (timeout_ms > 0)
+        {
+            /* unsigned difference, safe across a wrap of the tick counter */
+            elapsed = wiiuse_os_ticks() - start;
+            if (elapsed >= timeout_ms)
+            {
+                return -1;
+            }
+            remaining = timeout_ms - elapsed;
+        }
+
+        rc = wiiuse_os_wait(wm, remaining);
+        if (rc < 0)
+        {
+            return -1;
+        }
+        if (rc == 0)
+        {
+            /* timed out, the deadline check above will tell */
+            continue;
+        }
+
+        rc = wiiuse_os_read(wm, buffer, bufferLength);
+        if (rc > 0)
         {
             if (buffer[0] == report)
             {
-                break;
+                return 1;
+            }
+
+            if (buffer[0] >= WM_RPT_BTN)
+            {
+                wiiuse_queue_report(wm, buffer, rc);
             } else
             {
-                if (buffer[0] != 0x30) /* hack for chatty devices spamming the button report */
-                {
-                    WIIUSE_DEBUG("(id %i) dropping report 0x%x, waiting for 0x%x", wm->unid, buffer[0],
-                                 report);
-                }
+                WIIUSE_DEBUG("(id %i) dropping report 0x%x, waiting for 0x%x", wm->unid, buffer[0], report);
             }
-        }
-
-        elapsed = wiiuse_os_ticks() - start;
-        if (elapsed > timeout_ms && timeout_ms > 0)
+        } else if (!WIIMOTE_IS_CONNECTED(wm))
         {
-            result = -1;
-            break;
+            return -1;
         }
     }
-
-    return result;
 }
 
 /**
@@ -297,6 +432,7 @@ void wiiuse_handshake(struct wiimote_t *wm, byte *data, uint16_t len)
         accel->cal_g.x = buf[4] - accel->cal_zero.x;
         accel->cal_g.y = buf[5] - accel->cal_zero.y;
         accel->cal_g.z = buf[6] - accel->cal_zero.z;
+        accel_build_lut(accel, wm->accel_lut);
 
         WIIUSE_DEBUG("Calibrated wiimote acc\n");
     }
@@ -390,6 +526,7 @@ void wiiuse_handshake(struct wiimote_t *wm, byte *data, uint16_t len)
         accel->cal_g.x = req->buf[4] - accel->cal_zero.x;
         accel->cal_g.y = req->buf[5] - accel->cal_zero.y;
         accel->cal_g.z = req->buf[6] - accel->cal_zero.z;
+        accel_build_lut(accel, wm->accel_lut);
 
         /* done with the buffer */
         free(req->buf);
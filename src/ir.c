@@ -32,14 +32,17 @@
  */
 
 #include "ir.h"
+#include "filter.h"     /* for filter_channel */
+#include "ir_pose.h"    /* for ir_pose_update */
+#include "ir_tracker.h" /* for ir_track_dots, etc */
 
 #include <math.h> /* for atanf, cos, sin, sqrt */
 
 static int get_ir_sens(struct wiimote_t *wm, const byte **block1, const byte **block2);
 static void interpret_ir_data(struct wiimote_t *wm);
+static void apply_tracked_ir(struct wiimote_t *wm);
 static void fix_rotated_ir_dots(struct ir_dot_t *dot, float ang);
 static void get_ir_dot_avg(struct ir_dot_t *dot, int *x, int *y);
-static void reorder_ir_dots(struct ir_dot_t *dot);
 static float ir_distance(struct ir_dot_t *dot);
 static int ir_correct_for_bounds(int *x, int *y, enum aspect_t aspect, int offset_x, int offset_y);
 static void ir_convert_to_vres(int *x, int *y, enum aspect_t aspect, int vx, int vy);
@@ -56,6 +59,19 @@ static const byte WM_IR_BLOCK2_LEVEL4[] = "\x35\x03";
 static const byte WM_IR_BLOCK1_LEVEL5[] = "\x07\x00\x00\x71\x01\x00\x72\x00\x20";
 static const byte WM_IR_BLOCK2_LEVEL5[] = "\x1f\x03";
 
+/**
+ *	@brief	The IR camera mode to use: full if requested, else basic when
+ *			the report has to make room for the expansion, else extended.
+ */
+static byte get_ir_mode(struct wiimote_t *wm)
+{
+    if (WIIMOTE_IS_SET(wm, WIIMOTE_STATE_IR_FULL))
+    {
+        return WM_IR_TYPE_FULL;
+    }
+    return WIIMOTE_IS_SET(wm, WIIMOTE_STATE_EXP) ? WM_IR_TYPE_BASIC : WM_IR_TYPE_EXTENDED;
+}
+
 void wiiuse_set_ir_mode(struct wiimote_t *wm)
 {
     byte buf = 0x00;
@@ -69,14 +85,47 @@ void wiiuse_set_ir_mode(struct wiimote_t *wm)
         return;
     }
 
-    if (WIIMOTE_IS_SET(wm, WIIMOTE_STATE_EXP))
+    buf = get_ir_mode(wm);
+    wiiuse_write_data(wm, WM_REG_IR_MODENUM, &buf, 1);
+}
+
+/**
+ *	@brief	Set if the IR camera should report in full mode.
+ *
+ *	@param wm		Pointer to a wiimote_t structure.
+ *	@param status	1 to enable, 0 to disable.
+ *
+ *	Full mode reports all four dots with their size, bounding box and
+ *	intensity, split over two interleaved reports (0x3e and 0x3f) that are
+ *	reassembled into one frame.  These reports carry no expansion data, so
+ *	expansion events stop while full mode and the camera are on.  The
+ *	accelerometer still reports, with the same resolution as in the other
+ *	modes.  Takes effect immediately if the camera is on, else when
+ *	wiiuse_set_ir() turns it on.
+ */
+void wiiuse_set_ir_full(struct wiimote_t *wm, int status)
+{
+    if (!wm)
+    {
+        return;
+    }
+
+    if (status)
     {
-        buf = WM_IR_TYPE_BASIC;
+        WIIMOTE_ENABLE_STATE(wm, WIIMOTE_STATE_IR_FULL);
     } else
     {
-        buf = WM_IR_TYPE_EXTENDED;
+        WIIMOTE_DISABLE_STATE(wm, WIIMOTE_STATE_IR_FULL);
     }
-    wiiuse_write_data(wm, WM_REG_IR_MODENUM, &buf, 1);
+    wm->ir_half_valid = 0;
+
+    if (WIIMOTE_IS_SET(wm, WIIMOTE_STATE_IR))
+    {
+        wiiuse_set_ir_mode(wm);
+        wiiuse_set_report_type(wm);
+    }
+
+    WIIUSE_DEBUG("%s full IR mode for wiimote id %i.", status ? "Enabled" : "Disabled", wm->unid);
 }
 /**
  *	@brief	Set if the wiimote should track IR targets.
@@ -148,6 +197,8 @@ void wiiuse_set_ir(struct wiimote_t *wm, int status)
     if (!status)
     {
         WIIUSE_DEBUG("Disabled IR cameras for wiimote id %i.", wm->unid);
+        ir_tracker_reset(wm);
+        wm->ir_half_valid = 0;
         wiiuse_set_report_type(wm);
         return;
     }
@@ -164,13 +215,7 @@ void wiiuse_set_ir(struct wiimote_t *wm, int status)
     wiiuse_write_data(wm, WM_REG_IR_BLOCK2, (byte *)block2, 2);
 
     /* set the IR mode */
-    if (WIIMOTE_IS_SET(wm, WIIMOTE_STATE_EXP))
-    {
-        buf = WM_IR_TYPE_BASIC;
-    } else
-    {
-        buf = WM_IR_TYPE_EXTENDED;
-    }
+    buf = get_ir_mode(wm);
     wiiuse_write_data(wm, WM_REG_IR_MODENUM, &buf, 1);
 
     wiiuse_millisleep(50);
@@ -414,9 +459,16 @@ void calculate_basic_ir(struct wiimote_t *wm, byte *data)
             dot[i].visible = 1;
             dot[i].size    = 0; /* since we don't know the size, set it as 0 */
         }
+        dot[i].xmin = dot[i].ymin = dot[i].xmax = dot[i].ymax = dot[i].intensity = 0;
     }
 
     interpret_ir_data(wm);
+    ir_pose_update(wm);
+    if (ir_tracker_update(wm))
+    {
+        apply_tracked_ir(wm);
+    }
+    filter_channel(wm, WIIUSE_FILTER_IR);
 }
 
 /**
@@ -436,6 +488,7 @@ void calculate_extended_ir(struct wiimote_t *wm, byte *data)
         dot[i].ry = data[(3 * i) + 1] | ((data[(3 * i) + 2] & 0xC0) << 2);
 
         dot[i].size = data[(3 * i) + 2] & 0x0F;
+        dot[i].xmin = dot[i].ymin = dot[i].xmax = dot[i].ymax = dot[i].intensity = 0;
 
         /* if in range set to visible */
         if (dot[i].ry == 1023)
@@ -448,6 +501,54 @@ void calculate_extended_ir(struct wiimote_t *wm, byte *data)
     }
 
     interpret_ir_data(wm);
+    ir_pose_update(wm);
+    if (ir_tracker_update(wm))
+    {
+        apply_tracked_ir(wm);
+    }
+    filter_channel(wm, WIIUSE_FILTER_IR);
+}
+
+/**
+ *	@brief Calculate the data from the IR spots.  Full IR mode.
+ *
+ *	@param wm		Pointer to a wiimote_t structure.
+ *	@param first	IR data of the 0x3e report, dots 0 and 1.
+ *	@param second	IR data of the 0x3f report, dots 2 and 3.
+ *
+ *	Each dot takes 9 bytes: the extended mode triple, then the bounding
+ *	box, a reserved byte and the intensity.
+ */
+void calculate_full_ir(struct wiimote_t *wm, const byte *first, const byte *second)
+{
+    struct ir_dot_t *dot = wm->ir.dot;
+    int i;
+
+    for (i = 0; i < 4; ++i)
+    {
+        const byte *d = (i < 2 ? first : second) + 9 * (i & 1);
+
+        dot[i].rx = 1023 - (d[0] | ((d[2] & 0x30) << 4));
+        dot[i].ry = d[1] | ((d[2] & 0xC0) << 2);
+
+        dot[i].size      = d[2] & 0x0F;
+        dot[i].xmin      = d[3] & 0x7F;
+        dot[i].ymin      = d[4] & 0x7F;
+        dot[i].xmax      = d[5] & 0x7F;
+        dot[i].ymax      = d[6] & 0x7F;
+        dot[i].intensity = d[8];
+
+        /* if in range set to visible */
+        dot[i].visible = (dot[i].ry != 1023);
+    }
+
+    interpret_ir_data(wm);
+    ir_pose_update(wm);
+    if (ir_tracker_update(wm))
+    {
+        apply_tracked_ir(wm);
+    }
+    filter_channel(wm, WIIUSE_FILTER_IR);
 }
 
 /**
@@ -459,14 +560,18 @@ static void interpret_ir_data(struct wiimote_t *wm)
 {
     struct ir_dot_t *dot = wm->ir.dot;
     int i;
-    float roll        = 0.0f;
-    int last_num_dots = wm->ir.num_dots;
+    float roll = 0.0f;
+    int reordered;
 
     if (WIIMOTE_IS_SET(wm, WIIMOTE_STATE_ACC))
     {
         roll = wm->orient.roll;
     }
 
+    /* match the dots with the previous report, drop reflections */
+    fix_rotated_ir_dots(wm->ir.dot, roll);
+    reordered = ir_track_dots(wm);
+
     /* count visible dots */
     wm->ir.num_dots = 0;
     for (i = 0; i < 4; ++i)
@@ -497,8 +602,6 @@ static void interpret_ir_data(struct wiimote_t *wm)
     }
     case 1:
     {
-        fix_rotated_ir_dots(wm->ir.dot, roll);
-
         if (wm->ir.state < 2)
         {
             /*
@@ -577,12 +680,9 @@ static void interpret_ir_data(struct wiimote_t *wm)
         int x, y;
         wm->ir.state = 2;
 
-        fix_rotated_ir_dots(wm->ir.dot, roll);
-
-        /* if there is at least 1 new dot, reorder them all */
-        if (wm->ir.num_dots > last_num_dots)
+        /* if there is a new dot they were reordered */
+        if (reordered)
         {
-            reorder_ir_dots(dot);
             wm->ir.x = 0;
             wm->ir.y = 0;
         }
@@ -628,6 +728,29 @@ static void interpret_ir_data(struct wiimote_t *wm)
 #endif
 }
 
+/**
+ *	@brief Derive the cursor and yaw from a tracked ir.ax, ir.ay and ir.z.
+ *
+ *	@param wm		Pointer to a wiimote_t structure.
+ */
+static void apply_tracked_ir(struct wiimote_t *wm)
+{
+    int x = wm->ir.ax;
+    int y = wm->ir.ay;
+
+    if (wm->ir.z > 0.0f)
+    {
+        wm->orient.yaw = calc_yaw(&wm->ir);
+    }
+
+    if (ir_correct_for_bounds(&x, &y, wm->ir.aspect, wm->ir.offset[0], wm->ir.offset[1]))
+    {
+        ir_convert_to_vres(&x, &y, wm->ir.aspect, wm->ir.vres[0], wm->ir.vres[1]);
+        wm->ir.x = x;
+        wm->ir.y = y;
+    }
+}
+
 /**
  *	@brief Fix the rotation of the IR dots.
  *
@@ -712,43 +835,6 @@ static void get_ir_dot_avg(struct ir_dot_t *dot, int *x, int *y)
     *y /= vis;
 }
 
-/**
- *	@brief Reorder the IR dots.
- *
- *	@param dot		An array of 4 ir_dot_t objects.
- */
-static void reorder_ir_dots(struct ir_dot_t *dot)
-{
-    int i, j, order;
-
-    /* reset the dot ordering */
-    for (i = 0; i < 4; ++i)
-    {
-        dot[i].order = 0;
-    }
-
-    for (order = 1; order < 5; ++order)
-    {
-        i = 0;
-
-        for (; !dot[i].visible || dot[i].order; ++i)
-            if (i >= 3)
-            {
-                return;
-            }
-
-        for (j = 0; j < 4; ++j)
-        {
-            if (dot[j].visible && !dot[j].order && (dot[j].x < dot[i].x))
-            {
-                i = j;
-            }
-        }
-
-        dot[i].order = order;
-    }
-}
-
 /**
  *	@brief Calculate the distance between the first 2 visible IR dots.
  *
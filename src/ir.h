@@ -48,6 +48,7 @@ extern "C" {
 void wiiuse_set_ir_mode(struct wiimote_t *wm);
 void calculate_basic_ir(struct wiimote_t *wm, byte *data);
 void calculate_extended_ir(struct wiimote_t *wm, byte *data);
+void calculate_full_ir(struct wiimote_t *wm, const byte *first, const byte *second);
 float calc_yaw(struct ir_t *ir);
 /** @} */
 
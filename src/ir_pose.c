@@ -0,0 +1,741 @@
+/*
+ *	wiiuse
+ *
+ *	Written By:
+ *		Melodea Research	< melodea-research/wiimote-bridge >
+ *
+ *	Copyright 2026
+ *
+ *	This file is part of wiiuse.
+ *
+ *	This program is free software; you can redistribute it and/or modify
+ *	it under the terms of the GNU General Public License as published by
+ *	the Free Software Foundation; either version 3 of the License, or
+ *	(at your option) any later version.
+ *
+ *	This program is distributed in the hope that it will be useful,
+ *	but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *	GNU General Public License for more details.
+ *
+ *	You should have received a copy of the GNU General Public License
+ *	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *	$Header$
+ *
+ */
+
+/**
+ *	@file
+ *	@brief Pose from an IR constellation.
+ *
+ *	With four IR sources of known geometry in view, the position and
+ *	orientation of the remote follow from where the camera sees them
+ *	(the perspective-n-point problem).  The pose minimizes the squared
+ *	reprojection error with a few Levenberg-Marquardt steps over the
+ *	rotation (as a small rotation vector applied on the left) and the
+ *	translation.
+ *
+ *	Each report starts from the previous pose, with the LEDs matched to
+ *	the dots through the dot ids of ir_track_dots().  When there is no
+ *	previous pose, or it no longer fits, every assignment of the dots to
+ *	the LEDs is tried: the homography from the constellation plane to the
+ *	image gives a first pose, which is refined together with its mirror
+ *	image (a small plane seen at an angle looks about the same tilted
+ *	either way), and the best fit wins.  The constellation should
+ *	therefore be close to planar and without symmetry, or the assignment
+ *	is ambiguous.
+ *
+ *	The camera is modelled as an ideal pinhole centered on the sensor.
+ */
+
+#include "ir_pose.h"
+
+#include <math.h>   /* for atan2, cos, sin, sqrt */
+#include <string.h> /* for memcpy, memset */
+
+/* Levenberg-Marquardt iterations from the previous pose, resp. per assignment and to finish a new pose */
+#define IR_POSE_TRACK_ITERATIONS 5
+#define IR_POSE_INIT_ITERATIONS 10
+
+/* stop once a step improves the error by less than this fraction */
+#define IR_POSE_MIN_GAIN 1e-3
+
+/* initial relative damping of the normal equations */
+#define IR_POSE_DAMPING 1e-3
+
+/* RMS reprojection errors (camera pixels): restart beyond the first, give up beyond the second */
+#define IR_POSE_MAX_TRACK_ERROR 8.0
+#define IR_POSE_MAX_ERROR 16.0
+
+/* solve the n x n system a x = b in place by Gaussian elimination, 0 if singular */
+static int solve(double *a, double *b, int n)
+{
+    int i, j, k;
+
+    for (i = 0; i < n; ++i)
+    {
+        int p = i;
+        for (j = i + 1; j < n; ++j)
+        {
+            if (fabs(a[j * n + i]) > fabs(a[p * n + i]))
+            {
+                p = j;
+            }
+        }
+        if (fabs(a[p * n + i]) < 1e-12)
+        {
+            return 0;
+        }
+        if (p != i)
+        {
+            double tmp;
+            for (k = 0; k < n; ++k)
+            {
+                tmp          = a[i * n + k];
+                a[i * n + k] = a[p * n + k];
+                a[p * n + k] = tmp;
+            }
+            tmp  = b[i];
+            b[i] = b[p];
+            b[p] = tmp;
+        }
+        for (j = i + 1; j < n; ++j)
+        {
+            double f = a[j * n + i] / a[i * n + i];
+            for (k = i; k < n; ++k)
+            {
+                a[j * n + k] -= f * a[i * n + k];
+            }
+            b[j] -= f * b[i];
+        }
+    }
+
+    for (i = n - 1; i >= 0; --i)
+    {
+        for (k = i + 1; k < n; ++k)
+        {
+            b[i] -= a[i * n + k] * b[k];
+        }
+        b[i] /= a[i * n + i];
+    }
+    return 1;
+}
+
+static void cross(const double *a, const double *b, double *c)
+{
+    c[0] = a[1] * b[2] - a[2] * b[1];
+    c[1] = a[2] * b[0] - a[0] * b[2];
+    c[2] = a[0] * b[1] - a[1] * b[0];
+}
+
+static double normalize(double *v)
+{
+    double n = sqrt(v[0] * v[0] + v[1] * v[1] + v[2] * v[2]);
+    if (n > 0.0)
+    {
+        v[0] /= n;
+        v[1] /= n;
+        v[2] /= n;
+    }
+    return n;
+}
+
+/* orthonormal basis e[0], e[1] of the constellation plane, normal e[2], and its centroid */
+static int constellation_plane(const float leds[4][3], double e[3][3], double *c)
+{
+    double d1[3], d2[3];
+    int i, j;
+
+    for (j = 0; j < 3; ++j)
+    {
+        c[j]  = 0.25 * (leds[0][j] + leds[1][j] + leds[2][j] + leds[3][j]);
+        d1[j] = leds[2][j] - leds[0][j];
+        d2[j] = leds[3][j] - leds[1][j];
+    }
+
+    /* the diagonals span the plane whichever way round the LEDs were listed, unless they are parallel */
+    cross(d1, d2, e[2]);
+    if (normalize(e[2]) < 1e-6)
+    {
+        for (j = 0; j < 3; ++j)
+        {
+            d2[j] = leds[1][j] - leds[0][j];
+        }
+        cross(d1, d2, e[2]);
+        if (normalize(e[2]) < 1e-6)
+        {
+            return 0;
+        }
+    }
+
+    /* e[0] along the LED furthest from the centroid, projected onto the plane */
+    for (i = 0, j = 0; i < 4; ++i)
+    {
+        double v[3], dot;
+        int k;
+        for (k = 0; k < 3; ++k)
+        {
+            v[k] = leds[i][k] - c[k];
+        }
+        dot = v[0] * e[2][0] + v[1] * e[2][1] + v[2] * e[2][2];
+        for (k = 0; k < 3; ++k)
+        {
+            v[k] -= dot * e[2][k];
+        }
+        if (normalize(v) > 1e-6)
+        {
+            memcpy(e[0], v, sizeof(v));
+            j = 1;
+            break;
+        }
+    }
+    if (!j)
+    {
+        return 0;
+    }
+    cross(e[2], e[0], e[1]);
+    return 1;
+}
+
+/* R = exp([w]x) R */
+static void rotate(double R[3][3], const double *w)
+{
+    double theta = sqrt(w[0] * w[0] + w[1] * w[1] + w[2] * w[2]);
+    double k[3], s, c, E[3][3], out[3][3];
+    int i, j;
+
+    if (theta < 1e-12)
+    {
+        return;
+    }
+    k[0] = w[0] / theta;
+    k[1] = w[1] / theta;
+    k[2] = w[2] / theta;
+    s    = sin(theta);
+    c    = 1.0 - cos(theta);
+
+    /* Rodrigues: I + s K + c K^2, with K^2 = k k^T - I */
+    E[0][0] = 1.0 + c * (k[0] * k[0] - 1.0);
+    E[1][1] = 1.0 + c * (k[1] * k[1] - 1.0);
+    E[2][2] = 1.0 + c * (k[2] * k[2] - 1.0);
+    E[0][1] = c * k[0] * k[1] - s * k[2];
+    E[1][0] = c * k[0] * k[1] + s * k[2];
+    E[0][2] = c * k[0] * k[2] + s * k[1];
+    E[2][0] = c * k[0] * k[2] - s * k[1];
+    E[1][2] = c * k[1] * k[2] - s * k[0];
+    E[2][1] = c * k[1] * k[2] + s * k[0];
+
+    for (i = 0; i < 3; ++i)
+    {
+        for (j = 0; j < 3; ++j)
+        {
+            out[i][j] = E[i][0] * R[0][j] + E[i][1] * R[1][j] + E[i][2] * R[2][j];
+        }
+    }
+    memcpy(R, out, sizeof(out));
+}
+
+/*
+ *	Normal equations A x = b (upper triangle of A) of the reprojection
+ *	error at R, t, undamped; refine() adds the damping.  Returns the RMS
+ *	error in normalized units, -1 if an LED is behind the camera.
+ */
+static double normal_equations(const double R[3][3], const double *t, const float leds[4][3], const double m[4][2],
+                               double *A, double *b)
+{
+    double sum = 0.0;
+    int i, j, k;
+
+    memset(A, 0, 36 * sizeof(double));
+    memset(b, 0, 6 * sizeof(double));
+
+    for (i = 0; i < 4; ++i)
+    {
+        double q[3], p[3], J[2][6], r[2], iz;
+
+        for (j = 0; j < 3; ++j)
+        {
+            q[j] = R[j][0] * leds[i][0] + R[j][1] * leds[i][1] + R[j][2] * leds[i][2];
+            p[j] = q[j] + t[j];
+        }
+        if (p[2] <= 1e-9)
+        {
+            return -1.0;
+        }
+        iz   = 1.0 / p[2];
+        r[0] = m[i][0] - p[0] * iz;
+        r[1] = m[i][1] - p[1] * iz;
+        sum += r[0] * r[0] + r[1] * r[1];
+
+        /* d(projection)/dp times dp/d(w, t) = [-[q]x | I], i.e. q x d(projection)/dp for w */
+        {
+            double du[3] = {iz, 0.0, -p[0] * iz * iz};
+            double dv[3] = {0.0, iz, -p[1] * iz * iz};
+
+            cross(q, du, J[0]);
+            cross(q, dv, J[1]);
+            for (j = 0; j < 3; ++j)
+            {
+                J[0][3 + j] = du[j];
+                J[1][3 + j] = dv[j];
+            }
+        }
+
+        for (j = 0; j < 6; ++j)
+        {
+            b[j] += J[0][j] * r[0] + J[1][j] * r[1];
+            for (k = j; k < 6; ++k)
+            {
+                A[j * 6 + k] += J[0][j] * J[0][k] + J[1][j] * J[1][k];
+            }
+        }
+    }
+    return sqrt(sum / 4.0);
+}
+
+/*
+ *	Refine R, t so that LED i projects onto the normalized image point m[i]
+ *	(Levenberg-Marquardt: steps that do not lower the error are retried
+ *	with more damping).  Returns the RMS error in normalized units, -1 if
+ *	the pose broke down.
+ */
+static double refine(double R[3][3], double *t, const float leds[4][3], const double m[4][2], int iterations)
+{
+    double A[36], b[6], lambda = IR_POSE_DAMPING;
+    double err = normal_equations(R, t, leds, m, A, b);
+    int it, j, k;
+
+    for (it = 0; it < iterations && err >= 0.0; ++it)
+    {
+        double S[36], x[6], Rn[3][3], tn[3], An[36], bn[6], e;
+
+        for (j = 0; j < 6; ++j)
+        {
+            for (k = j; k < 6; ++k)
+            {
+                S[j * 6 + k] = S[k * 6 + j] = A[j * 6 + k];
+            }
+            S[j * 6 + j] *= 1.0 + lambda;
+            x[j] = b[j];
+        }
+        if (!solve(S, x, 6))
+        {
+            return -1.0;
+        }
+
+        memcpy(Rn, R, sizeof(Rn));
+        rotate(Rn, x);
+        tn[0] = t[0] + x[3];
+        tn[1] = t[1] + x[4];
+        tn[2] = t[2] + x[5];
+
+        e = normal_equations(Rn, tn, leds, m, An, bn);
+        if (e < 0.0 || e >= err)
+        {
+            lambda *= 10.0;
+            continue;
+        }
+
+        memcpy(R, Rn, sizeof(Rn));
+        memcpy(t, tn, sizeof(tn));
+        memcpy(A, An, sizeof(An));
+        memcpy(b, bn, sizeof(bn));
+        lambda *= 0.1;
+
+        if (err - e < IR_POSE_MIN_GAIN * err)
+        {
+            err = e;
+            break;
+        }
+        err = e;
+    }
+    return err;
+}
+
+/*
+ *	First pose for LED i seen at m[i], from the homography between the
+ *	constellation plane (see constellation_plane()) and the image.  0 if it
+ *	is degenerate.
+ */
+static int initial_pose(const float leds[4][3], const double e[3][3], const double *c, const double m[4][2],
+                        double R[3][3], double *t)
+{
+    double a[4][2], scale = 0.0;
+    double A[64], h[8], r1[3], r2[3], r3[3], tp[3], n1, n2, lambda, d;
+    int i, j;
+
+    /* plane coordinates, scaled to about unit size for the conditioning */
+    for (i = 0; i < 4; ++i)
+    {
+        double v[3] = {leds[i][0] - c[0], leds[i][1] - c[1], leds[i][2] - c[2]};
+        a[i][0]     = v[0] * e[0][0] + v[1] * e[0][1] + v[2] * e[0][2];
+        a[i][1]     = v[0] * e[1][0] + v[1] * e[1][1] + v[2] * e[1][2];
+        scale += a[i][0] * a[i][0] + a[i][1] * a[i][1];
+    }
+    scale = sqrt(scale / 4.0);
+    for (i = 0; i < 4; ++i)
+    {
+        a[i][0] /= scale;
+        a[i][1] /= scale;
+    }
+
+    /* m ~ H (a, 1) with h33 = 1 */
+    memset(A, 0, sizeof(A));
+    for (i = 0; i < 4; ++i)
+    {
+        double *rx = A + (2 * i) * 8, *ry = A + (2 * i + 1) * 8;
+
+        rx[0] = a[i][0];
+        rx[1] = a[i][1];
+        rx[2] = 1.0;
+        rx[6] = -m[i][0] * a[i][0];
+        rx[7] = -m[i][0] * a[i][1];
+        ry[3] = a[i][0];
+        ry[4] = a[i][1];
+        ry[5] = 1.0;
+        ry[6] = -m[i][1] * a[i][0];
+        ry[7] = -m[i][1] * a[i][1];
+
+        h[2 * i]     = m[i][0];
+        h[2 * i + 1] = m[i][1];
+    }
+    if (!solve(A, h, 8))
+    {
+        return 0;
+    }
+
+    /* H = lambda [r1 r2 t] in the plane frame, with t in front of the camera */
+    r1[0] = h[0] / scale;
+    r1[1] = h[3] / scale;
+    r1[2] = h[6] / scale;
+    r2[0] = h[1] / scale;
+    r2[1] = h[4] / scale;
+    r2[2] = h[7] / scale;
+    tp[0] = h[2];
+    tp[1] = h[5];
+    tp[2] = 1.0;
+
+    n1 = normalize(r1);
+    n2 = sqrt(r2[0] * r2[0] + r2[1] * r2[1] + r2[2] * r2[2]);
+    if (n1 < 1e-12 || n2 < 1e-12)
+    {
+        return 0;
+    }
+    lambda = 2.0 / (n1 + n2);
+    for (j = 0; j < 3; ++j)
+    {
+        tp[j] *= lambda;
+    }
+
+    d = r1[0] * r2[0] + r1[1] * r2[1] + r1[2] * r2[2];
+    for (j = 0; j < 3; ++j)
+    {
+        r2[j] -= d * r1[j];
+    }
+    normalize(r2);
+    cross(r1, r2, r3);
+
+    /* back to the constellation frame: R = [r1 r2 r3] E, t = tp - R c */
+    for (i = 0; i < 3; ++i)
+    {
+        for (j = 0; j < 3; ++j)
+        {
+            R[i][j] = r1[i] * e[0][j] + r2[i] * e[1][j] + r3[i] * e[2][j];
+        }
+    }
+    for (i = 0; i < 3; ++i)
+    {
+        t[i] = tp[i] - (R[i][0] * c[0] + R[i][1] * c[1] + R[i][2] * c[2]);
+    }
+    return 1;
+}
+
+/*
+ *	The other pose a plane seen from afar projects about the same for: the
+ *	plane tilted the other way around the line of sight to its center c,
+ *	R' = (I - 2 v v^T) R (I - 2 n n^T) with v that line and n the normal.
+ */
+static void flip_pose(const double R[3][3], const double *t, const double *n, const double *c, double Rf[3][3],
+                      double *tf)
+{
+    double v[3], M[3][3];
+    int i, j;
+
+    for (i = 0; i < 3; ++i)
+    {
+        v[i] = R[i][0] * c[0] + R[i][1] * c[1] + R[i][2] * c[2] + t[i];
+    }
+    normalize(v);
+
+    /* M = (I - 2 v v^T) R */
+    for (j = 0; j < 3; ++j)
+    {
+        double d = v[0] * R[0][j] + v[1] * R[1][j] + v[2] * R[2][j];
+        for (i = 0; i < 3; ++i)
+        {
+            M[i][j] = R[i][j] - 2.0 * v[i] * d;
+        }
+    }
+
+    /* Rf = M (I - 2 n n^T), the center stays where it was */
+    for (i = 0; i < 3; ++i)
+    {
+        double d = M[i][0] * n[0] + M[i][1] * n[1] + M[i][2] * n[2];
+        for (j = 0; j < 3; ++j)
+        {
+            Rf[i][j] = M[i][j] - 2.0 * d * n[j];
+        }
+        tf[i] = R[i][0] * c[0] + R[i][1] * c[1] + R[i][2] * c[2] + t[i] -
+                (Rf[i][0] * c[0] + Rf[i][1] * c[1] + Rf[i][2] * c[2]);
+    }
+}
+
+/* fill the public pose from R, t (constellation to camera) */
+static void set_pose(struct ir_pose_t *pose, const double R[3][3], const double *t, double err)
+{
+    double w, x, y, z, tr;
+
+    /* camera position: -R^T t */
+    pose->x = (float)-(R[0][0] * t[0] + R[1][0] * t[1] + R[2][0] * t[2]);
+    pose->y = (float)-(R[0][1] * t[0] + R[1][1] * t[1] + R[2][1] * t[2]);
+    pose->z = (float)-(R[0][2] * t[0] + R[1][2] * t[1] + R[2][2] * t[2]);
+
+    /* quaternion of R^T, the camera to constellation rotation */
+    tr = R[0][0] + R[1][1] + R[2][2];
+    if (tr > 0.0)
+    {
+        double s = 2.0 * sqrt(1.0 + tr);
+        w        = 0.25 * s;
+        x        = (R[2][1] - R[1][2]) / s;
+        y        = (R[0][2] - R[2][0]) / s;
+        z        = (R[1][0] - R[0][1]) / s;
+    } else if (R[0][0] > R[1][1] && R[0][0] > R[2][2])
+    {
+        double s = 2.0 * sqrt(1.0 + R[0][0] - R[1][1] - R[2][2]);
+        w        = (R[2][1] - R[1][2]) / s;
+        x        = 0.25 * s;
+        y        = (R[0][1] + R[1][0]) / s;
+        z        = (R[0][2] + R[2][0]) / s;
+    } else if (R[1][1] > R[2][2])
+    {
+        double s = 2.0 * sqrt(1.0 + R[1][1] - R[0][0] - R[2][2]);
+        w        = (R[0][2] - R[2][0]) / s;
+        x        = (R[0][1] + R[1][0]) / s;
+        y        = 0.25 * s;
+        z        = (R[1][2] + R[2][1]) / s;
+    } else
+    {
+        double s = 2.0 * sqrt(1.0 + R[2][2] - R[0][0] - R[1][1]);
+        w        = (R[1][0] - R[0][1]) / s;
+        x        = (R[0][2] + R[2][0]) / s;
+        y        = (R[1][2] + R[2][1]) / s;
+        z        = 0.25 * s;
+    }
+    /* that was the quaternion of R, conjugate it for R^T */
+    pose->quat.w = (float)w;
+    pose->quat.x = (float)-x;
+    pose->quat.y = (float)-y;
+    pose->quat.z = (float)-z;
+
+    /*
+     *	The rows of R are the camera axes in the constellation frame:
+     *	right = R[0], down = R[1], forward = R[2].
+     */
+    pose->orient.yaw   = (float)RAD_TO_DEGREE(atan2(R[2][0], -R[2][2]));
+    pose->orient.pitch = (float)RAD_TO_DEGREE(atan2(R[2][1], sqrt(R[2][0] * R[2][0] + R[2][2] * R[2][2])));
+    pose->orient.roll  = (float)RAD_TO_DEGREE(atan2(-R[0][1], -R[1][1]));
+
+    pose->error = (float)err;
+    pose->valid = 1;
+}
+
+/**
+ *	@brief Solve the pose for the current IR dots.
+ *
+ *	@param wm		Pointer to a wiimote_t structure.
+ *
+ *	Called after the dots were tracked.  Sets ir_pose.valid to 0 unless all
+ *	four LEDs are in view and a pose fits them.
+ */
+void ir_pose_update(struct wiimote_t *wm)
+{
+    struct ir_tracker_t *tr = wm->ir_tracker;
+    struct ir_dot_t *dot    = wm->ir.dot;
+    double m[4][2], R[3][3], t[3], err = -1.0, f;
+    int seen[4], n = 0, i, j;
+
+    wm->ir_pose.valid = 0;
+    if (!tr || !tr->pose_enabled)
+    {
+        return;
+    }
+
+    for (i = 0; i < 4; ++i)
+    {
+        if (dot[i].visible)
+        {
+            seen[n++] = i;
+        }
+    }
+    if (n != 4)
+    {
+        memset(tr->pose_ids, 0, sizeof(tr->pose_ids));
+        return;
+    }
+
+    /* the same sources as last time: keep their LEDs and start from the last pose */
+    f = tr->focal;
+    for (i = 0; i < 4 && tr->pose_ids[0]; ++i)
+    {
+        for (j = 0; j < 4 && dot[seen[j]].id != tr->pose_ids[i]; ++j)
+            ;
+        if (j == 4)
+        {
+            break;
+        }
+        m[i][0] = ((1023 - dot[seen[j]].rx) - WM_IR_CX) / f;
+        m[i][1] = ((767 - dot[seen[j]].ry) - WM_IR_CY) / f;
+    }
+    if (i == 4)
+    {
+        memcpy(R, tr->pose_R, sizeof(R));
+        memcpy(t, tr->pose_t, sizeof(t));
+        err = refine(R, t, tr->leds, m, IR_POSE_TRACK_ITERATIONS);
+    }
+
+    if (err < 0.0 || err * f > IR_POSE_MAX_TRACK_ERROR)
+    {
+        /* try every assignment of the dots to the LEDs */
+        const byte *best = NULL;
+        double plane[3][3], center[3];
+
+        err = -1.0;
+        constellation_plane(tr->leds, plane, center);
+        for (j = 0; j < 24; ++j)
+        {
+            double mj[4][2], R0[3][3], t0[3];
+            int flip;
+
+            for (i = 0; i < 4; ++i)
+            {
+                const struct ir_dot_t *d = &dot[seen[wiiuse_permutations4[j][i]]];
+                mj[i][0]                 = ((1023 - d->rx) - WM_IR_CX) / f;
+                mj[i][1]                 = ((767 - d->ry) - WM_IR_CY) / f;
+            }
+            if (!initial_pose(tr->leds, plane, center, mj, R0, t0))
+            {
+                continue;
+            }
+
+            /* refine both poses the homography cannot tell apart when the noise is up */
+            for (flip = 0; flip < 2; ++flip)
+            {
+                double Rj[3][3], tj[3], e;
+
+                if (flip)
+                {
+                    flip_pose(R0, t0, plane[2], center, Rj, tj);
+                } else
+                {
+                    memcpy(Rj, R0, sizeof(Rj));
+                    memcpy(tj, t0, sizeof(tj));
+                }
+
+                e = refine(Rj, tj, tr->leds, mj, IR_POSE_INIT_ITERATIONS);
+                if (e >= 0.0 && (err < 0.0 || e < err))
+                {
+                    err  = e;
+                    best = wiiuse_permutations4[j];
+                    memcpy(m, mj, sizeof(m));
+                    memcpy(R, Rj, sizeof(R));
+                    memcpy(t, tj, sizeof(t));
+                }
+            }
+        }
+        if (!best)
+        {
+            memset(tr->pose_ids, 0, sizeof(tr->pose_ids));
+            return;
+        }
+
+        err = refine(R, t, tr->leds, m, IR_POSE_TRACK_ITERATIONS);
+        for (i = 0; i < 4; ++i)
+        {
+            tr->pose_ids[i] = dot[seen[best[i]]].id;
+        }
+    }
+
+    if (err < 0.0 || err * f > IR_POSE_MAX_ERROR)
+    {
+        memset(tr->pose_ids, 0, sizeof(tr->pose_ids));
+        return;
+    }
+
+    memcpy(tr->pose_R, R, sizeof(R));
+    memcpy(tr->pose_t, t, sizeof(t));
+    set_pose(&wm->ir_pose, R, t, err * f);
+}
+
+/**
+ *	@brief Solve the pose of the remote from four IR sources of known geometry.
+ *
+ *	@param wm		Pointer to a wiimote_t structure.
+ *	@param leds		Positions of the four IR sources, or NULL to stop solving.
+ *	@param focal	Focal length of the camera in camera pixels, 0 for the
+ *					nominal 1380.
+ *
+ *	@return 1 on success, 0 if the LEDs are (nearly) collinear.
+ *
+ *	The constellation frame is right handed; for sources on a screen take
+ *	x to the right, y up and z out of the screen.  The LEDs should be close
+ *	to a plane and laid out without symmetry (e.g. not a square), otherwise
+ *	the solver cannot tell which dot is which when it first sees them.
+ *
+ *	While all four dots are in view, ir_pose holds the remote's position
+ *	in the units of \a leds, the rotation of the camera frame (x right,
+ *	y down, z forward) into the constellation frame, and as angles: yaw
+ *	and pitch of the pointing direction from -z (positive to the right
+ *	and up) and roll about it (positive clockwise as seen from behind).
+ *
+ *	The tracker is set to expect four sources, see wiiuse_set_ir_sources();
+ *	stopping sets it back to two.
+ */
+int wiiuse_set_ir_constellation(struct wiimote_t *wm, const float leds[4][3], float focal)
+{
+    struct ir_tracker_t *tr;
+    double e[3][3], c[3];
+
+    if (!wm || !wm->ir_tracker)
+    {
+        return 0;
+    }
+    tr = wm->ir_tracker;
+
+    wm->ir_pose.valid = 0;
+    memset(tr->pose_ids, 0, sizeof(tr->pose_ids));
+
+    if (!leds)
+    {
+        if (tr->pose_enabled)
+        {
+            tr->pose_enabled = 0;
+            wiiuse_set_ir_sources(wm, 2);
+        }
+        return 1;
+    }
+
+    if (!constellation_plane(leds, e, c))
+    {
+        WIIUSE_ERROR("IR constellation is degenerate, the LEDs must not be collinear.");
+        return 0;
+    }
+
+    memcpy(tr->leds, leds, sizeof(tr->leds));
+    tr->focal        = (focal > 0.0f) ? focal : WM_IR_FOCAL;
+    tr->pose_enabled = 1;
+    wiiuse_set_ir_sources(wm, 4);
+
+    WIIUSE_DEBUG("IR constellation set, focal length %.0f px (unid %i)", tr->focal, wm->unid);
+    return 1;
+}
@@ -0,0 +1,526 @@
+/*
+ *	wiiuse
+ *
+ *	Written By:
+ *		Melodea Research	< melodea-research/wiimote-bridge >
+ *
+ *	Copyright 2026
+ *
+ *	This file is part of wiiuse.
+ *
+ *	This program is free software; you can redistribute it and/or modify
+ *	it under the terms of the GNU General Public License as published by
+ *	the Free Software Foundation; either version 3 of the License, or
+ *	(at your option) any later version.
+ *
+ *	This program is distributed in the hope that it will be useful,
+ *	but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *	GNU General Public License for more details.
+ *
+ *	You should have received a copy of the GNU General Public License
+ *	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *	$Header$
+ *
+ */
+
+/**
+ *	@file
+ *	@brief Stereo triangulation of IR sources seen by several remotes.
+ *
+ *	Two or more remotes mounted as fixed cameras watch the same IR
+ *	sources.  Each update brings the dots of every remote to a common
+ *	time, matches the dots of the other remotes to those of the first one
+ *	that sees any, and triangulates each matched source as the point
+ *	closest to all of its rays.
+ *
+ *	Remotes report on their own clocks, so the dots of the older reports
+ *	are moved along their track velocity (see ir_track_dots()) to the time
+ *	of the newest one.  A dot matches when it lies close to the epipolar
+ *	line of the reference dot; among several candidates the closest pairs
+ *	are taken first.  Sources seen by one remote only are not reported.
+ *
+ *	The extrinsics come either from the caller or from
+ *	wiiuse_stereo_calibrate(), which averages the pose of each remote
+ *	relative to a four LED reference target (see
+ *	wiiuse_set_ir_constellation()).  The target then defines the world
+ *	frame.
+ */
+
+#include "wiiuse_internal.h"
+
+#include <math.h>   /* for fabs, sqrt */
+#include <string.h> /* for memset */
+
+/* default distance a match may be from its epipolar line, camera pixels */
+#define IR_STEREO_MAX_EPIPOLAR 6.0f
+
+/* default age a report may have relative to the newest one before its remote is left out */
+#define IR_STEREO_MAX_SKEW_US 20000
+
+/* report period the track velocities are measured over (100 Hz) */
+#define IR_STEREO_REPORT_US 10000.0
+
+/* a dot of one camera, as a normalized image point */
+struct stereo_dot_t
+{
+    unsigned int id;
+    double x, y;
+};
+
+/* visible dots of a camera at time now, in normalized coordinates */
+static int camera_dots(const struct ir_camera_t *c, uint64_t now, struct stereo_dot_t *out)
+{
+    const struct wiimote_t *wm     = c->wm;
+    const struct ir_tracker_t *tr = wm->ir_tracker;
+    double reports                = (double)(now - wm->timestamp_us) / IR_STEREO_REPORT_US;
+    int i, k, n = 0;
+
+    for (i = 0; i < 4; ++i)
+    {
+        const struct ir_dot_t *dot = &wm->ir.dot[i];
+        double rx, ry;
+
+        if (!dot->visible)
+        {
+            continue;
+        }
+
+        rx = dot->rx;
+        ry = dot->ry;
+        for (k = 0; tr && k < 4; ++k)
+        {
+            if (tr->dots[k].id == dot->id && !tr->dots[k].missed)
+            {
+                rx += tr->dots[k].vx * reports;
+                ry += tr->dots[k].vy * reports;
+                break;
+            }
+        }
+
+        /* rx, ry are mirrored camera coordinates, see calculate_basic_ir() */
+        out[n].id = dot->id;
+        out[n].x  = ((1023.0 - rx) - c->cx) / c->focal;
+        out[n].y  = ((767.0 - ry) - c->cy) / c->focal;
+        ++n;
+    }
+    return n;
+}
+
+/* distance in camera pixels of the dot m of camera b from the epipolar line of the dot r of camera a */
+static double epipolar_distance(const struct ir_camera_t *a, const struct ir_camera_t *b,
+                                const struct stereo_dot_t *r, const struct stereo_dot_t *m)
+{
+    double Rab[3][3], tab[3], d[3], l[3], n;
+    int i, j;
+
+    /* camera a to camera b: Rab = Rb Ra^T, tab = tb - Rab ta */
+    for (i = 0; i < 3; ++i)
+    {
+        for (j = 0; j < 3; ++j)
+        {
+            Rab[i][j] = b->R[i][0] * a->R[j][0] + b->R[i][1] * a->R[j][1] + b->R[i][2] * a->R[j][2];
+        }
+    }
+    for (i = 0; i < 3; ++i)
+    {
+        tab[i] = b->t[i] - (Rab[i][0] * a->t[0] + Rab[i][1] * a->t[1] + Rab[i][2] * a->t[2]);
+        d[i]   = Rab[i][0] * r->x + Rab[i][1] * r->y + Rab[i][2];
+    }
+
+    /* the line through the epipole and the direction of the ray: l = tab x d */
+    l[0] = tab[1] * d[2] - tab[2] * d[1];
+    l[1] = tab[2] * d[0] - tab[0] * d[2];
+    l[2] = tab[0] * d[1] - tab[1] * d[0];
+
+    n = sqrt(l[0] * l[0] + l[1] * l[1]);
+    if (n < 1e-12)
+    {
+        return HUGE_VAL;
+    }
+    return fabs(l[0] * m->x + l[1] * m->y + l[2]) / n * b->focal;
+}
+
+/*
+ *	The point closest to the rays of the views, in the least squares sense.
+ *	0 if the rays are (nearly) parallel.
+ */
+static int triangulate(const struct ir_camera_t *const *cam, const struct stereo_dot_t *const *dot, int views,
+                       double *X)
+{
+    double A[3][3], b[3], det;
+    int v, i, j;
+
+    memset(A, 0, sizeof(A));
+    memset(b, 0, sizeof(b));
+
+    for (v = 0; v < views; ++v)
+    {
+        const struct ir_camera_t *c = cam[v];
+        double d[3], C[3], n;
+
+        /* ray direction and camera center in the world frame: R^T m, -R^T t */
+        for (i = 0; i < 3; ++i)
+        {
+            d[i] = c->R[0][i] * dot[v]->x + c->R[1][i] * dot[v]->y + c->R[2][i];
+            C[i] = -(c->R[0][i] * c->t[0] + c->R[1][i] * c->t[1] + c->R[2][i] * c->t[2]);
+        }
+        n = sqrt(d[0] * d[0] + d[1] * d[1] + d[2] * d[2]);
+        d[0] /= n;
+        d[1] /= n;
+        d[2] /= n;
+
+        /* sum of (I - d d^T) and (I - d d^T) C */
+        for (i = 0; i < 3; ++i)
+        {
+            for (j = 0; j < 3; ++j)
+            {
+                double p = (i == j) - d[i] * d[j];
+                A[i][j] += p;
+                b[i] += p * C[j];
+            }
+        }
+    }
+
+    det = A[0][0] * (A[1][1] * A[2][2] - A[1][2] * A[2][1]) - A[0][1] * (A[1][0] * A[2][2] - A[1][2] * A[2][0]) +
+          A[0][2] * (A[1][0] * A[2][1] - A[1][1] * A[2][0]);
+    if (fabs(det) < 1e-9)
+    {
+        return 0;
+    }
+
+    /* Cramer's rule */
+    X[0] = (b[0] * (A[1][1] * A[2][2] - A[1][2] * A[2][1]) - A[0][1] * (b[1] * A[2][2] - A[1][2] * b[2]) +
+            A[0][2] * (b[1] * A[2][1] - A[1][1] * b[2])) /
+           det;
+    X[1] = (A[0][0] * (b[1] * A[2][2] - A[1][2] * b[2]) - b[0] * (A[1][0] * A[2][2] - A[1][2] * A[2][0]) +
+            A[0][2] * (A[1][0] * b[2] - b[1] * A[2][0])) /
+           det;
+    X[2] = (A[0][0] * (A[1][1] * b[2] - b[1] * A[2][1]) - A[0][1] * (A[1][0] * b[2] - b[1] * A[2][0]) +
+            b[0] * (A[1][0] * A[2][1] - A[1][1] * A[2][0])) /
+           det;
+    return 1;
+}
+
+/**
+ *	@brief Set up an empty stereo rig.
+ *
+ *	@param st	Pointer to an ir_stereo_t structure.
+ */
+void wiiuse_stereo_init(struct ir_stereo_t *st)
+{
+    if (!st)
+    {
+        return;
+    }
+
+    memset(st, 0, sizeof(*st));
+    st->max_epipolar = IR_STEREO_MAX_EPIPOLAR;
+    st->max_skew_us  = IR_STEREO_MAX_SKEW_US;
+}
+
+/**
+ *	@brief Add a remote to a stereo rig.
+ *
+ *	@param st	Pointer to an ir_stereo_t structure.
+ *	@param wm	The remote, with IR on.
+ *	@param cam	Its intrinsics and extrinsics, or NULL for the nominal
+ *				camera at the world origin, to be set up with
+ *				wiiuse_stereo_calibrate().  Its \a wm is ignored.
+ *
+ *	@return The index of the camera, or -1 if the rig is full.
+ */
+int wiiuse_stereo_add_camera(struct ir_stereo_t *st, struct wiimote_t *wm, const struct ir_camera_t *cam)
+{
+    struct ir_camera_t *c;
+
+    if (!st || !wm)
+    {
+        return -1;
+    }
+    if (st->num_cameras >= WIIUSE_STEREO_MAX_CAMERAS)
+    {
+        WIIUSE_ERROR("Stereo rig already has %i cameras.", WIIUSE_STEREO_MAX_CAMERAS);
+        return -1;
+    }
+
+    c = &st->cam[st->num_cameras];
+    if (cam)
+    {
+        *c = *cam;
+    } else
+    {
+        memset(c, 0, sizeof(*c));
+        c->focal   = WM_IR_FOCAL;
+        c->cx      = WM_IR_CX;
+        c->cy      = WM_IR_CY;
+        c->R[0][0] = c->R[1][1] = c->R[2][2] = 1.0f;
+    }
+    c->wm            = wm;
+    c->calib_samples = 0;
+    memset(c->calib_sum, 0, sizeof(c->calib_sum));
+
+    return st->num_cameras++;
+}
+
+/**
+ *	@brief Calibrate the extrinsics of a camera from a reference target.
+ *
+ *	@param st		Pointer to an ir_stereo_t structure.
+ *	@param camera	Index of the camera.
+ *
+ *	@return The number of poses averaged so far.
+ *
+ *	Set the target geometry on the remote with wiiuse_set_ir_constellation()
+ *	and call this after each report while the remote sees the target.
+ *	Every valid pose is averaged into the extrinsics, so a few hundred
+ *	reports smooth out the pixel noise.  The focal length is taken from the
+ *	constellation.  Calibrate every camera against the same, unmoved target:
+ *	it becomes the world frame.  Adding the camera again restarts the
+ *	average.
+ */
+int wiiuse_stereo_calibrate(struct ir_stereo_t *st, int camera)
+{
+    struct ir_camera_t *c;
+    const struct ir_pose_t *pose;
+    double *sum, w, x, y, z, n, pos[3];
+    int i, j;
+
+    if (!st || camera < 0 || camera >= st->num_cameras)
+    {
+        return 0;
+    }
+    c    = &st->cam[camera];
+    pose = &c->wm->ir_pose;
+    sum  = c->calib_sum;
+
+    if (!pose->valid)
+    {
+        return c->calib_samples;
+    }
+
+    /* q and -q are the same rotation, add them on the same side */
+    w = pose->quat.w;
+    x = pose->quat.x;
+    y = pose->quat.y;
+    z = pose->quat.z;
+    if (sum[0] * w + sum[1] * x + sum[2] * y + sum[3] * z < 0.0)
+    {
+        w = -w;
+        x = -x;
+        y = -y;
+        z = -z;
+    }
+    sum[0] += w;
+    sum[1] += x;
+    sum[2] += y;
+    sum[3] += z;
+    sum[4] += pose->x;
+    sum[5] += pose->y;
+    sum[6] += pose->z;
+    c->calib_samples++;
+
+    /* the mean camera to world rotation, transposed into R */
+    n = sqrt(sum[0] * sum[0] + sum[1] * sum[1] + sum[2] * sum[2] + sum[3] * sum[3]);
+    w = sum[0] / n;
+    x = sum[1] / n;
+    y = sum[2] / n;
+    z = sum[3] / n;
+
+    c->R[0][0] = (float)(1.0 - 2.0 * (y * y + z * z));
+    c->R[1][0] = (float)(2.0 * (x * y - w * z));
+    c->R[2][0] = (float)(2.0 * (x * z + w * y));
+    c->R[0][1] = (float)(2.0 * (x * y + w * z));
+    c->R[1][1] = (float)(1.0 - 2.0 * (x * x + z * z));
+    c->R[2][1] = (float)(2.0 * (y * z - w * x));
+    c->R[0][2] = (float)(2.0 * (x * z - w * y));
+    c->R[1][2] = (float)(2.0 * (y * z + w * x));
+    c->R[2][2] = (float)(1.0 - 2.0 * (x * x + y * y));
+
+    /* t = -R position */
+    for (j = 0; j < 3; ++j)
+    {
+        pos[j] = sum[4 + j] / c->calib_samples;
+    }
+    for (i = 0; i < 3; ++i)
+    {
+        c->t[i] = (float)-(c->R[i][0] * pos[0] + c->R[i][1] * pos[1] + c->R[i][2] * pos[2]);
+    }
+
+    if (c->wm->ir_tracker && c->wm->ir_tracker->pose_enabled)
+    {
+        c->focal = c->wm->ir_tracker->focal;
+        c->cx    = WM_IR_CX;
+        c->cy    = WM_IR_CY;
+    }
+    return c->calib_samples;
+}
+
+/**
+ *	@brief Triangulate the IR sources seen by the remotes of a stereo rig.
+ *
+ *	@param st	Pointer to an ir_stereo_t structure.
+ *
+ *	@return The number of points found, see st->point.
+ *
+ *	Call after polling, once the remotes' reports are in.  Remotes whose
+ *	last report is more than st->max_skew_us older than the newest one are
+ *	left out, and the points are brought to the time of the newest report
+ *	(st->timestamp_us).  Each point keeps the dot id it has in the first
+ *	remote that sees it, so a point can be followed from update to update
+ *	as long as that remote keeps seeing it.
+ *
+ *	Set the number of sources each remote expects with
+ *	wiiuse_set_ir_sources() (0 keeps every dot): by default it keeps the
+ *	two that best fit a sensor bar.
+ */
+int wiiuse_stereo_update(struct ir_stereo_t *st)
+{
+    struct stereo_dot_t dots[WIIUSE_STEREO_MAX_CAMERAS][4];
+    int num_dots[WIIUSE_STEREO_MAX_CAMERAS];
+    int match[WIIUSE_STEREO_MAX_CAMERAS][4]; /* dot of each camera matching each reference dot, -1 if none */
+    uint64_t newest = 0;
+    int ref = -1, used = 0, c, i, j;
+
+    if (!st)
+    {
+        return 0;
+    }
+    st->num_points = 0;
+
+    for (c = 0; c < st->num_cameras; ++c)
+    {
+        if (st->cam[c].wm->timestamp_us > newest)
+        {
+            newest = st->cam[c].wm->timestamp_us;
+        }
+    }
+    st->timestamp_us = newest;
+
+    for (c = 0; c < st->num_cameras; ++c)
+    {
+        const struct wiimote_t *wm = st->cam[c].wm;
+
+        num_dots[c] = 0;
+        if (!WIIMOTE_IS_SET(wm, WIIMOTE_STATE_IR) || newest - wm->timestamp_us > st->max_skew_us)
+        {
+            continue;
+        }
+        num_dots[c] = camera_dots(&st->cam[c], newest, dots[c]);
+        if (num_dots[c])
+        {
+            used++;
+            if (ref < 0)
+            {
+                ref = c;
+            }
+        }
+    }
+    if (used < 2)
+    {
+        return 0;
+    }
+
+    /* match each camera to the reference one, closest pairs first */
+    for (c = ref + 1; c < st->num_cameras; ++c)
+    {
+        double dist[4][4];
+        int taken = 0;
+
+        for (i = 0; i < 4; ++i)
+        {
+            match[c][i] = -1;
+        }
+        for (i = 0; i < num_dots[ref]; ++i)
+        {
+            for (j = 0; j < num_dots[c]; ++j)
+            {
+                dist[i][j] = epipolar_distance(&st->cam[ref], &st->cam[c], &dots[ref][i], &dots[c][j]);
+            }
+        }
+
+        for (;;)
+        {
+            double best = st->max_epipolar;
+            int bi = -1, bj = -1;
+
+            for (i = 0; i < num_dots[ref]; ++i)
+            {
+                for (j = 0; j < num_dots[c] && match[c][i] < 0; ++j)
+                {
+                    if (!(taken & (1 << j)) && dist[i][j] <= best)
+                    {
+                        best = dist[i][j];
+                        bi   = i;
+                        bj   = j;
+                    }
+                }
+            }
+            if (bi < 0)
+            {
+                break;
+            }
+            match[c][bi] = bj;
+            taken |= 1 << bj;
+        }
+    }
+
+    for (i = 0; i < num_dots[ref]; ++i)
+    {
+        const struct ir_camera_t *cam[WIIUSE_STEREO_MAX_CAMERAS];
+        const struct stereo_dot_t *seen[WIIUSE_STEREO_MAX_CAMERAS];
+        struct ir_point3_t *pt;
+        double X[3], sum = 0.0;
+        int views = 1, v;
+
+        cam[0]  = &st->cam[ref];
+        seen[0] = &dots[ref][i];
+        for (c = ref + 1; c < st->num_cameras; ++c)
+        {
+            if (match[c][i] >= 0)
+            {
+                cam[views]  = &st->cam[c];
+                seen[views] = &dots[c][match[c][i]];
+                views++;
+            }
+        }
+        if (views < 2 || !triangulate(cam, seen, views, X))
+        {
+            continue;
+        }
+
+        /* reprojection error, and the point must be in front of every camera */
+        for (v = 0; v < views; ++v)
+        {
+            const struct ir_camera_t *cv = cam[v];
+            double p[3];
+
+            for (j = 0; j < 3; ++j)
+            {
+                p[j] = cv->R[j][0] * X[0] + cv->R[j][1] * X[1] + cv->R[j][2] * X[2] + cv->t[j];
+            }
+            if (p[2] <= 0.0)
+            {
+                break;
+            }
+            sum += cv->focal * cv->focal *
+                   ((p[0] / p[2] - seen[v]->x) * (p[0] / p[2] - seen[v]->x) +
+                    (p[1] / p[2] - seen[v]->y) * (p[1] / p[2] - seen[v]->y));
+        }
+        if (v < views)
+        {
+            continue;
+        }
+
+        pt        = &st->point[st->num_points++];
+        pt->id    = seen[0]->id;
+        pt->x     = (float)X[0];
+        pt->y     = (float)X[1];
+        pt->z     = (float)X[2];
+        pt->error = (float)sqrt(sum / views);
+        pt->views = views;
+    }
+
+    return st->num_points;
+}
@@ -0,0 +1,699 @@
+/*
+ *	wiiuse
+ *
+ *	Written By:
+ *		Melodea Research	< melodea-research/wiimote-bridge >
+ *
+ *	Copyright 2026
+ *
+ *	This file is part of wiiuse.
+ *
+ *	This program is free software; you can redistribute it and/or modify
+ *	it under the terms of the GNU General Public License as published by
+ *	the Free Software Foundation; either version 3 of the License, or
+ *	(at your option) any later version.
+ *
+ *	This program is distributed in the hope that it will be useful,
+ *	but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *	GNU General Public License for more details.
+ *
+ *	You should have received a copy of the GNU General Public License
+ *	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *	$Header$
+ *
+ */
+
+/**
+ *	@file
+ *	@brief IR dot and cursor tracking.
+ *
+ *	ir_track_dots() follows the IR sources from report to report.  The
+ *	camera reports up to four dots in slots that carry no identity, so the
+ *	dots of each report are matched to the tracks of the previous ones by
+ *	the assignment with the least total squared distance to the predicted
+ *	track positions (all 24 permutations are tried).  Each track keeps its
+ *	id and its left to right order for as long as it lives, so a dot that
+ *	was hidden for a few reports comes back in its old place instead of
+ *	triggering a reordering.  When more dots than expected sources are
+ *	seen, the ones that fit the sensor bar worst are taken for reflections.
+ *
+ *	ir_tracker_update() runs a Kalman filter on each of ir.ax, ir.ay and
+ *	ir.z, using either a constant velocity or a constant acceleration
+ *	motion model driven by white noise (in acceleration, resp. jerk).  The
+ *	state is advanced by the real time between reports, so the filter
+ *	stays consistent when reports are late or dropped.
+ *
+ *	The reported cursor is the state extrapolated a configurable time
+ *	ahead, which hides part of the Bluetooth and rendering latency.  When
+ *	the dots disappear the track coasts on its velocity for up to
+ *	IR_TRACKER_MAX_COAST_US instead of snapping to 0; a measurement far
+ *	outside the predicted uncertainty restarts that axis at the new value.
+ */
+
+#include "ir_tracker.h"
+
+#include <math.h>   /* for fabsf, lroundf */
+#include <string.h> /* for memset */
+
+/* report period assumed when the timestamps do not advance (100 Hz) */
+#define IR_TRACKER_DEFAULT_DT 0.01f
+
+/* longer gaps are predicted as this long */
+#define IR_TRACKER_MAX_DT 0.1f
+
+/* how long a track survives without dots */
+#define IR_TRACKER_MAX_COAST_US 200000
+
+/* longest look-ahead accepted by wiiuse_set_ir_tracker() */
+#define IR_TRACKER_MAX_LOOKAHEAD_MS 200.0f
+
+/* default measurement variance, pixels^2 (sigma of 1.5 camera pixels) */
+#define IR_TRACKER_MEAS_NOISE 2.25f
+
+/* default process noise: acceleration (px^2/s^3) resp. jerk (px^2/s^5) density */
+#define IR_TRACKER_CV_NOISE 4.0e5f
+#define IR_TRACKER_CA_NOISE 4.0e7f
+
+/* a single dot places the cursor less precisely than a pair */
+#define IR_TRACKER_ONE_DOT_NOISE_SCALE 4.0f
+
+/* initial velocity (px/s) and acceleration (px/s^2) standard deviations */
+#define IR_TRACKER_INIT_VEL 1000.0f
+#define IR_TRACKER_INIT_ACC 10000.0f
+
+/* innovations beyond this many standard deviations restart the axis */
+#define IR_TRACKER_GATE 6.0f
+
+/* largest distance (camera pixels) a dot may be from its track to match, grows while it is missed */
+#define IR_DOT_GATE 48.0f
+#define IR_DOT_GATE_PER_MISS 16.0f
+
+/* reports a track survives without its dot */
+#define IR_DOT_MAX_MISSED 20
+
+/* when picking the sensor bar pair, cost of a dot that was never ordered */
+#define IR_DOT_NEW_COST 0.5f
+
+/* all orderings of 4 dots, for the assignment here and in ir_pose.c */
+const byte wiiuse_permutations4[24][4] = {
+    {0, 1, 2, 3}, {0, 1, 3, 2}, {0, 2, 1, 3}, {0, 2, 3, 1}, {0, 3, 1, 2}, {0, 3, 2, 1},
+    {1, 0, 2, 3}, {1, 0, 3, 2}, {1, 2, 0, 3}, {1, 2, 3, 0}, {1, 3, 0, 2}, {1, 3, 2, 0},
+    {2, 0, 1, 3}, {2, 0, 3, 1}, {2, 1, 0, 3}, {2, 1, 3, 0}, {2, 3, 0, 1}, {2, 3, 1, 0},
+    {3, 0, 1, 2}, {3, 0, 2, 1}, {3, 1, 0, 2}, {3, 1, 2, 0}, {3, 2, 0, 1}, {3, 2, 1, 0}};
+
+/* how badly a pair of dots fits a horizontal bar of two equal sources, lower is better */
+static float pair_cost(const struct ir_dot_t *a, const struct ir_dot_t *b, const struct ir_dot_track_t *ta,
+                       const struct ir_dot_track_t *tb)
+{
+    float dx   = fabsf((float)a->x - (float)b->x);
+    float dy   = fabsf((float)a->y - (float)b->y);
+    float cost = dy / (dx > 1.0f ? dx : 1.0f);
+
+    /* sizes are only known in extended mode */
+    cost += fabsf((float)a->size - (float)b->size) / 15.0f;
+    cost += (ta->order ? 0.0f : IR_DOT_NEW_COST) + (tb->order ? 0.0f : IR_DOT_NEW_COST);
+    return cost;
+}
+
+/* how badly a single dot fits a real source, lower is better */
+static float dot_cost(const struct ir_dot_t *d, const struct ir_dot_track_t *t)
+{
+    return (15.0f - (float)d->size) / 15.0f + (t->order ? 0.0f : IR_DOT_NEW_COST);
+}
+
+/* match the visible dots to the tracks, track[i] receives the index of its dot or -1 */
+static void assign_dots(struct ir_tracker_t *tr, const struct ir_dot_t *dot, int *track_dot)
+{
+    float cost[4][4];
+    float best = -1.0f;
+    int t, d, p, best_p = 0;
+
+    for (t = 0; t < 4; ++t)
+    {
+        const struct ir_dot_track_t *trk = &tr->dots[t];
+        float gate = IR_DOT_GATE + IR_DOT_GATE_PER_MISS * trk->missed;
+        float px   = trk->x + trk->vx * (trk->missed + 1);
+        float py   = trk->y + trk->vy * (trk->missed + 1);
+
+        for (d = 0; d < 4; ++d)
+        {
+            float dx = (float)dot[d].rx - px;
+            float dy = (float)dot[d].ry - py;
+
+            cost[t][d] = -1.0f;
+            if (trk->id && dot[d].visible && dx * dx + dy * dy <= gate * gate)
+            {
+                cost[t][d] = dx * dx + dy * dy;
+            }
+        }
+    }
+
+    for (p = 0; p < 24; ++p)
+    {
+        float total = 0.0f;
+        for (t = 0; t < 4; ++t)
+        {
+            float c = cost[t][wiiuse_permutations4[p][t]];
+            /* an unmatched dot or track costs as much as the widest match */
+            total += (c < 0.0f) ? IR_DOT_GATE * IR_DOT_GATE : c;
+        }
+        if (best < 0.0f || total < best)
+        {
+            best   = total;
+            best_p = p;
+        }
+    }
+
+    for (t = 0; t < 4; ++t)
+    {
+        d            = wiiuse_permutations4[best_p][t];
+        track_dot[t] = (cost[t][d] < 0.0f) ? -1 : d;
+    }
+}
+
+/**
+ *	@brief Follow the IR dots from the previous reports.
+ *
+ *	@param wm		Pointer to a wiimote_t structure, with the dots of this
+ *					report decoded and rotated (dot.x, dot.y).
+ *
+ *	@return 1 if the dots were reordered because a new source appeared.
+ *
+ *	Sets dot.id and dot.order.  Dots taken for reflections get dot.rejected
+ *	and are made invisible.
+ */
+int ir_track_dots(struct wiimote_t *wm)
+{
+    struct ir_tracker_t *tr = wm->ir_tracker;
+    struct ir_dot_t *dot    = wm->ir.dot;
+    struct ir_dot_track_t *dot_track[4] = {NULL, NULL, NULL, NULL};
+    int track_dot[4];
+    int i, j, visible = 0, reorder = 0;
+
+    if (!tr)
+    {
+        return 0;
+    }
+
+    assign_dots(tr, dot, track_dot);
+
+    /* update the matched tracks, age the others */
+    for (i = 0; i < 4; ++i)
+    {
+        struct ir_dot_track_t *trk = &tr->dots[i];
+
+        if (!trk->id)
+        {
+            continue;
+        }
+        if (track_dot[i] < 0)
+        {
+            if (++trk->missed > IR_DOT_MAX_MISSED)
+            {
+                memset(trk, 0, sizeof(*trk));
+            }
+            continue;
+        }
+
+        j       = track_dot[i];
+        trk->vx = 0.5f * trk->vx + 0.5f * ((float)dot[j].rx - trk->x) / (trk->missed + 1);
+        trk->vy = 0.5f * trk->vy + 0.5f * ((float)dot[j].ry - trk->y) / (trk->missed + 1);
+        trk->x  = dot[j].rx;
+        trk->y  = dot[j].ry;
+        trk->missed  = 0;
+        dot_track[j] = trk;
+    }
+
+    /* new sources start new tracks */
+    for (j = 0; j < 4; ++j)
+    {
+        dot[j].id       = 0;
+        dot[j].rejected = 0;
+        if (!dot[j].visible)
+        {
+            continue;
+        }
+        if (!dot_track[j])
+        {
+            int stale = -1;
+
+            /* a free track, else the one missed the longest (one is, as there are at most 4 dots) */
+            for (i = 0; i < 4 && tr->dots[i].id; ++i)
+            {
+                if (tr->dots[i].missed && (stale < 0 || tr->dots[i].missed > tr->dots[stale].missed))
+                {
+                    stale = i;
+                }
+            }
+            if (i == 4)
+            {
+                i = stale;
+            }
+            if (!++tr->next_id)
+            {
+                ++tr->next_id;
+            }
+            memset(&tr->dots[i], 0, sizeof(tr->dots[i]));
+            tr->dots[i].id = tr->next_id;
+            tr->dots[i].x  = dot[j].rx;
+            tr->dots[i].y  = dot[j].ry;
+            dot_track[j]   = &tr->dots[i];
+        }
+        dot[j].id = dot_track[j]->id;
+        ++visible;
+    }
+
+    /* keep the dots that fit the expected sources best */
+    if (tr->sources > 0 && visible > tr->sources)
+    {
+        int keep[4] = {0, 0, 0, 0};
+
+        if (tr->sources == 2)
+        {
+            float best = -1.0f;
+            int a = 0, b = 0;
+
+            for (i = 0; i < 4; ++i)
+            {
+                for (j = i + 1; j < 4; ++j)
+                {
+                    float c;
+                    if (!dot[i].visible || !dot[j].visible)
+                    {
+                        continue;
+                    }
+                    c = pair_cost(&dot[i], &dot[j], dot_track[i], dot_track[j]);
+                    if (best < 0.0f || c < best)
+                    {
+                        best = c;
+                        a    = i;
+                        b    = j;
+                    }
+                }
+            }
+            keep[a] = keep[b] = 1;
+        } else
+        {
+            int n;
+            for (n = 0; n < tr->sources; ++n)
+            {
+                int pick = -1;
+                for (i = 0; i < 4; ++i)
+                {
+                    if (dot[i].visible && !keep[i]
+                        && (pick < 0 || dot_cost(&dot[i], dot_track[i]) < dot_cost(&dot[pick], dot_track[pick])))
+                    {
+                        pick = i;
+                    }
+                }
+                keep[pick] = 1;
+            }
+        }
+
+        for (i = 0; i < 4; ++i)
+        {
+            if (dot[i].visible && !keep[i])
+            {
+                dot[i].visible  = 0;
+                dot[i].rejected = 1;
+                dot[i].order    = 0;
+                dot_track[i]->order = 0;
+            }
+        }
+    }
+
+    /* a source never ordered is in view: order all visible ones left to right */
+    for (j = 0; j < 4; ++j)
+    {
+        if (dot[j].visible && !dot_track[j]->order)
+        {
+            reorder = 1;
+        }
+    }
+    if (reorder)
+    {
+        byte order = 0;
+
+        for (i = 0; i < 4; ++i)
+        {
+            tr->dots[i].order = 0;
+        }
+        for (;;)
+        {
+            int left = -1;
+            for (j = 0; j < 4; ++j)
+            {
+                if (dot[j].visible && !dot_track[j]->order && (left < 0 || dot[j].x < dot[left].x))
+                {
+                    left = j;
+                }
+            }
+            if (left < 0)
+            {
+                break;
+            }
+            dot_track[left]->order = ++order;
+        }
+    }
+
+    for (j = 0; j < 4; ++j)
+    {
+        dot[j].order = dot[j].visible ? dot_track[j]->order : 0;
+    }
+
+    return reorder;
+}
+
+static void axis_init(struct ir_tracker_t *tr, int axis, float pos, float r)
+{
+    memset(tr->x[axis], 0, sizeof(tr->x[axis]));
+    memset(tr->P[axis], 0, sizeof(tr->P[axis]));
+
+    tr->x[axis][0]    = pos;
+    tr->P[axis][0][0] = r;
+    tr->P[axis][1][1] = IR_TRACKER_INIT_VEL * IR_TRACKER_INIT_VEL;
+    if (tr->model == WIIUSE_IR_TRACKER_CA)
+    {
+        tr->P[axis][2][2] = IR_TRACKER_INIT_ACC * IR_TRACKER_INIT_ACC;
+    }
+}
+
+/* x = F x, P = F P F' + Q */
+static void axis_predict(struct ir_tracker_t *tr, int axis, int n, float dt, float q)
+{
+    float F[WIIUSE_IR_TRACKER_STATES][WIIUSE_IR_TRACKER_STATES] = {
+        {1.0f, dt, 0.5f * dt * dt}, {0.0f, 1.0f, dt}, {0.0f, 0.0f, 1.0f}};
+    float Q[WIIUSE_IR_TRACKER_STATES][WIIUSE_IR_TRACKER_STATES];
+    float FP[WIIUSE_IR_TRACKER_STATES][WIIUSE_IR_TRACKER_STATES];
+    float x[WIIUSE_IR_TRACKER_STATES];
+    float dt2 = dt * dt, dt3 = dt2 * dt;
+    float *s  = tr->x[axis];
+    int i, j, k;
+
+    if (n == 2)
+    {
+        /* white noise acceleration */
+        Q[0][0] = q * dt3 / 3.0f;
+        Q[0][1] = Q[1][0] = q * dt2 / 2.0f;
+        Q[1][1]           = q * dt;
+    } else
+    {
+        /* white noise jerk */
+        Q[0][0] = q * dt3 * dt2 / 20.0f;
+        Q[0][1] = Q[1][0] = q * dt2 * dt2 / 8.0f;
+        Q[0][2] = Q[2][0] = q * dt3 / 6.0f;
+        Q[1][1]           = q * dt3 / 3.0f;
+        Q[1][2] = Q[2][1] = q * dt2 / 2.0f;
+        Q[2][2]           = q * dt;
+    }
+
+    for (i = 0; i < n; ++i)
+    {
+        x[i] = 0.0f;
+        for (k = i; k < n; ++k)
+        {
+            x[i] += F[i][k] * s[k];
+        }
+        for (j = 0; j < n; ++j)
+        {
+            FP[i][j] = 0.0f;
+            for (k = i; k < n; ++k)
+            {
+                FP[i][j] += F[i][k] * tr->P[axis][k][j];
+            }
+        }
+    }
+    for (i = 0; i < n; ++i)
+    {
+        s[i] = x[i];
+        for (j = 0; j < n; ++j)
+        {
+            float v = Q[i][j];
+            for (k = j; k < n; ++k)
+            {
+                v += FP[i][k] * F[j][k];
+            }
+            tr->P[axis][i][j] = v;
+        }
+    }
+}
+
+/* measurement of the position with variance r */
+static void axis_update(struct ir_tracker_t *tr, int axis, int n, float z, float r)
+{
+    float(*P)[WIIUSE_IR_TRACKER_STATES] = tr->P[axis];
+    float K[WIIUSE_IR_TRACKER_STATES];
+    float P0[WIIUSE_IR_TRACKER_STATES];
+    float y = z - tr->x[axis][0];
+    float S = P[0][0] + r;
+    int i, j;
+
+    if (y * y > IR_TRACKER_GATE * IR_TRACKER_GATE * S)
+    {
+        /* too far from the prediction to be the same motion */
+        axis_init(tr, axis, z, r);
+        return;
+    }
+
+    for (i = 0; i < n; ++i)
+    {
+        K[i]  = P[i][0] / S;
+        P0[i] = P[0][i];
+    }
+    for (i = 0; i < n; ++i)
+    {
+        tr->x[axis][i] += K[i] * y;
+        for (j = 0; j < n; ++j)
+        {
+            P[i][j] -= K[i] * P0[j];
+        }
+    }
+}
+
+/* position of an axis \a t seconds after the state time */
+static float axis_extrapolate(const struct ir_tracker_t *tr, int axis, float t)
+{
+    const float *s = tr->x[axis];
+    return s[0] + s[1] * t + 0.5f * s[2] * t * t;
+}
+
+/**
+ *	@brief Forget the current track, e.g. when the IR camera is turned off.
+ *
+ *	@param wm		Pointer to a wiimote_t structure.
+ */
+void ir_tracker_reset(struct wiimote_t *wm)
+{
+    if (wm->ir_tracker)
+    {
+        wm->ir_tracker->active = 0;
+        memset(wm->ir_tracker->dots, 0, sizeof(wm->ir_tracker->dots));
+    }
+    wm->ir.coasting = 0;
+    wm->ir.vx       = 0.0f;
+    wm->ir.vy       = 0.0f;
+}
+
+/**
+ *	@brief Track the IR cursor just decoded by interpret_ir_data().
+ *
+ *	@param wm		Pointer to a wiimote_t structure.
+ *
+ *	@return 1 if ir.ax, ir.ay and ir.z were replaced by the tracked and
+ *			predicted cursor, 0 if the tracker is off or has no track.
+ *
+ *	Sets ir.vx, ir.vy and ir.coasting.
+ */
+int ir_tracker_update(struct wiimote_t *wm)
+{
+    struct ir_tracker_t *tr = wm->ir_tracker;
+    uint64_t now            = wm->timestamp_us;
+    int has_xy              = (wm->ir.num_dots > 0);
+    int has_z               = (wm->ir.num_dots > 1);
+    float meas[3]           = {(float)wm->ir.ax, (float)wm->ir.ay, wm->ir.z};
+    float r, q, dt;
+    int n, i;
+
+    wm->ir.coasting = 0;
+
+    if (!tr || tr->model == WIIUSE_IR_TRACKER_OFF)
+    {
+        return 0;
+    }
+
+    n = (tr->model == WIIUSE_IR_TRACKER_CA) ? 3 : 2;
+    r = (tr->meas_noise > 0.0f) ? tr->meas_noise : IR_TRACKER_MEAS_NOISE;
+    q = (tr->accel_noise > 0.0f) ? tr->accel_noise
+                                 : ((n == 3) ? IR_TRACKER_CA_NOISE : IR_TRACKER_CV_NOISE);
+    if (wm->ir.num_dots == 1)
+    {
+        r *= IR_TRACKER_ONE_DOT_NOISE_SCALE;
+    }
+
+    if (tr->active && !has_xy && (now < tr->seen_us || now - tr->seen_us > IR_TRACKER_MAX_COAST_US))
+    {
+        /* lost for too long */
+        tr->active = 0;
+    }
+
+    if (!tr->active)
+    {
+        if (!has_xy)
+        {
+            return 0;
+        }
+
+        for (i = 0; i < 3; ++i)
+        {
+            axis_init(tr, i, meas[i], r);
+        }
+        tr->active  = 1;
+        tr->last_us = now;
+        tr->seen_us = now;
+    } else
+    {
+        if (tr->last_us && now > tr->last_us)
+        {
+            dt = (float)(now - tr->last_us) * 1e-6f;
+            if (dt > IR_TRACKER_MAX_DT)
+            {
+                dt = IR_TRACKER_MAX_DT;
+            }
+        } else
+        {
+            dt = IR_TRACKER_DEFAULT_DT;
+        }
+        tr->last_us = now;
+
+        for (i = 0; i < 3; ++i)
+        {
+            axis_predict(tr, i, n, dt, q);
+        }
+
+        if (has_xy)
+        {
+            tr->seen_us = now;
+            axis_update(tr, 0, n, meas[0], r);
+            axis_update(tr, 1, n, meas[1], r);
+            if (has_z)
+            {
+                axis_update(tr, 2, n, meas[2], r);
+            }
+        } else
+        {
+            /* coast on the velocity alone */
+            for (i = 0; i < 3; ++i)
+            {
+                tr->x[i][2] = 0.0f;
+            }
+            wm->ir.coasting = 1;
+        }
+    }
+
+    wm->ir.ax = (int)lroundf(axis_extrapolate(tr, 0, tr->lookahead));
+    wm->ir.ay = (int)lroundf(axis_extrapolate(tr, 1, tr->lookahead));
+    wm->ir.z  = axis_extrapolate(tr, 2, tr->lookahead);
+    wm->ir.vx = tr->x[0][1];
+    wm->ir.vy = tr->x[1][1];
+
+    return 1;
+}
+
+/**
+ *	@brief Enable or disable the IR cursor tracker.
+ *
+ *	@param wm			Pointer to a wiimote_t structure.
+ *	@param model		WIIUSE_IR_TRACKER_CV or WIIUSE_IR_TRACKER_CA to track
+ *						the cursor, WIIUSE_IR_TRACKER_OFF for the raw cursor.
+ *	@param lookahead_ms	How far ahead to predict the cursor, 0 to 200 ms.
+ *						Set it to the latency to hide, e.g. 10-20 ms of
+ *						Bluetooth plus a frame of rendering.
+ *
+ *	While tracking, ir.ax, ir.ay, ir.z, ir.x, ir.y and the IR yaw are
+ *	filtered and predicted, and ir.vx / ir.vy hold the cursor velocity.
+ *	When the dots disappear, ir.num_dots drops to 0 but the cursor keeps
+ *	moving with ir.coasting set, for up to 200 ms.
+ *
+ *	The constant velocity model lags less during steady moves; the
+ *	constant acceleration model follows changes of direction faster but
+ *	overshoots more, especially with a long look-ahead.
+ */
+void wiiuse_set_ir_tracker(struct wiimote_t *wm, enum ir_tracker_model_t model, float lookahead_ms)
+{
+    struct ir_tracker_t *tr;
+
+    if (!wm || !wm->ir_tracker)
+    {
+        return;
+    }
+    tr = wm->ir_tracker;
+
+    if (lookahead_ms < 0.0f)
+    {
+        lookahead_ms = 0.0f;
+    } else if (lookahead_ms > IR_TRACKER_MAX_LOOKAHEAD_MS)
+    {
+        WIIUSE_WARNING("IR tracker look-ahead %.0f ms is too long, using %.0f ms.", lookahead_ms,
+                       IR_TRACKER_MAX_LOOKAHEAD_MS);
+        lookahead_ms = IR_TRACKER_MAX_LOOKAHEAD_MS;
+    }
+
+    tr->model     = model;
+    tr->lookahead = lookahead_ms * 1e-3f;
+    ir_tracker_reset(wm);
+
+    WIIUSE_DEBUG("IR tracker model %i, look-ahead %.0f ms (unid %i)", model, lookahead_ms, wm->unid);
+}
+
+/**
+ *	@brief Tune the IR cursor tracker.
+ *
+ *	@param wm			Pointer to a wiimote_t structure.
+ *	@param accel_noise	Process noise density: acceleration for the
+ *						constant velocity model (px^2/s^3, default 4e5),
+ *						jerk for the constant acceleration model (px^2/s^5,
+ *						default 4e7).  Higher follows faster, lower smooths
+ *						more.  0 selects the default.
+ *	@param meas_noise	Variance of a measured cursor in camera pixels^2,
+ *						default 2.25.  0 selects the default.
+ */
+void wiiuse_set_ir_tracker_noise(struct wiimote_t *wm, float accel_noise, float meas_noise)
+{
+    if (!wm || !wm->ir_tracker)
+    {
+        return;
+    }
+
+    wm->ir_tracker->accel_noise = (accel_noise > 0.0f) ? accel_noise : 0.0f;
+    wm->ir_tracker->meas_noise  = (meas_noise > 0.0f) ? meas_noise : 0.0f;
+}
+
+/**
+ *	@brief Set how many real IR sources to expect.
+ *
+ *	@param wm		Pointer to a wiimote_t structure.
+ *	@param sources	Number of sources, 2 for the sensor bar (the default),
+ *					or 0 to keep every dot the camera reports.
+ *
+ *	When more dots are seen, the extra ones are taken for reflections:
+ *	they are marked rejected and treated as invisible.  For two sources
+ *	the pair that is the most level after roll correction, closest in
+ *	size and already tracked wins; otherwise the largest, already tracked
+ *	dots are kept.
+ */
+void wiiuse_set_ir_sources(struct wiimote_t *wm, int sources)
+{
+    if (!wm || !wm->ir_tracker)
+    {
+        return;
+    }
+
+    if (sources < 0 || sources > 4)
+    {
+        WIIUSE_WARNING("Invalid number of IR sources %i, keeping every dot.", sources);
+        sources = 0;
+    }
+    wm->ir_tracker->sources = sources;
+}
@@ -0,0 +1,53 @@
+/*
+ *	wiiuse
+ *
+ *	Written By:
+ *		Melodea Research	< melodea-research/wiimote-bridge >
+ *
+ *	Copyright 2026
+ *
+ *	This file is part of wiiuse.
+ *
+ *	This program is free software; you can redistribute it and/or modify
+ *	it under the terms of the GNU General Public License as published by
+ *	the Free Software Foundation; either version 3 of the License, or
+ *	(at your option) any later version.
+ *
+ *	This program is distributed in the hope that it will be useful,
+ *	but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *	GNU General Public License for more details.
+ *
+ *	You should have received a copy of the GNU General Public License
+ *	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *	$Header$
+ *
+ */
+
+/**
+ *	@file
+ *	@brief IR cursor tracker.
+ */
+
+#ifndef IR_TRACKER_H_INCLUDED
+#define IR_TRACKER_H_INCLUDED
+
+#include "wiiuse_internal.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** @defgroup internal_ir_tracker Internal: IR Tracker */
+/** @{ */
+int ir_track_dots(struct wiimote_t *wm);
+int ir_tracker_update(struct wiimote_t *wm);
+void ir_tracker_reset(struct wiimote_t *wm);
+/** @} */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* IR_TRACKER_H_INCLUDED */
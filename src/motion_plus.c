@@ -32,15 +32,31 @@
 
 #include "dynamics.h" /* for calc_joystick_state, etc */
 #include "events.h"   /* for disable_expansion */
+#include "fusion.h"   /* for fusion_reset */
 #include "io.h"       /* for wiiuse_read */
 #include "ir.h"       /* for wiiuse_set_ir_mode */
 #include "nunchuk.h"  /* for nunchuk_pressed_buttons */
 
-#include <math.h>   /* for fabs */
+#include <math.h>   /* for fabs, lroundf */
 #include <string.h> /* for memset */
 
+/*
+ *	Stillness thresholds of the bias estimator, over a window of
+ *	WIIUSE_GYRO_BIAS_WINDOW frames:
+ *	- gyro standard deviation below 5 raw counts (0.25 deg/s in slow mode)
+ *	- accelerometer standard deviation below 5% of 1g on every axis
+ *	Once converged, a still window may move the bias by at most 2 deg/s
+ *	(40 counts) so a slow, steady turn is not mistaken for drift, and it
+ *	moves it by GYRO_BIAS_ALPHA of the difference per frame.
+ */
+#define GYRO_STILL_VAR 25
+#define ACCEL_STILL_STDDEV 0.05f
+#define GYRO_BIAS_MAX_STEP 40.0f
+#define GYRO_BIAS_ALPHA 0.02f
+
 static void wiiuse_calibrate_motion_plus(struct motion_plus_t *mp);
 static void calculate_gyro_rates(struct motion_plus_t *mp);
+static void reset_bias_window(struct gyro_bias_t *est);
 
 void wiiuse_probe_motion_plus(struct wiimote_t *wm)
 {
@@ -88,6 +104,9 @@ void wiiuse_probe_motion_plus(struct wiimote_t *wm)
     wm->exp.mp.cal_gyro.roll      = 0;
     wm->exp.mp.cal_gyro.pitch     = 0;
     wm->exp.mp.cal_gyro.yaw       = 0;
+    wm->exp.mp.bias_gyro.roll     = 0.0f;
+    wm->exp.mp.bias_gyro.pitch    = 0.0f;
+    wm->exp.mp.bias_gyro.yaw      = 0.0f;
     wm->exp.mp.orient.roll        = 0.0;
     wm->exp.mp.orient.pitch       = 0.0;
     wm->exp.mp.orient.yaw         = 0.0;
@@ -95,6 +114,7 @@ void wiiuse_probe_motion_plus(struct wiimote_t *wm)
 
     wm->exp.mp.nc         = &(wm->exp.nunchuk);
     wm->exp.mp.classic    = &(wm->exp.classic);
+    wm->exp.mp.bias_est   = wm->gyro_bias;
     wm->exp.nunchuk.flags = &wm->flags;
 
     wm->exp.mp.ext = 0;
@@ -150,6 +170,9 @@ void wiiuse_motion_plus_handshake(struct wiimote_t *wm, byte *data, unsigned sho
             wm->exp.mp.cal_gyro.roll      = 0;
             wm->exp.mp.cal_gyro.pitch     = 0;
             wm->exp.mp.cal_gyro.yaw       = 0;
+            wm->exp.mp.bias_gyro.roll     = 0.0f;
+            wm->exp.mp.bias_gyro.pitch    = 0.0f;
+            wm->exp.mp.bias_gyro.yaw      = 0.0f;
             wm->exp.mp.orient.roll        = 0.0;
             wm->exp.mp.orient.pitch       = 0.0;
             wm->exp.mp.orient.yaw         = 0.0;
@@ -157,6 +180,7 @@ void wiiuse_motion_plus_handshake(struct wiimote_t *wm, byte *data, unsigned sho
 
             wm->exp.mp.nc         = &(wm->exp.nunchuk);
             wm->exp.mp.classic    = &(wm->exp.classic);
+            wm->exp.mp.bias_est   = wm->gyro_bias;
             wm->exp.nunchuk.flags = &wm->flags;
 
             wm->exp.mp.ext = 0;
@@ -241,7 +265,12 @@ void motion_plus_disconnected(struct motion_plus_t *mp)
     memset(mp, 0, sizeof(struct motion_plus_t));
 }
 
-void motion_plus_event(struct motion_plus_t *mp, int exp_type, byte *msg)
+/**
+ *      @brief Handle Motion+ data.
+ *
+ *      @return 1 if \a msg was a gyro frame, 0 if it was pass-through data.
+ */
+int motion_plus_event(struct motion_plus_t *mp, int exp_type, byte *msg)
 {
     /*
      * Pass-through modes interleave data from the gyro
@@ -270,6 +299,7 @@ void motion_plus_event(struct motion_plus_t *mp, int exp_type, byte *msg)
 
         /* Calculate angular rates in deg/sec and performs some simple filtering */
         calculate_gyro_rates(mp);
+        return 1;
     }
 
     else
@@ -307,6 +337,7 @@ void motion_plus_event(struct motion_plus_t *mp, int exp_type, byte *msg)
             WIIUSE_ERROR("Unsupported mode passed to motion_plus_event() !\n");
         }
     }
+    return 0;
 }
 
 /**
@@ -319,64 +350,230 @@ void motion_plus_event(struct motion_plus_t *mp, int exp_type, byte *msg)
  */
 void wiiuse_calibrate_motion_plus(struct motion_plus_t *mp)
 {
-    mp->cal_gyro.roll  = mp->raw_gyro.roll;
-    mp->cal_gyro.pitch = mp->raw_gyro.pitch;
-    mp->cal_gyro.yaw   = mp->raw_gyro.yaw;
+    mp->cal_gyro.roll   = mp->raw_gyro.roll;
+    mp->cal_gyro.pitch  = mp->raw_gyro.pitch;
+    mp->cal_gyro.yaw    = mp->raw_gyro.yaw;
+    mp->bias_gyro.roll  = mp->raw_gyro.roll;
+    mp->bias_gyro.pitch = mp->raw_gyro.pitch;
+    mp->bias_gyro.yaw   = mp->raw_gyro.yaw;
+    if (mp->bias_est)
+    {
+        reset_bias_window(mp->bias_est);
+        mp->bias_est->converged   = 0;
+        mp->bias_est->recalibrate = 0;
+    }
     mp->orient.roll    = 0.0;
     mp->orient.pitch   = 0.0;
     mp->orient.yaw     = 0.0;
+    fusion_reset(mp);
 }
 
 static void calculate_gyro_rates(struct motion_plus_t *mp)
 {
-    short int tmp_r, tmp_p, tmp_y;
+    float tmp_r, tmp_p, tmp_y;
     float tmp_roll, tmp_pitch, tmp_yaw;
 
     /* We consider calibration data */
-    tmp_r = mp->raw_gyro.roll - mp->cal_gyro.roll;
-    tmp_p = mp->raw_gyro.pitch - mp->cal_gyro.pitch;
-    tmp_y = mp->raw_gyro.yaw - mp->cal_gyro.yaw;
+    tmp_r = (float)mp->raw_gyro.roll - mp->bias_gyro.roll;
+    tmp_p = (float)mp->raw_gyro.pitch - mp->bias_gyro.pitch;
+    tmp_y = (float)mp->raw_gyro.yaw - mp->bias_gyro.yaw;
 
     /* We convert to degree/sec according to fast/slow mode */
     if (mp->acc_mode & 0x04)
     {
-        tmp_roll = (float)tmp_r / 20.0f;
+        tmp_roll = tmp_r / 20.0f;
     } else
     {
-        tmp_roll = (float)tmp_r / 4.0f;
+        tmp_roll = tmp_r / 4.0f;
     }
 
     if (mp->acc_mode & 0x02)
     {
-        tmp_pitch = (float)tmp_p / 20.0f;
+        tmp_pitch = tmp_p / 20.0f;
     } else
     {
-        tmp_pitch = (float)tmp_p / 4.0f;
+        tmp_pitch = tmp_p / 4.0f;
     }
 
     if (mp->acc_mode & 0x01)
     {
-        tmp_yaw = (float)tmp_y / 20.0f;
+        tmp_yaw = tmp_y / 20.0f;
     } else
     {
-        tmp_yaw = (float)tmp_y / 4.0f;
+        tmp_yaw = tmp_y / 4.0f;
     }
 
-    /* Simple filtering */
-    if (fabs(tmp_roll) < 0.5f)
+    /*
+     * Simple filtering, hiding the error of the one-shot calibration until
+     * the bias estimator has seen the remote lie still
+     */
+    if (!mp->bias_est || !mp->bias_est->converged)
     {
-        tmp_roll = 0.0f;
+        if (fabs(tmp_roll) < 0.5f)
+        {
+            tmp_roll = 0.0f;
+        }
+        if (fabs(tmp_pitch) < 0.5f)
+        {
+            tmp_pitch = 0.0f;
+        }
+        if (fabs(tmp_yaw) < 0.5f)
+        {
+            tmp_yaw = 0.0f;
+        }
     }
-    if (fabs(tmp_pitch) < 0.5f)
+
+    mp->angle_rate_gyro.roll  = tmp_roll;
+    mp->angle_rate_gyro.pitch = tmp_pitch;
+    mp->angle_rate_gyro.yaw   = tmp_yaw;
+}
+
+static void reset_bias_window(struct gyro_bias_t *est)
+{
+    memset(est->gyro_sum, 0, sizeof(est->gyro_sum));
+    memset(est->gyro_sq, 0, sizeof(est->gyro_sq));
+    memset(est->accel_sum, 0, sizeof(est->accel_sum));
+    memset(est->accel_sq, 0, sizeof(est->accel_sq));
+    est->head  = 0;
+    est->count = 0;
+}
+
+/* variance of a window times n^2, exact in integers */
+static int64_t window_var_n2(int64_t sum, int64_t sq, int64_t n)
+{
+    return n * sq - sum * sum;
+}
+
+/**
+ *	@brief Refine the gyro zero rate while the remote is still.
+ *
+ *	@param wm		Pointer to a wiimote_t structure with Motion Plus.
+ *
+ *	Called for every gyro frame.  Keeps the last WIIUSE_GYRO_BIAS_WINDOW
+ *	frames of raw gyro and accelerometer data.  When the window is full,
+ *	every frame is in slow mode and both sensors are quiet, the remote is
+ *	taken to be still and the window mean is blended into
+ *	exp.mp.bias_gyro (cal_gyro follows, rounded).  The first still window
+ *	after calibration, or after wiiuse_recalibrate_motion_plus(), replaces
+ *	the bias outright, which fixes a calibration taken while moving.
+ */
+void motion_plus_track_bias(struct wiimote_t *wm)
+{
+    struct motion_plus_t *mp = &wm->exp.mp;
+    struct gyro_bias_t *est  = mp->bias_est;
+    const int16_t gyro[3]    = {mp->raw_gyro.roll, mp->raw_gyro.pitch, mp->raw_gyro.yaw};
+    const byte accel[3]      = {wm->accel.x, wm->accel.y, wm->accel.z};
+    const byte cal_g[3]      = {wm->accel_calib.cal_g.x, wm->accel_calib.cal_g.y, wm->accel_calib.cal_g.z};
+    float *bias[3]           = {&mp->bias_gyro.roll, &mp->bias_gyro.pitch, &mp->bias_gyro.yaw};
+    const int64_t n          = WIIUSE_GYRO_BIAS_WINDOW;
+    int use_acc              = WIIUSE_USING_ACC(wm);
+    int i;
+
+    if (!est)
     {
-        tmp_pitch = 0.0f;
+        return;
     }
-    if (fabs(tmp_yaw) < 0.5f)
+
+    /* a fast-mode axis is turning quickly, start over */
+    if ((mp->acc_mode & 0x07) != 0x07)
     {
-        tmp_yaw = 0.0f;
+        reset_bias_window(est);
+        return;
     }
 
-    mp->angle_rate_gyro.roll  = tmp_roll;
-    mp->angle_rate_gyro.pitch = tmp_pitch;
-    mp->angle_rate_gyro.yaw   = tmp_yaw;
+    if (est->count == WIIUSE_GYRO_BIAS_WINDOW)
+    {
+        for (i = 0; i < 3; ++i)
+        {
+            int64_t g = est->gyro[est->head][i];
+            int32_t a = est->accel[est->head][i];
+
+            est->gyro_sum[i] -= g;
+            est->gyro_sq[i] -= g * g;
+            est->accel_sum[i] -= a;
+            est->accel_sq[i] -= a * a;
+        }
+    } else
+    {
+        ++est->count;
+    }
+
+    for (i = 0; i < 3; ++i)
+    {
+        est->gyro[est->head][i]  = gyro[i];
+        est->accel[est->head][i] = accel[i];
+        est->gyro_sum[i] += gyro[i];
+        est->gyro_sq[i] += (int64_t)gyro[i] * gyro[i];
+        est->accel_sum[i] += accel[i];
+        est->accel_sq[i] += (int32_t)accel[i] * accel[i];
+    }
+    est->head = (est->head + 1) % WIIUSE_GYRO_BIAS_WINDOW;
+
+    if (est->count < WIIUSE_GYRO_BIAS_WINDOW)
+    {
+        return;
+    }
+
+    for (i = 0; i < 3; ++i)
+    {
+        if (window_var_n2(est->gyro_sum[i], est->gyro_sq[i], n) > GYRO_STILL_VAR * n * n)
+        {
+            return;
+        }
+        if (use_acc && cal_g[i])
+        {
+            float limit = ACCEL_STILL_STDDEV * (float)cal_g[i] * (float)n;
+            if ((float)window_var_n2(est->accel_sum[i], est->accel_sq[i], n) > limit * limit)
+            {
+                return;
+            }
+        }
+    }
+
+    /* still: move the bias towards the window mean */
+    for (i = 0; i < 3; ++i)
+    {
+        float mean = (float)est->gyro_sum[i] / (float)n;
+
+        if (!est->converged || est->recalibrate)
+        {
+            *bias[i] = mean;
+        } else if (fabsf(mean - *bias[i]) <= GYRO_BIAS_MAX_STEP)
+        {
+            *bias[i] += GYRO_BIAS_ALPHA * (mean - *bias[i]);
+        }
+    }
+
+    if (!est->converged || est->recalibrate)
+    {
+        WIIUSE_DEBUG("Motion+ bias from still window: roll %.1f pitch %.1f yaw %.1f", mp->bias_gyro.roll,
+                     mp->bias_gyro.pitch, mp->bias_gyro.yaw);
+    }
+    est->converged   = 1;
+    est->recalibrate = 0;
+
+    mp->cal_gyro.roll  = (int16_t)lroundf(mp->bias_gyro.roll);
+    mp->cal_gyro.pitch = (int16_t)lroundf(mp->bias_gyro.pitch);
+    mp->cal_gyro.yaw   = (int16_t)lroundf(mp->bias_gyro.yaw);
+}
+
+/**
+ *	@brief Recalibrate the Motion Plus gyroscopes.
+ *
+ *	@param wm		Pointer to a wiimote_t structure with Motion Plus.
+ *
+ *	Hold the remote still.  The zero rate is replaced by the mean of the
+ *	current still window as soon as there is one, i.e. immediately if the
+ *	remote has already been still for WIIUSE_GYRO_BIAS_WINDOW frames.
+ *	The fused orientation is kept.
+ */
+void wiiuse_recalibrate_motion_plus(struct wiimote_t *wm)
+{
+    if (!wm || !wm->exp.mp.bias_est)
+    {
+        return;
+    }
+
+    WIIUSE_DEBUG("Motion+ recalibration requested.");
+    wm->exp.mp.bias_est->recalibrate = 1;
 }
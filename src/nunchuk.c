@@ -32,7 +32,7 @@
  */
 
 #include "nunchuk.h"
-#include "dynamics.h" /* for calc_joystick_state, etc */
+#include "dynamics.h" /* for calc_joystick_state, accel_build_lut, etc */
 #include "events.h"   /* for handshake_expansion */
 
 #include <stdlib.h> /* for malloc */
@@ -111,6 +111,9 @@ int nunchuk_handshake(struct wiimote_t *wm, struct nunchuk_t *nc, byte *data, un
         nc->js.max.y = 255;
     }
 
+    /* the second table set after the wiimote's belongs to the nunchuk */
+    accel_build_lut(&nc->accel_calib, wm->accel_lut ? &wm->accel_lut[1] : NULL);
+
     /* default the thresholds to the same as the wiimote */
     nc->orient_threshold = wm->orient_threshold;
     nc->accel_threshold  = wm->accel_threshold;
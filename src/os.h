@@ -51,11 +51,16 @@ int wiiuse_os_connect(struct wiimote_t **wm, int wiimotes);
 void wiiuse_os_disconnect(struct wiimote_t *wm);
 
 int wiiuse_os_poll(struct wiimote_t **wm, int wiimotes);
-/* buf[0] will be the report type, buf+1 the rest of the report */
+/* block until wm has input or timeout_ms (0 = forever) passes: >0 readable, 0 timeout, <0 error */
+int wiiuse_os_wait(struct wiimote_t *wm, unsigned long timeout_ms);
+/* buf[0] will be the report type, buf+1 the rest of the report; returns its length in bytes,
+   0 if there was none or the remote disconnected, <0 on error */
 int wiiuse_os_read(struct wiimote_t *wm, byte *buf, int len);
 int wiiuse_os_write(struct wiimote_t *wm, byte report_type, byte *buf, int len);
 
 unsigned long wiiuse_os_ticks();
+/* monotonic time in microseconds, used to timestamp input reports */
+uint64_t wiiuse_os_ticks_us();
 /** @} */
 
 #ifdef __cplusplus
@@ -46,3 +46,12 @@ unsigned long wiiuse_os_ticks() {
   	unsigned long ms = 1000 * ts.tv_sec + ts.tv_nsec / 1e6;
   	return ms;
 }
+
+uint64_t wiiuse_os_ticks_us() {
+	clock_serv_t cclock;
+	mach_timespec_t mts;
+	host_get_clock_service(mach_host_self(), SYSTEM_CLOCK, &cclock);
+	clock_get_time(cclock, &mts);
+	mach_port_deallocate(mach_task_self(), cclock);
+	return (uint64_t)mts.tv_sec * 1000000u + (uint64_t)mts.tv_nsec / 1000u;
+}
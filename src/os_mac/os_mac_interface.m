@@ -139,7 +139,7 @@ void wiiuse_os_disconnect(struct wiimote_t* wm) {
 #pragma mark poll, read, write
 
 int wiiuse_os_poll(struct wiimote_t** wm, int wiimotes) {
-	int i;
+	int i, r;
 	byte read_buffer[MAX_PAYLOAD];
 	int evnt = 0;
 	
@@ -151,7 +151,11 @@ int wiiuse_os_poll(struct wiimote_t** wm, int wiimotes) {
 		/* clear out the buffer */
 		memset(read_buffer, 0, sizeof(read_buffer));
 		/* read */
-		if (wiiuse_os_read(wm[i], read_buffer, sizeof(read_buffer))) {
+		r = wiiuse_os_read(wm[i], read_buffer, sizeof(read_buffer));
+		if (r > 0) {
+			wm[i]->timestamp_us = wiiuse_os_ticks_us();
+			wm[i]->raw_report_len = (byte)r;
+
 			/* propagate the event */
 			propagate_event(wm[i], read_buffer[0], read_buffer+1);
 		} else {
@@ -166,6 +170,13 @@ int wiiuse_os_poll(struct wiimote_t** wm, int wiimotes) {
 	return evnt;
 }
 
+int wiiuse_os_wait(struct wiimote_t* wm, unsigned long timeout_ms) {
+	(void)timeout_ms;
+	if(!wm || !wm->objc_wm || !WIIMOTE_IS_CONNECTED(wm)) return -1;
+	/* readBuffer already waits for incoming data on the run loop */
+	return 1;
+}
+
 int wiiuse_os_read(struct wiimote_t* wm, byte* buf, int len) {
 	if(!wm || !wm->objc_wm) return 0;
 	if(!WIIMOTE_IS_CONNECTED(wm)) {
@@ -44,6 +44,7 @@
 #include <bluetooth/l2cap.h>     /* for sockaddr_l2 */
 
 #include <errno.h>
+#include <poll.h> /* for poll */
 #include <stdbool.h>
 #include <stdio.h>      /* for perror */
 #include <string.h>     /* for memset */
@@ -256,6 +257,27 @@ static int wiiuse_os_connect_single(struct wiimote_t *wm, char *address)
     return 1;
 }
 
+int wiiuse_connect_socket(struct wiimote_t *wm, int sock)
+{
+    if (!wm || sock < 0 || WIIMOTE_IS_CONNECTED(wm))
+    {
+        return 0;
+    }
+
+    wm->out_sock = sock;
+    wm->in_sock  = sock;
+
+    WIIUSE_INFO("Attached socket %i to wiimote [id %i].", sock, wm->unid);
+
+    /* do the handshake */
+    WIIMOTE_ENABLE_STATE(wm, WIIMOTE_STATE_CONNECTED);
+    wiiuse_handshake(wm, NULL, 0);
+
+    wiiuse_set_report_type(wm);
+
+    return 1;
+}
+
 void wiiuse_os_disconnect(struct wiimote_t *wm)
 {
     if (!wm || WIIMOTE_IS_CONNECTED(wm))
@@ -264,7 +286,11 @@ void wiiuse_os_disconnect(struct wiimote_t *wm)
     }
 
     close(wm->out_sock);
-    close(wm->in_sock);
+    if (wm->in_sock != wm->out_sock)
+    {
+        /* see wiiuse_connect_socket() */
+        close(wm->in_sock);
+    }
 
     wm->out_sock = -1;
     wm->in_sock  = -1;
@@ -321,6 +347,11 @@ int wiiuse_os_poll(struct wiimote_t **wm, int wiimotes)
 
     if (select(highest_fd + 1, &fds, NULL, NULL, &tv) == -1)
     {
+        if (errno == EINTR)
+        {
+            /* a signal for the application, nothing to read */
+            return 0;
+        }
         WIIUSE_ERROR("Unable to select() the wiimote interrupt socket(s).");
         perror("Error Details");
         return 0;
@@ -347,6 +378,9 @@ int wiiuse_os_poll(struct wiimote_t **wm, int wiimotes)
             r = wiiuse_os_read(wm[i], read_buffer, sizeof(read_buffer));
             if (r > 0)
             {
+                wm[i]->timestamp_us   = wiiuse_os_ticks_us();
+                wm[i]->raw_report_len = (byte)r;
+
                 /* propagate the event */
                 propagate_event(wm[i], read_buffer[0], read_buffer + 1);
                 evnt += (wm[i]->event != WIIUSE_NONE);
@@ -370,6 +404,35 @@ int wiiuse_os_poll(struct wiimote_t **wm, int wiimotes)
     return evnt;
 }
 
+int wiiuse_os_wait(struct wiimote_t *wm, unsigned long timeout_ms)
+{
+    struct pollfd pfd;
+    int rc;
+
+    if (!WIIMOTE_IS_CONNECTED(wm))
+    {
+        return -1;
+    }
+
+    pfd.fd      = wm->in_sock;
+    pfd.events  = POLLIN;
+    pfd.revents = 0;
+
+    do
+    {
+        rc = poll(&pfd, 1, timeout_ms ? (int)timeout_ms : -1);
+    } while (rc == -1 && errno == EINTR);
+
+    if (rc == -1)
+    {
+        WIIUSE_ERROR("Unable to wait for wiimote data (id %i).", wm->unid);
+        perror("Error Details");
+    }
+
+    /* POLLHUP/POLLERR also count: the following read() reports the disconnect */
+    return rc;
+}
+
 int wiiuse_os_read(struct wiimote_t *wm, byte *buf, int len)
 {
     int rc;
@@ -399,6 +462,7 @@ int wiiuse_os_read(struct wiimote_t *wm, byte *buf, int len)
         /* read successful */
         /* on *nix we ignore the first byte */
         memmove(buf, buf + 1, len - 1);
+        --rc;
 
 /* log the received data */
 #ifdef WITH_WIIUSE_DEBUG
@@ -453,9 +517,17 @@ void wiiuse_cleanup_platform_fields(struct wiimote_t *wm)
 unsigned long wiiuse_os_ticks()
 {
     struct timespec tp;
-    clock_gettime(CLOCK_REALTIME, &tp);
+    /* monotonic, so timeouts are not affected by changes to the wall clock */
+    clock_gettime(CLOCK_MONOTONIC, &tp);
     unsigned long ms = 1000 * tp.tv_sec + tp.tv_nsec / 1e6;
     return ms;
 }
 
+uint64_t wiiuse_os_ticks_us()
+{
+    struct timespec tp;
+    clock_gettime(CLOCK_MONOTONIC, &tp);
+    return (uint64_t)tp.tv_sec * 1000000u + (uint64_t)tp.tv_nsec / 1000u;
+}
+
 #endif /* ifdef WIIUSE_BLUEZ */
@@ -60,6 +60,17 @@ unsigned long wiiuse_os_ticks()
     return hnsTime.QuadPart / 10000ULL;
 }
 
+uint64_t wiiuse_os_ticks_us()
+{
+    LARGE_INTEGER count, freq;
+
+    QueryPerformanceCounter(&count);
+    QueryPerformanceFrequency(&freq);
+
+    return (uint64_t)(count.QuadPart / freq.QuadPart) * 1000000ULL
+           + (uint64_t)(count.QuadPart % freq.QuadPart) * 1000000ULL / freq.QuadPart;
+}
+
 int wiiuse_os_find(struct wiimote_t **wm, int max_wiimotes, int timeout)
 {
     GUID device_id;
@@ -212,7 +223,7 @@ void wiiuse_os_disconnect(struct wiimote_t *wm)
 
 int wiiuse_os_poll(struct wiimote_t **wm, int wiimotes)
 {
-    int i;
+    int i, r;
     byte read_buffer[MAX_PAYLOAD];
     int evnt = 0;
 
@@ -228,8 +239,12 @@ int wiiuse_os_poll(struct wiimote_t **wm, int wiimotes)
         /* clear out the buffer */
         memset(read_buffer, 0, sizeof(read_buffer));
         /* read */
-        if (wiiuse_os_read(wm[i], read_buffer, sizeof(read_buffer)))
+        r = wiiuse_os_read(wm[i], read_buffer, sizeof(read_buffer));
+        if (r > 0)
         {
+            wm[i]->timestamp_us   = wiiuse_os_ticks_us();
+            wm[i]->raw_report_len = (byte)r;
+
             /* propagate the event */
             propagate_event(wm[i], read_buffer[0], read_buffer + 1);
             evnt += (wm[i]->event != WIIUSE_NONE);
@@ -244,6 +259,19 @@ int wiiuse_os_poll(struct wiimote_t **wm, int wiimotes)
     return evnt;
 }
 
+int wiiuse_os_wait(struct wiimote_t *wm, unsigned long timeout_ms)
+{
+    (void)timeout_ms;
+
+    if (!wm || !WIIMOTE_IS_CONNECTED(wm))
+    {
+        return -1;
+    }
+
+    /* the overlapped ReadFile in wiiuse_os_read() already blocks for up to wm->timeout */
+    return 1;
+}
+
 int wiiuse_os_read(struct wiimote_t *wm, byte *buf, int len)
 {
     DWORD b, r;
@@ -306,7 +334,7 @@ int wiiuse_os_read(struct wiimote_t *wm, byte *buf, int len)
     }
 
     ResetEvent(wm->hid_overlap.hEvent);
-    return 1;
+    return (int)b;
 }
 
 int wiiuse_os_write(struct wiimote_t *wm, byte report_type, byte *buf, int len)
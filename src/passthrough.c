@@ -0,0 +1,293 @@
+/*
+ *	wiiuse
+ *
+ *	Written By:
+ *		Melodea Research	< melodea-research/wiimote-bridge >
+ *
+ *	Copyright 2026
+ *
+ *	This file is part of wiiuse.
+ *
+ *	This program is free software; you can redistribute it and/or modify
+ *	it under the terms of the GNU General Public License as published by
+ *	the Free Software Foundation; either version 3 of the License, or
+ *	(at your option) any later version.
+ *
+ *	This program is distributed in the hope that it will be useful,
+ *	but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *	GNU General Public License for more details.
+ *
+ *	You should have received a copy of the GNU General Public License
+ *	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *	$Header$
+ *
+ */
+
+/**
+ *	@file
+ *	@brief Decoding reports forwarded by another host.
+ *
+ *	A host that only relays remotes (e.g. a small board next to the
+ *	Bluetooth adapter) sets WIIUSE_RAW_REPORTS: its data reports then only
+ *	update the buttons and are kept as read in wiimote_t.raw_report (the
+ *	first raw_report_len bytes), to be sent on.  The host that receives them decodes them with
+ *	wiiuse_decode_report() into a wiimote_t of its own, which it sets up
+ *	once from wiiuse_export_calibration() of the relaying host, and again
+ *	whenever an expansion or the IR camera goes on or off.
+ *
+ *	The calibration is encoded big endian, the way the remote sends it, so
+ *	both hosts may differ in word size and byte order.
+ */
+
+#include "wiiuse_internal.h"
+
+#include "dynamics.h" /* for accel_build_lut */
+#include "events.h"   /* for propagate_event */
+
+#include <string.h> /* for memset, memcpy */
+
+#define CALIBRATION_VERSION 1
+
+/* the state the decoders and the WIIUSE_USING_* macros look at */
+#define CALIBRATION_STATE_MASK                                                                           \
+    (WIIMOTE_STATE_ACC | WIIMOTE_STATE_EXP | WIIMOTE_STATE_IR | WIIMOTE_STATE_IR_FULL                    \
+     | WIIMOTE_STATE_MPLUS_PRESENT)
+
+static void buffer_accel(byte **buf, const struct accel_t *ac)
+{
+    buffer_big_endian_uint8_t(buf, ac->cal_zero.x);
+    buffer_big_endian_uint8_t(buf, ac->cal_zero.y);
+    buffer_big_endian_uint8_t(buf, ac->cal_zero.z);
+    buffer_big_endian_uint8_t(buf, ac->cal_g.x);
+    buffer_big_endian_uint8_t(buf, ac->cal_g.y);
+    buffer_big_endian_uint8_t(buf, ac->cal_g.z);
+}
+
+static void unbuffer_accel(byte **buf, struct accel_t *ac)
+{
+    ac->cal_zero.x = unbuffer_big_endian_uint8_t(buf);
+    ac->cal_zero.y = unbuffer_big_endian_uint8_t(buf);
+    ac->cal_zero.z = unbuffer_big_endian_uint8_t(buf);
+    ac->cal_g.x    = unbuffer_big_endian_uint8_t(buf);
+    ac->cal_g.y    = unbuffer_big_endian_uint8_t(buf);
+    ac->cal_g.z    = unbuffer_big_endian_uint8_t(buf);
+}
+
+static void buffer_joystick(byte **buf, const struct joystick_t *js)
+{
+    buffer_big_endian_uint8_t(buf, js->max.x);
+    buffer_big_endian_uint8_t(buf, js->min.x);
+    buffer_big_endian_uint8_t(buf, js->center.x);
+    buffer_big_endian_uint8_t(buf, js->max.y);
+    buffer_big_endian_uint8_t(buf, js->min.y);
+    buffer_big_endian_uint8_t(buf, js->center.y);
+}
+
+static void unbuffer_joystick(byte **buf, struct joystick_t *js)
+{
+    js->max.x    = unbuffer_big_endian_uint8_t(buf);
+    js->min.x    = unbuffer_big_endian_uint8_t(buf);
+    js->center.x = unbuffer_big_endian_uint8_t(buf);
+    js->max.y    = unbuffer_big_endian_uint8_t(buf);
+    js->min.y    = unbuffer_big_endian_uint8_t(buf);
+    js->center.y = unbuffer_big_endian_uint8_t(buf);
+}
+
+/**
+ *	@brief Encode what decoding the reports of a remote depends on.
+ *
+ *	@param wm		Pointer to a wiimote_t structure.
+ *	@param buf		Receives the calibration.
+ *	@param len		Size of \a buf, at least WIIUSE_CALIBRATION_LEN.
+ *
+ *	@return The number of bytes written, WIIUSE_CALIBRATION_LEN, or 0 if
+ *	\a buf is too small.
+ *
+ *	The calibration changes when the handshake of an expansion completes
+ *	and when the accelerometer or the IR camera is switched, i.e. on the
+ *	events other than WIIUSE_EVENT, so send it again after those.
+ */
+int wiiuse_export_calibration(struct wiimote_t *wm, byte *buf, int len)
+{
+    byte *p = buf;
+    int i;
+
+    if (!wm || !buf || len < WIIUSE_CALIBRATION_LEN)
+    {
+        return 0;
+    }
+    memset(buf, 0, WIIUSE_CALIBRATION_LEN);
+
+    buffer_big_endian_uint8_t(&p, CALIBRATION_VERSION);
+    buffer_big_endian_uint32_t(&p, (uint32_t)(wm->state & CALIBRATION_STATE_MASK));
+    buffer_big_endian_uint8_t(&p, (uint8_t)wm->exp.type);
+    buffer_accel(&p, &wm->accel_calib);
+
+    /* the expansions share their storage, only the one attached is valid */
+    switch (wm->exp.type)
+    {
+    case EXP_NUNCHUK:
+    case EXP_MOTION_PLUS_NUNCHUK:
+        buffer_accel(&p, &wm->exp.nunchuk.accel_calib);
+        buffer_joystick(&p, &wm->exp.nunchuk.js);
+        break;
+    case EXP_CLASSIC:
+    case EXP_MOTION_PLUS_CLASSIC:
+        buffer_joystick(&p, &wm->exp.classic.ljs);
+        buffer_joystick(&p, &wm->exp.classic.rjs);
+        break;
+    case EXP_GUITAR_HERO_3:
+        buffer_joystick(&p, &wm->exp.gh3.js);
+        break;
+    case EXP_WII_BOARD:
+        for (i = 0; i < 3; ++i)
+        {
+            buffer_big_endian_uint16_t(&p, wm->exp.wb.ctl[i]);
+            buffer_big_endian_uint16_t(&p, wm->exp.wb.ctr[i]);
+            buffer_big_endian_uint16_t(&p, wm->exp.wb.cbl[i]);
+            buffer_big_endian_uint16_t(&p, wm->exp.wb.cbr[i]);
+        }
+        buffer_big_endian_uint8_t(&p, wm->exp.wb.use_alternate_report);
+        break;
+    default:
+        break;
+    }
+
+    return WIIUSE_CALIBRATION_LEN;
+}
+
+/**
+ *	@brief Set up a remote to decode forwarded reports.
+ *
+ *	@param wm		Pointer to a wiimote_t structure from wiiuse_init(), not
+ *					connected.
+ *	@param buf		Calibration from wiiuse_export_calibration().
+ *	@param len		Its length.
+ *
+ *	@return 1 on success, 0 if the calibration is malformed or from an
+ *	incompatible version.
+ *
+ *	An expansion that differs from the one set up before starts afresh.
+ *	The receiver's own settings (flags, thresholds, filters, IR aspect
+ *	and position, ...) are left alone.
+ */
+int wiiuse_import_calibration(struct wiimote_t *wm, const byte *buf, int len)
+{
+    byte data[WIIUSE_CALIBRATION_LEN];
+    byte *p = data;
+    uint32_t state;
+    int type, i;
+
+    if (!wm || !buf || len != WIIUSE_CALIBRATION_LEN || buf[0] != CALIBRATION_VERSION)
+    {
+        WIIUSE_WARNING("Ignoring a calibration of an unknown format.");
+        return 0;
+    }
+    memcpy(data, buf, sizeof(data));
+
+    unbuffer_big_endian_uint8_t(&p);
+    state = unbuffer_big_endian_uint32_t(&p);
+    type  = unbuffer_big_endian_uint8_t(&p);
+    if (type > EXP_MOTION_PLUS_CLASSIC)
+    {
+        WIIUSE_WARNING("Ignoring a calibration for an unknown expansion (%i).", type);
+        return 0;
+    }
+
+    wm->state = (wm->state & ~CALIBRATION_STATE_MASK) | (int)(state & CALIBRATION_STATE_MASK);
+    unbuffer_accel(&p, &wm->accel_calib);
+    accel_build_lut(&wm->accel_calib, wm->accel_lut);
+
+    if (type != wm->exp.type)
+    {
+        memset(&wm->exp, 0, sizeof(wm->exp));
+        wm->exp.type = type;
+        wm->ir_half_valid = 0;
+
+        /* what the expansion handshakes point at */
+        wm->exp.nunchuk.flags = &wm->flags;
+        wm->exp.mp.nc         = &wm->exp.nunchuk;
+        wm->exp.mp.classic    = &wm->exp.classic;
+        wm->exp.mp.bias_est   = wm->gyro_bias;
+        wm->exp.mp.raw_gyro_threshold = 10;
+    }
+
+    switch (type)
+    {
+    case EXP_NUNCHUK:
+    case EXP_MOTION_PLUS_NUNCHUK:
+        unbuffer_accel(&p, &wm->exp.nunchuk.accel_calib);
+        unbuffer_joystick(&p, &wm->exp.nunchuk.js);
+        accel_build_lut(&wm->exp.nunchuk.accel_calib, wm->accel_lut ? &wm->accel_lut[1] : NULL);
+        wm->exp.nunchuk.orient_threshold = wm->orient_threshold;
+        wm->exp.nunchuk.accel_threshold  = wm->accel_threshold;
+        break;
+    case EXP_CLASSIC:
+    case EXP_MOTION_PLUS_CLASSIC:
+        unbuffer_joystick(&p, &wm->exp.classic.ljs);
+        unbuffer_joystick(&p, &wm->exp.classic.rjs);
+        break;
+    case EXP_GUITAR_HERO_3:
+        unbuffer_joystick(&p, &wm->exp.gh3.js);
+        break;
+    case EXP_WII_BOARD:
+        for (i = 0; i < 3; ++i)
+        {
+            wm->exp.wb.ctl[i] = unbuffer_big_endian_uint16_t(&p);
+            wm->exp.wb.ctr[i] = unbuffer_big_endian_uint16_t(&p);
+            wm->exp.wb.cbl[i] = unbuffer_big_endian_uint16_t(&p);
+            wm->exp.wb.cbr[i] = unbuffer_big_endian_uint16_t(&p);
+        }
+        wm->exp.wb.use_alternate_report = unbuffer_big_endian_uint8_t(&p);
+        break;
+    default:
+        break;
+    }
+
+    return 1;
+}
+
+/**
+ *	@brief Decode a data report forwarded by another host.
+ *
+ *	@param wm			Pointer to a wiimote_t structure set up with
+ *						wiiuse_import_calibration().
+ *	@param report		The report, starting with its id, as in
+ *						wiimote_t.raw_report.
+ *	@param len			Its length, wiimote_t.raw_report_len, at most
+ *						WIIUSE_RAW_REPORT_LEN.
+ *	@param timestamp_us	When the report arrived, in monotonic microseconds.
+ *						Filters and fusion only use the time between
+ *						reports, so the relaying host's clock will do.
+ *
+ *	@return 1 if the report changed the state (wm->event is WIIUSE_EVENT),
+ *	0 otherwise or if it is not a data report.
+ *
+ *	This is what wiiuse_poll() does with a report it reads itself, so
+ *	filters, the IR tracker and Motion Plus fusion all apply.
+ */
+int wiiuse_decode_report(struct wiimote_t *wm, const byte *report, int len, uint64_t timestamp_us)
+{
+    byte msg[MAX_PAYLOAD];
+
+    if (!wm || !report || len < 1 || len > WIIUSE_RAW_REPORT_LEN || (report[0] & 0xF0) != WM_RPT_BTN)
+    {
+        return 0;
+    }
+    if (WIIMOTE_IS_FLAG_SET(wm, WIIUSE_RAW_REPORTS))
+    {
+        WIIUSE_WARNING("Decoding a report needs WIIUSE_RAW_REPORTS off (id %i).", wm->unid);
+        return 0;
+    }
+
+    memset(msg, 0, sizeof(msg));
+    memcpy(msg, report + 1, len - 1);
+
+    wm->event        = WIIUSE_NONE;
+    wm->timestamp_us = timestamp_us;
+    propagate_event(wm, report[0], msg);
+
+    return wm->event != WIIUSE_NONE;
+}
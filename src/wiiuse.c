@@ -69,6 +69,9 @@ void wiiuse_set_output(enum wiiuse_loglevel loglevel, FILE *logfile) { logtarget
 
 /**
  *	@brief Clean up wiimote_t array created by wiiuse_init()
+ *
+ *	The array and all wiimote_t structures share one allocation, so they
+ *	are released together regardless of how many are passed in @a wiimotes.
  */
 void wiiuse_cleanup(struct wiimote_t **wm, int wiimotes)
 {
@@ -85,7 +88,7 @@ void wiiuse_cleanup(struct wiimote_t **wm, int wiimotes)
     {
         wiiuse_disconnect(wm[i]);
         wiiuse_cleanup_platform_fields(wm[i]);
-        free(wm[i]);
+        wiiuse_flush_report_queue(wm[i]);
     }
 
     free(wm);
@@ -104,11 +107,27 @@ void wiiuse_cleanup(struct wiimote_t **wm, int wiimotes)
  *
  *	The array returned by this function can be passed to various
  *	functions, including wiiuse_connect().
+ *
+ *	The pointer array and the structures it points to are carved out of
+ *	a single allocation.  Each structure starts on a cache line boundary
+ *	and is padded to a whole number of lines, so remotes never share a
+ *	line and the per-report members at the front of each stay together.
+ *	Each structure is followed by its accelerometer lookup tables (one set
+ *	for the wiimote, one for a nunchuk), which are filled in once the
+ *	calibration has been read, by its Motion Plus bias estimator, by its
+ *	IR cursor tracker and by its rumble queue.  Release it with
+ *	wiiuse_cleanup() only.
  */
 struct wiimote_t **wiiuse_init(int wiimotes)
 {
     int i                 = 0;
     struct wiimote_t **wm = NULL;
+    size_t wm_size        = WIIUSE_CACHE_ALIGN(sizeof(struct wiimote_t));
+    size_t lut_size       = WIIUSE_CACHE_ALIGN(2 * sizeof(struct accel_lut_t));
+    size_t bias_size      = WIIUSE_CACHE_ALIGN(sizeof(struct gyro_bias_t));
+    size_t tracker_size   = WIIUSE_CACHE_ALIGN(sizeof(struct ir_tracker_t));
+    size_t stride = wm_size + lut_size + bias_size + tracker_size + WIIUSE_CACHE_ALIGN(sizeof(struct haptics_t));
+    uintptr_t slots       = 0;
 
     /*
      *	Please do not remove this banner.
@@ -139,12 +158,25 @@ struct wiimote_t **wiiuse_init(int wiimotes)
         return NULL;
     }
 
-    wm = (struct wiimote_t **)malloc(sizeof(struct wiimote_t *) * wiimotes);
+    /* pointer table, then up to a line of slack to align the first slot */
+    wm = (struct wiimote_t **)calloc(
+        1, sizeof(struct wiimote_t *) * wiimotes + WIIUSE_CACHE_LINE - 1 + stride * wiimotes);
+    if (!wm)
+    {
+        WIIUSE_ERROR("Unable to allocate %i wiimote structures.", wiimotes);
+        return NULL;
+    }
+
+    slots = WIIUSE_CACHE_ALIGN((uintptr_t)(wm + wiimotes));
 
     for (i = 0; i < wiimotes; ++i)
     {
-        wm[i] = (struct wiimote_t *)malloc(sizeof(struct wiimote_t));
-        memset(wm[i], 0, sizeof(struct wiimote_t));
+        wm[i]             = (struct wiimote_t *)(slots + stride * i);
+        wm[i]->accel_lut  = (struct accel_lut_t *)(slots + stride * i + wm_size);
+        wm[i]->gyro_bias  = (struct gyro_bias_t *)(slots + stride * i + wm_size + lut_size);
+        wm[i]->ir_tracker = (struct ir_tracker_t *)(slots + stride * i + wm_size + lut_size + bias_size);
+        wm[i]->haptics =
+            (struct haptics_t *)(slots + stride * i + wm_size + lut_size + bias_size + tracker_size);
 
         wm[i]->unid = i + 1;
         wiiuse_init_platform_fields(wm[i]);
@@ -159,9 +191,11 @@ struct wiimote_t **wiiuse_init(int wiimotes)
 
         wiiuse_set_aspect_ratio(wm[i], WIIUSE_ASPECT_4_3);
         wiiuse_set_ir_position(wm[i], WIIUSE_IR_ABOVE);
+        wiiuse_set_ir_sources(wm[i], 2);
 
         wm[i]->orient_threshold = 0.5f;
         wm[i]->accel_threshold  = 5;
+        wm[i]->fusion_gain      = WIIUSE_DEFAULT_FUSION_GAIN;
 
         wm[i]->accel_calib.st_alpha = WIIUSE_DEFAULT_SMOOTH_ALPHA;
 
@@ -192,6 +226,8 @@ void wiiuse_disconnected(struct wiimote_t *wm)
     wm->leds     = 0;
     wm->state    = WIIMOTE_INIT_STATES;
     wm->read_req = NULL;
+    wiiuse_flush_report_queue(wm);
+    memset(wm->haptics, 0, sizeof(*wm->haptics));
 #ifndef WIIUSE_SYNC_HANDSHAKE
     wm->handshake_state = 0;
 #endif
@@ -348,7 +384,11 @@ int wiiuse_set_report_type(struct wiimote_t *wm)
     ir            = WIIMOTE_IS_SET(wm, WIIMOTE_STATE_IR);
     balance_board = exp && (wm->exp.type == EXP_WII_BOARD);
 
-    if (motion && ir && exp)
+    if (ir && WIIMOTE_IS_SET(wm, WIIMOTE_STATE_IR_FULL))
+    {
+        /* the wiimote alternates 0x3e and 0x3f, without expansion data */
+        buf[1] = WM_RPT_INTERLEAVED_A;
+    } else if (motion && ir && exp)
     {
         buf[1] = WM_RPT_BTN_ACC_IR_EXP;
     } else if (motion && exp)
@@ -142,6 +142,7 @@
 #define WIIMOTE_STATE_EXP_EXTERN         0x20000    /* actual M+ connection exists but handshake failed */
 #define WIIMOTE_STATE_EXP_FAILED         0x40000    /* actual M+ connection exists but handshake failed */
 #define WIIMOTE_STATE_MPLUS_PRESENT      0x80000 /* Motion+ is connected */
+#define WIIMOTE_STATE_IR_FULL            0x100000 /* IR camera in full mode, see wiiuse_set_ir_full() */
 
 #define WIIMOTE_ID(wm) (wm->unid)
 
@@ -225,11 +226,18 @@
 #define WIIUSE_SMOOTHING     0x01
 #define WIIUSE_CONTINUOUS    0x02
 #define WIIUSE_ORIENT_THRESH 0x04
+#define WIIUSE_RAW_REPORTS   0x08 /**< keep data reports undecoded, see wiiuse_decode_report() */
 #define WIIUSE_INIT_FLAGS (WIIUSE_SMOOTHING | WIIUSE_ORIENT_THRESH)
 
 #define WIIUSE_ORIENT_PRECISION 100.0f
 /** @} */
 
+/** @name Report passthrough, see wiiuse_decode_report() */
+/** @{ */
+#define WIIUSE_RAW_REPORT_LEN 22  /**< longest data report, with its id	*/
+#define WIIUSE_CALIBRATION_LEN 37 /**< see wiiuse_export_calibration()	*/
+/** @} */
+
 /** @name Expansion codes */
 /** @{ */
 #define EXP_NONE 0
@@ -328,6 +336,11 @@ typedef unsigned char byte;
 typedef char sbyte;
 
 struct wiimote_t;
+struct queued_report_t;
+struct accel_lut_t;
+struct gyro_bias_t;
+struct ir_tracker_t;
+struct haptics_t;
 struct vec3b_t;
 struct orient_t;
 struct gforce_t;
@@ -382,6 +395,15 @@ typedef struct ang3f_t
     float roll, pitch, yaw;
 } ang3f_t;
 
+/**
+ *  @struct quat_t
+ *  @brief Unit quaternion, w + xi + yj + zk.
+ */
+typedef struct quat_t
+{
+    float w, x, y, z;
+} quat_t;
+
 /**
  *	@brief Unsigned x,y byte vector.
  */
@@ -421,6 +443,104 @@ typedef struct orient_t
     float a_pitch; /**< absolute pitch, unsmoothed				*/
 } orient_t;
 
+/**
+ *	@brief Structure-of-arrays sample buffers for wiiuse_accel_batch().
+ *
+ *	Every array holds @a n elements.  The outputs match calculate_gforce()
+ *	and the unsmoothed angles of calculate_orientation().
+ */
+typedef struct accel_batch_t
+{
+    unsigned int n; /**< number of samples						*/
+
+    const byte *x; /**< raw x axis readings					*/
+    const byte *y; /**< raw y axis readings					*/
+    const byte *z; /**< raw z axis readings					*/
+
+    float *gx; /**< [out] gravity force on the x axis		*/
+    float *gy; /**< [out] gravity force on the y axis		*/
+    float *gz; /**< [out] gravity force on the z axis		*/
+
+    float *roll;  /**< [out] roll in degrees					*/
+    float *pitch; /**< [out] pitch in degrees					*/
+} accel_batch_t;
+
+/** @name Filter chain limits */
+/** @{ */
+#define WIIUSE_FILTER_MAX_STAGES 4 /**< stages per filter chain				*/
+#define WIIUSE_FILTER_MAX_DIM 4    /**< values per sample					*/
+#define WIIUSE_FILTER_MAX_MEDIAN 9 /**< longest median window				*/
+/** @} */
+
+/**
+ *	@brief Channels a filter chain can be attached to with wiiuse_set_filter().
+ */
+typedef enum filter_channel_t {
+    WIIUSE_FILTER_ORIENT = 0,    /**< wiimote orient roll, pitch, yaw		*/
+    WIIUSE_FILTER_GFORCE,        /**< wiimote gforce x, y, z				*/
+    WIIUSE_FILTER_IR,            /**< IR cursor x, y						*/
+    WIIUSE_FILTER_NUNCHUK_JS,    /**< nunchuk joystick x, y				*/
+    WIIUSE_FILTER_CLASSIC_LJS,   /**< classic controller left joystick x, y	*/
+    WIIUSE_FILTER_CLASSIC_RJS,   /**< classic controller right joystick x, y	*/
+    WIIUSE_FILTER_WII_BOARD,     /**< balance board tl, tr, bl, br			*/
+    WIIUSE_FILTER_MOTION_PLUS,   /**< Motion Plus angle rates roll, pitch, yaw	*/
+    WIIUSE_FILTER_NUM_CHANNELS
+} filter_channel_t;
+
+/**
+ *	@brief One stage of a filter chain, see wiiuse_filter_add_one_euro() and friends.
+ */
+typedef struct filter_stage_t
+{
+    int type; /**< stage kind, internal					*/
+
+    union {
+        struct
+        {
+            float min_cutoff; /**< cutoff at rest, Hz					*/
+            float beta;       /**< cutoff increase per unit/s of speed	*/
+            float d_cutoff;   /**< cutoff of the speed estimate, Hz		*/
+            float x[WIIUSE_FILTER_MAX_DIM];
+            float dx[WIIUSE_FILTER_MAX_DIM];
+        } one_euro;
+        struct
+        {
+            float alpha; /**< weight of the new sample (0, 1]		*/
+            float y[WIIUSE_FILTER_MAX_DIM];
+        } ema;
+        struct
+        {
+            unsigned int n;    /**< window length, odd					*/
+            unsigned int head; /**< next slot to overwrite				*/
+            float hist[WIIUSE_FILTER_MAX_DIM][WIIUSE_FILTER_MAX_MEDIAN];
+        } median;
+        struct
+        {
+            float width; /**< half width of the dead zone			*/
+            float y[WIIUSE_FILTER_MAX_DIM];
+        } deadband;
+    };
+} filter_stage_t;
+
+/**
+ *	@brief A chain of smoothing stages over a small vector of values.
+ *
+ *	All state lives in the structure itself, so a chain can be declared
+ *	statically or embedded in application data; the library never allocates
+ *	for it.  Set it up with wiiuse_filter_init() and the wiiuse_filter_add_*()
+ *	functions, then either run it with wiiuse_filter_update() or attach it to
+ *	a wiimote channel with wiiuse_set_filter().
+ */
+typedef struct filter_chain_t
+{
+    unsigned int dim;        /**< values per sample					*/
+    unsigned int num_stages; /**< stages in use							*/
+    int primed;              /**< a sample has been seen since reset	*/
+    uint64_t last_us;        /**< timestamp of the previous sample		*/
+    float out[WIIUSE_FILTER_MAX_DIM]; /**< last filtered sample			*/
+    struct filter_stage_t stage[WIIUSE_FILTER_MAX_STAGES];
+} filter_chain_t;
+
 /**
  *	@brief Gravity force struct.
  */
@@ -437,6 +557,8 @@ typedef struct accel_t
     struct vec3b_t cal_zero; /**< zero calibration					*/
     struct vec3b_t cal_g;    /**< 1g difference around 0cal			*/
 
+    const struct accel_lut_t *lut; /**< tables built from the calibration, or NULL */
+
     float st_roll;  /**< last smoothed roll value			*/
     float st_pitch; /**< last smoothed roll pitch			*/
     float st_alpha; /**< alpha value for smoothing [0-1]	*/
@@ -458,6 +580,16 @@ typedef struct ir_dot_t
     byte order; /**< increasing order by x-axis value	*/
 
     byte size; /**< size of the IR dot (0-15)			*/
+
+    unsigned int id; /**< persistent id of the source, 0 if none	*/
+    byte rejected;   /**< seen but taken for a reflection		*/
+
+    /** @name Full IR mode only, see wiiuse_set_ir_full() */
+    /** @{ */
+    byte xmin, ymin;  /**< bounding box corner (0-127, 0-95)		*/
+    byte xmax, ymax;  /**< opposite corner						*/
+    byte intensity;   /**< brightness of the dot (0-255)		*/
+    /** @} */
 } ir_dot_t;
 
 /**
@@ -465,6 +597,15 @@ typedef struct ir_dot_t
  */
 typedef enum aspect_t { WIIUSE_ASPECT_4_3, WIIUSE_ASPECT_16_9 } aspect_t;
 
+/**
+ *	@brief Motion models of the IR cursor tracker, see wiiuse_set_ir_tracker().
+ */
+typedef enum ir_tracker_model_t {
+    WIIUSE_IR_TRACKER_OFF, /**< raw cursor							*/
+    WIIUSE_IR_TRACKER_CV,  /**< constant velocity						*/
+    WIIUSE_IR_TRACKER_CA   /**< constant acceleration					*/
+} ir_tracker_model_t;
+
 /**
  *	@brief IR struct. Hold all data related to the IR tracking.
  */
@@ -489,8 +630,46 @@ typedef struct ir_t
 
     float distance; /**< pixel distance between first 2 dots*/
     float z;        /**< calculated distance				*/
+
+    float vx;     /**< tracked X velocity, pixels/s		*/
+    float vy;     /**< tracked Y velocity, pixels/s		*/
+    int coasting; /**< tracker is predicting over lost dots	*/
 } ir_t;
 
+/** @brief Most steps a remote's rumble queue holds, see wiiuse_rumble_pattern() */
+#define WIIUSE_RUMBLE_QUEUE_LEN 16
+
+/**
+ *	@brief One step of a rumble pattern, see wiiuse_rumble_pattern().
+ *
+ *	The motor only knows on and off, so an intensity between 0 and 1 is
+ *	played by switching it on for that fraction of every 20 ms.
+ */
+typedef struct rumble_step_t
+{
+    unsigned int duration_ms; /**< how long the step lasts			*/
+    float intensity;          /**< 0 (off) to 1 (full on)			*/
+} rumble_step_t;
+
+/**
+ *	@brief Pose of the remote relative to an IR constellation, see
+ *	wiiuse_set_ir_constellation().
+ *
+ *	The remote frame is that of its camera: x to the right, y down and z
+ *	along the pointing direction.  Positions are in the units the
+ *	constellation was given in.
+ */
+typedef struct ir_pose_t
+{
+    int valid; /**< solved for the current report			*/
+
+    float x, y, z;         /**< remote position in the constellation frame */
+    struct quat_t quat;    /**< rotation from the remote frame to the constellation frame */
+    struct ang3f_t orient; /**< the same as roll, pitch and yaw in degrees, see wiiuse_set_ir_constellation() */
+
+    float error; /**< RMS reprojection error in camera pixels */
+} ir_pose_t;
+
 /**
  *	@brief Joystick calibration structure.
  *
@@ -578,14 +757,19 @@ typedef struct motion_plus_t
 
     struct ang3s_t raw_gyro;        /**< current raw gyroscope data */
     struct ang3s_t cal_gyro;        /**< calibration raw gyroscope data */
+    struct ang3f_t bias_gyro;       /**< zero rate raw reading, refined while the remote is still */
     struct ang3f_t angle_rate_gyro; /**< current gyro angle rate */
     struct orient_t orient;         /**< current orientation on each axis using Motion Plus gyroscopes */
+    struct quat_t quat;             /**< fused orientation, earth frame relative to the wiimote */
+    struct gforce_t linear_accel;   /**< wiimote acceleration with gravity removed, in g */
+    uint64_t fusion_time_us;        /**< timestamp of the last fused gyro frame */
     byte acc_mode; /**< Fast/slow rotation mode for roll, pitch and yaw (0 if rotating fast, 1 if slow or
                       still) */
     int raw_gyro_threshold; /**< threshold for gyroscopes to generate an event */
 
     struct nunchuk_t *nc; /**< pointers to nunchuk & classic in pass-through-mode */
     struct classic_ctrl_t *classic;
+    struct gyro_bias_t *bias_est; /**< stillness window for bias_gyro (internal) */
 } motion_plus_t;
 
 /**
@@ -726,9 +910,56 @@ typedef enum WIIUSE_WIIMOTE_TYPE {
  *	@brief Main Wiimote device structure.
  *
  *  You need one of these to do pretty much anything with this library.
+ *
+ *  Members are grouped by how often they are touched.  The sample state that
+ *  every data report rewrites comes first, followed by the settings read while
+ *  decoding a report, and last the connection, handshake and platform state
+ *  that is only needed while connecting or servicing requests.  wiiuse_init()
+ *  places each structure on its own cache line, so polling several remotes
+ *  walks a few adjacent lines per remote instead of the whole structure.
  */
 typedef struct wiimote_t
 {
+    /** @name Per-report sample state */
+    /** @{ */
+    WIIUSE_EVENT_TYPE event; /**< type of event that occurred				*/
+    int state;               /**< various state flags					*/
+    uint64_t timestamp_us;   /**< when the last report arrived, monotonic microseconds */
+
+    uint16_t btns;          /**< what buttons have just been pressed	*/
+    uint16_t btns_held;     /**< what buttons are being held down		*/
+    uint16_t btns_released; /**< what buttons were just released this	*/
+
+    struct vec3b_t accel;   /**< current raw acceleration data			*/
+    struct orient_t orient; /**< current orientation on each axis		*/
+    struct gforce_t gforce; /**< current gravity forces on each axis	*/
+
+    struct ir_t ir;           /**< IR data								*/
+    struct ir_pose_t ir_pose; /**< pose from the IR constellation		*/
+    struct expansion_t exp;   /**< wiimote expansion device				*/
+
+    struct wiimote_state_t lstate; /**< last saved state						*/
+
+    byte ir_half[21];        /**< first half (0x3e) of a full mode IR frame */
+    uint64_t ir_half_us;     /**< when ir_half arrived */
+    byte ir_half_valid;      /**< ir_half waits for its second half */
+
+    byte raw_report[WIIUSE_RAW_REPORT_LEN]; /**< last data report with WIIUSE_RAW_REPORTS, id first */
+    byte raw_report_len;                    /**< its length as read, see wiiuse_os_read() */
+    /** @} */
+
+    /** @name Settings read while decoding */
+    /** @{ */
+    int flags;                  /**< options flag							*/
+    float orient_threshold;     /**< threshold for orient to generate an event */
+    int32_t accel_threshold;    /**< threshold for accel to generate an event */
+    float fusion_gain;          /**< Motion Plus fusion gain, see wiiuse_set_fusion_gain() */
+    struct filter_chain_t *filters[WIIUSE_FILTER_NUM_CHANNELS]; /**< see wiiuse_set_filter() */
+    struct accel_t accel_calib; /**< wiimote accelerometer calibration		*/
+    /** @} */
+
+    /** @name Connection and configuration state */
+    /** @{ */
     int unid; /**< user specified id						*/
 
 #ifdef WIIUSE_BLUEZ
@@ -760,12 +991,9 @@ typedef struct wiimote_t
                           /** @} */
 #endif
 
-    int state;           /**< various state flags					*/
     byte leds;           /**< currently lit leds						*/
     float battery_level; /**< battery level							*/
 
-    int flags; /**< options flag							*/
-
 #ifndef WIIUSE_SYNC_HANDSHAKE
     byte handshake_state; /**< the state of the connection handshake	*/
 #endif
@@ -773,27 +1001,15 @@ typedef struct wiimote_t
     struct data_req_t *data_req; /**< list of data read requests				*/
 
     struct read_req_t *read_req; /**< list of data read requests				*/
-    struct accel_t accel_calib;  /**< wiimote accelerometer calibration		*/
-    struct expansion_t exp;      /**< wiimote expansion device				*/
-
-    struct vec3b_t accel;   /**< current raw acceleration data			*/
-    struct orient_t orient; /**< current orientation on each axis		*/
-    struct gforce_t gforce; /**< current gravity forces on each axis	*/
-
-    struct ir_t ir; /**< IR data								*/
+    struct queued_report_t *report_queue; /**< input set aside by a synchronous wait */
+    struct accel_lut_t *accel_lut; /**< tables for accel_calib and the nunchuk, see wiiuse_init() */
+    struct gyro_bias_t *gyro_bias; /**< Motion Plus bias estimator state, see wiiuse_init() */
+    struct ir_tracker_t *ir_tracker; /**< IR cursor tracker state, see wiiuse_init() */
+    struct haptics_t *haptics;       /**< rumble pattern queue, see wiiuse_init() */
 
-    uint16_t btns;          /**< what buttons have just been pressed	*/
-    uint16_t btns_held;     /**< what buttons are being held down		*/
-    uint16_t btns_released; /**< what buttons were just released this	*/
-
-    float orient_threshold;  /**< threshold for orient to generate an event */
-    int32_t accel_threshold; /**< threshold for accel to generate an event */
-
-    struct wiimote_state_t lstate; /**< last saved state						*/
-
-    WIIUSE_EVENT_TYPE event; /**< type of event that occurred				*/
     byte motion_plus_id[6];
     WIIUSE_WIIMOTE_TYPE type;
+    /** @} */
 } wiimote;
 
 /** @brief Data passed to a callback during wiiuse_update() */
@@ -806,6 +1022,7 @@ typedef struct wiimote_callback_data_t
     struct orient_t orient;
     struct gforce_t gforce;
     struct ir_t ir;
+    struct ir_pose_t ir_pose;
     uint16_t buttons;
     uint16_t buttons_held;
     uint16_t buttons_released;
@@ -850,6 +1067,55 @@ struct data_req_t
     struct data_req_t *next;
 };
 
+/** @brief Most remotes a stereo rig triangulates from */
+#define WIIUSE_STEREO_MAX_CAMERAS 4
+
+/**
+ *	@brief One remote of a stereo rig, used as a fixed camera.
+ *
+ *	A world point X is seen at R X + t in the camera frame (x right,
+ *	y down, z forward).  See wiiuse_stereo_calibrate().
+ */
+typedef struct ir_camera_t
+{
+    struct wiimote_t *wm; /**< the remote */
+    float focal;          /**< focal length in camera pixels */
+    float cx, cy;         /**< principal point in camera pixels */
+    float R[3][3];        /**< world to camera rotation */
+    float t[3];           /**< world to camera translation */
+
+    int calib_samples;   /**< poses averaged by wiiuse_stereo_calibrate() */
+    double calib_sum[7]; /**< their summed quaternion and position */
+} ir_camera_t;
+
+/**
+ *	@brief A triangulated IR source.
+ */
+typedef struct ir_point3_t
+{
+    unsigned int id; /**< dot id in the first camera that sees it, see ir_dot_t */
+    float x, y, z;   /**< position in the world frame */
+    float error;     /**< RMS reprojection error in camera pixels */
+    int views;       /**< cameras the source was matched in */
+} ir_point3_t;
+
+/**
+ *	@brief Two or more remotes triangulating IR sources, see
+ *	wiiuse_stereo_update().
+ */
+typedef struct ir_stereo_t
+{
+    int num_cameras;
+    struct ir_camera_t cam[WIIUSE_STEREO_MAX_CAMERAS];
+
+    float max_epipolar;   /**< farthest a match may be from its epipolar line, camera pixels */
+    uint64_t max_skew_us; /**< oldest a camera's report may be relative to the newest */
+
+    uint64_t timestamp_us;       /**< time the points were brought to */
+    int num_points;              /**< points found in the last update */
+    struct ir_point3_t point[4]; /**< the points */
+} ir_stereo_t;
+
 /**
  *	@brief Loglevels supported by wiiuse.
  */
@@ -927,6 +1193,20 @@ WIIUSE_EXPORT extern int wiiuse_find(struct wiimote_t **wm, int max_wiimotes, in
 WIIUSE_EXPORT extern int wiiuse_connect(struct wiimote_t **wm, int wiimotes);
 WIIUSE_EXPORT extern void wiiuse_disconnect(struct wiimote_t *wm);
 
+#ifdef WIIUSE_BLUEZ
+/* os_nix.c */
+/**
+ *  @brief Use an already connected socket as the HID channel of a wiimote.
+ *
+ *  Reports are exchanged as on the L2CAP sockets (first byte 0xA1 for input,
+ *  0xA2 for output), so any SOCK_SEQPACKET socket works, e.g. one end of a
+ *  socketpair() driven by an emulated remote.  Runs the handshake.
+ *
+ *  @return 1 on success, 0 if \a wm is already connected.
+ */
+WIIUSE_EXPORT extern int wiiuse_connect_socket(struct wiimote_t *wm, int sock);
+#endif
+
 /* events.c */
 WIIUSE_EXPORT extern int wiiuse_poll(struct wiimote_t **wm, int wiimotes);
 
@@ -941,12 +1221,47 @@ WIIUSE_EXPORT extern int wiiuse_poll(struct wiimote_t **wm, int wiimotes);
  */
 WIIUSE_EXPORT extern int wiiuse_update(struct wiimote_t **wm, int wiimotes, wiiuse_update_cb callback);
 
+/* dynamics_batch.c */
+WIIUSE_EXPORT extern void wiiuse_accel_batch(const struct accel_t *ac, struct accel_batch_t *batch,
+                                             struct orient_t *orient);
+WIIUSE_EXPORT extern const char *wiiuse_accel_batch_kernel();
+
+/* haptics.c */
+WIIUSE_EXPORT extern int wiiuse_rumble_pulse(struct wiimote_t *wm, unsigned int duration_ms, float intensity);
+WIIUSE_EXPORT extern int wiiuse_rumble_pattern(struct wiimote_t *wm, const struct rumble_step_t *steps, int count);
+WIIUSE_EXPORT extern void wiiuse_rumble_stop(struct wiimote_t *wm);
+WIIUSE_EXPORT extern void wiiuse_rumble_update(struct wiimote_t **wm, int wiimotes);
+WIIUSE_EXPORT extern uint64_t wiiuse_rumble_deadline(struct wiimote_t **wm, int wiimotes);
+
+/* passthrough.c */
+WIIUSE_EXPORT extern int wiiuse_export_calibration(struct wiimote_t *wm, byte *buf, int len);
+WIIUSE_EXPORT extern int wiiuse_import_calibration(struct wiimote_t *wm, const byte *buf, int len);
+WIIUSE_EXPORT extern int wiiuse_decode_report(struct wiimote_t *wm, const byte *report, int len,
+                                              uint64_t timestamp_us);
+
 /* ir.c */
 WIIUSE_EXPORT extern void wiiuse_set_ir(struct wiimote_t *wm, int status);
 WIIUSE_EXPORT extern void wiiuse_set_ir_vres(struct wiimote_t *wm, unsigned int x, unsigned int y);
 WIIUSE_EXPORT extern void wiiuse_set_ir_position(struct wiimote_t *wm, enum ir_position_t pos);
 WIIUSE_EXPORT extern void wiiuse_set_aspect_ratio(struct wiimote_t *wm, enum aspect_t aspect);
 WIIUSE_EXPORT extern void wiiuse_set_ir_sensitivity(struct wiimote_t *wm, int level);
+WIIUSE_EXPORT extern void wiiuse_set_ir_full(struct wiimote_t *wm, int status);
+
+/* ir_tracker.c */
+WIIUSE_EXPORT extern void wiiuse_set_ir_tracker(struct wiimote_t *wm, enum ir_tracker_model_t model,
+                                                float lookahead_ms);
+WIIUSE_EXPORT extern void wiiuse_set_ir_tracker_noise(struct wiimote_t *wm, float accel_noise, float meas_noise);
+WIIUSE_EXPORT extern void wiiuse_set_ir_sources(struct wiimote_t *wm, int sources);
+
+/* ir_pose.c */
+WIIUSE_EXPORT extern int wiiuse_set_ir_constellation(struct wiimote_t *wm, const float leds[4][3], float focal);
+
+/* ir_stereo.c */
+WIIUSE_EXPORT extern void wiiuse_stereo_init(struct ir_stereo_t *st);
+WIIUSE_EXPORT extern int wiiuse_stereo_add_camera(struct ir_stereo_t *st, struct wiimote_t *wm,
+                                                  const struct ir_camera_t *cam);
+WIIUSE_EXPORT extern int wiiuse_stereo_calibrate(struct ir_stereo_t *st, int camera);
+WIIUSE_EXPORT extern int wiiuse_stereo_update(struct ir_stereo_t *st);
 
 /* nunchuk.c */
 WIIUSE_EXPORT extern void wiiuse_set_nunchuk_orient_threshold(struct wiimote_t *wm, float threshold);
@@ -956,6 +1271,23 @@ WIIUSE_EXPORT extern void wiiuse_set_nunchuk_accel_threshold(struct wiimote_t *w
 WIIUSE_EXPORT extern void wiiuse_set_wii_board_calib(struct wiimote_t *wm);
 
 WIIUSE_EXPORT extern void wiiuse_set_motion_plus(struct wiimote_t *wm, int status);
+WIIUSE_EXPORT extern void wiiuse_recalibrate_motion_plus(struct wiimote_t *wm);
+
+/* fusion.c */
+WIIUSE_EXPORT extern float wiiuse_set_fusion_gain(struct wiimote_t *wm, float gain);
+
+/* filter.c */
+WIIUSE_EXPORT extern void wiiuse_filter_init(struct filter_chain_t *fc, unsigned int dim);
+WIIUSE_EXPORT extern void wiiuse_filter_reset(struct filter_chain_t *fc);
+WIIUSE_EXPORT extern int wiiuse_filter_add_one_euro(struct filter_chain_t *fc, float min_cutoff, float beta,
+                                                    float d_cutoff);
+WIIUSE_EXPORT extern int wiiuse_filter_add_ema(struct filter_chain_t *fc, float alpha);
+WIIUSE_EXPORT extern int wiiuse_filter_add_median(struct filter_chain_t *fc, unsigned int n);
+WIIUSE_EXPORT extern int wiiuse_filter_add_deadband(struct filter_chain_t *fc, float width);
+WIIUSE_EXPORT extern void wiiuse_filter_update(struct filter_chain_t *fc, const float *in, float *out,
+                                               uint64_t timestamp_us);
+WIIUSE_EXPORT extern int wiiuse_set_filter(struct wiimote_t *wm, enum filter_channel_t channel,
+                                           struct filter_chain_t *fc);
 
 #ifdef __cplusplus
 }
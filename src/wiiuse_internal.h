@@ -127,6 +127,9 @@
 #define WM_RPT_BTN_ACC_EXP    0x35
 #define WM_RPT_BTN_IR_EXP     0x36
 #define WM_RPT_BTN_ACC_IR_EXP 0x37
+#define WM_RPT_EXP_21         0x3D
+#define WM_RPT_INTERLEAVED_A  0x3E
+#define WM_RPT_INTERLEAVED_B  0x3F
 
 #define WM_BT_INPUT           0x01
 #define WM_BT_OUTPUT          0x02
@@ -195,6 +198,12 @@
 
 #define WM_IR_TYPE_BASIC                     0x01
 #define WM_IR_TYPE_EXTENDED                  0x03
+#define WM_IR_TYPE_FULL                      0x05
+
+/* nominal pinhole model of the IR camera, in camera pixels (about 41 degrees across 1024 pixels) */
+#define WM_IR_FOCAL 1380.0f
+#define WM_IR_CX    511.5f
+#define WM_IR_CY    383.5f
 
 /* controller status flags for the first message byte */
 /* bit 1 is unknown */
@@ -271,11 +280,27 @@
  */
 #define WIIUSE_DEFAULT_SMOOTH_ALPHA 0.07f
 
+/* Madgwick gain for the Motion Plus fusion, in rad/s of gyro error corrected by the accelerometer */
+#define WIIUSE_DEFAULT_FUSION_GAIN 0.1f
+
 #define SMOOTH_ROLL 0x01
 #define SMOOTH_PITCH 0x02
 
 #define WIIUSE_READ_TIMEOUT 5000
 
+/* input reports held back while waiting for a synchronous reply */
+#define WIIUSE_MAX_QUEUED_REPORTS 32
+
+/* Motion Plus gyro frames the bias estimator looks at for stillness */
+#define WIIUSE_GYRO_BIAS_WINDOW 64
+
+/* state variables of the IR tracker per axis: position, velocity, acceleration */
+#define WIIUSE_IR_TRACKER_STATES 3
+
+/* wiiuse_init() starts every wiimote_t of its arena on a new cache line */
+#define WIIUSE_CACHE_LINE 64
+#define WIIUSE_CACHE_ALIGN(n) (((n) + WIIUSE_CACHE_LINE - 1) & ~((size_t)WIIUSE_CACHE_LINE - 1))
+
 /** @} */
 #include "wiiuse.h"
 /** @addtogroup internal_general */
@@ -298,6 +323,101 @@ extern "C" {
 
 /* not part of the api */
 
+/**
+ *	@brief Input report received by wiiuse_wait_report() while it was waiting
+ *	for a different report, kept for the next wiiuse_poll().
+ */
+struct queued_report_t
+{
+    byte data[MAX_PAYLOAD];       /**< report id followed by the payload */
+    byte len;                     /**< bytes of data that were read */
+    uint64_t timestamp_us;        /**< when it was received, see wiiuse_os_ticks_us() */
+    struct queued_report_t *next; /**< next (newer) report in the queue */
+};
+
+/**
+ *	@brief Sliding window of Motion Plus frames used to re-estimate the
+ *	gyro zero rate while the remote is still, see motion_plus_track_bias().
+ */
+struct gyro_bias_t
+{
+    int16_t gyro[WIIUSE_GYRO_BIAS_WINDOW][3]; /**< raw roll, pitch, yaw */
+    byte accel[WIIUSE_GYRO_BIAS_WINDOW][3];   /**< raw wiimote accelerometer */
+    int64_t gyro_sum[3], gyro_sq[3];          /**< sums and sums of squares over the window */
+    int32_t accel_sum[3], accel_sq[3];
+    unsigned int head;  /**< next slot to write */
+    unsigned int count; /**< frames in the window */
+    int converged;      /**< a still window was seen since the last calibration */
+    int recalibrate;    /**< take the next still window as the bias outright */
+};
+
+/**
+ *	@brief An IR source followed from report to report, see ir_track_dots().
+ */
+struct ir_dot_track_t
+{
+    unsigned int id; /**< persistent id, 0 if the slot is free */
+    float x, y;      /**< last raw camera position */
+    float vx, vy;    /**< motion per report */
+    byte order;      /**< left to right order, 0 if not yet ordered */
+    byte missed;     /**< reports since the source was last seen */
+};
+
+/**
+ *	@brief IR tracking state: dot correspondences (see ir_track_dots()) and
+ *	a Kalman filter over the cursor (see ir_tracker_update()).
+ *
+ *	The three cursor axes (ir.ax, ir.ay, ir.z) are filtered independently.
+ */
+struct ir_tracker_t
+{
+    struct ir_dot_track_t dots[4]; /**< one per tracked source */
+    unsigned int next_id;          /**< last id handed out */
+    int sources;                   /**< real IR sources expected, 0 to keep every dot */
+
+    int pose_enabled;         /**< a constellation is set, see ir_pose_update() */
+    float leds[4][3];         /**< constellation geometry */
+    float focal;              /**< camera focal length in pixels */
+    double pose_R[3][3];      /**< last pose, constellation to camera */
+    double pose_t[3];         /**< last pose translation, camera frame */
+    unsigned int pose_ids[4]; /**< dot id seen as each LED in the last pose, 0 if none */
+
+    int model;         /**< enum ir_tracker_model_t */
+    float lookahead;   /**< prediction horizon in seconds */
+    float accel_noise; /**< process noise density, 0 for the model default */
+    float meas_noise;  /**< measurement variance in pixels^2, 0 for the default */
+    int active;        /**< the state holds a track */
+    uint64_t last_us;  /**< time the state was predicted to */
+    uint64_t seen_us;  /**< time of the last measurement */
+    float x[3][WIIUSE_IR_TRACKER_STATES];                            /**< state per axis */
+    float P[3][WIIUSE_IR_TRACKER_STATES][WIIUSE_IR_TRACKER_STATES]; /**< covariance per axis */
+};
+
+/** @brief Period over which a rumble intensity is duty cycled */
+#define HAPTICS_PWM_PERIOD_US 20000
+
+/**
+ *	@brief Rumble pattern queue of a remote, played by wiiuse_rumble_update().
+ */
+struct haptics_t
+{
+    struct rumble_step_t steps[WIIUSE_RUMBLE_QUEUE_LEN]; /**< ring of pending steps, the first is playing */
+    unsigned int head;  /**< slot of the playing step */
+    unsigned int count; /**< steps queued, 0 when idle */
+    uint64_t start_us;  /**< when the playing step started, 0 if it has not yet */
+    uint64_t next_us;   /**< when the motor must switch or the step ends */
+};
+
+/**
+ *	@brief Accelerometer tables built from an accel_t calibration by
+ *	accel_build_lut(), indexed by axis and raw 8-bit reading.
+ */
+struct accel_lut_t
+{
+    float g[3][256];   /**< (raw - cal_zero) / cal_g, as calculate_gforce() returns it */
+    float rcp[3][256]; /**< 1 / |g| with g clamped to +/-1, 0 where g is 0 */
+};
+
 /** @brief Cross-platform call to sleep for at least the specified number
  * of milliseconds.
  *
@@ -306,6 +426,12 @@ extern "C" {
  */
 void wiiuse_millisleep(int durationMilliseconds);
 
+/** @brief All 24 orderings of four indices, for assigning IR dots to
+ * tracks or LEDs.
+ * Defined in ir_tracker.c
+ */
+extern const byte wiiuse_permutations4[24][4];
+
 int wiiuse_set_report_type(struct wiimote_t *wm);
 void wiiuse_send_next_pending_read_request(struct wiimote_t *wm);
 void wiiuse_send_next_pending_write_request(struct wiimote_t *wm);
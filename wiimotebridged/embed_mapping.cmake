@@ -0,0 +1,18 @@
+# Turn mapping.conf into the bridge's built-in mapping, so the file and the
+# mapping used without --config cannot drift apart.
+#
+#   cmake -DINPUT=mapping.conf -DOUTPUT=mapping_default.c -P embed_mapping.cmake
+
+file(READ "${INPUT}" content)
+
+# One C string literal per line; no list operations, mapping lines may hold ';'
+string(REPLACE "\r" "" content "${content}")
+string(REPLACE "\\" "\\\\" content "${content}")
+string(REPLACE "\"" "\\\"" content "${content}")
+string(REPLACE "\n" "\\n\"\n    \"" content "${content}")
+
+file(WRITE "${OUTPUT}"
+	"/* Generated from mapping.conf by embed_mapping.cmake, do not edit */\n\n"
+	"#include \"mapping.h\"\n\n"
+	"const char mapping_default[] =\n"
+	"    \"${content}\";\n")
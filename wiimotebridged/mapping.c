@@ -0,0 +1,445 @@
+#include "mapping.h"
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Where a field comes from
+enum {
+    SRC_WIIMOTE,
+    SRC_NUNCHUK,
+    SRC_CLASSIC,
+    SRC_BOARD,
+    SRC_MOTION_PLUS
+};
+
+// Continuous values, see mapping_read_value()
+enum {
+    F_ACCEL, F_ORIENT, F_GFORCE, F_IR, F_IR_POSE, F_IR_POSE_ORIENT,
+    F_NUNCHUK_JS, F_NUNCHUK_ACCEL, F_NUNCHUK_ORIENT, F_NUNCHUK_GFORCE,
+    F_CLASSIC_LJS, F_CLASSIC_RJS, F_CLASSIC_SHOULDERS,
+    F_BALANCE,
+    F_MP_RATES, F_MP_ORIENT, F_MP_QUAT,
+    F_BUTTON
+};
+
+typedef struct {
+    const char* name;
+    int value;      // F_* for values, F_BUTTON for buttons
+    int source;
+    int dim;
+    uint16_t mask;  // buttons only
+} field_t;
+
+static const field_t fields[] = {
+    { "a", F_BUTTON, SRC_WIIMOTE, 1, WIIMOTE_BUTTON_A },
+    { "b", F_BUTTON, SRC_WIIMOTE, 1, WIIMOTE_BUTTON_B },
+    { "one", F_BUTTON, SRC_WIIMOTE, 1, WIIMOTE_BUTTON_ONE },
+    { "two", F_BUTTON, SRC_WIIMOTE, 1, WIIMOTE_BUTTON_TWO },
+    { "plus", F_BUTTON, SRC_WIIMOTE, 1, WIIMOTE_BUTTON_PLUS },
+    { "minus", F_BUTTON, SRC_WIIMOTE, 1, WIIMOTE_BUTTON_MINUS },
+    { "home", F_BUTTON, SRC_WIIMOTE, 1, WIIMOTE_BUTTON_HOME },
+    { "up", F_BUTTON, SRC_WIIMOTE, 1, WIIMOTE_BUTTON_UP },
+    { "down", F_BUTTON, SRC_WIIMOTE, 1, WIIMOTE_BUTTON_DOWN },
+    { "left", F_BUTTON, SRC_WIIMOTE, 1, WIIMOTE_BUTTON_LEFT },
+    { "right", F_BUTTON, SRC_WIIMOTE, 1, WIIMOTE_BUTTON_RIGHT },
+    { "accel", F_ACCEL, SRC_WIIMOTE, 3, 0 },
+    { "orient", F_ORIENT, SRC_WIIMOTE, 3, 0 },
+    { "gforce", F_GFORCE, SRC_WIIMOTE, 3, 0 },
+    { "ir", F_IR, SRC_WIIMOTE, 3, 0 },
+    { "ir.pose", F_IR_POSE, SRC_WIIMOTE, 3, 0 },
+    { "ir.pose.orient", F_IR_POSE_ORIENT, SRC_WIIMOTE, 3, 0 },
+
+    { "nunchuk.c", F_BUTTON, SRC_NUNCHUK, 1, NUNCHUK_BUTTON_C },
+    { "nunchuk.z", F_BUTTON, SRC_NUNCHUK, 1, NUNCHUK_BUTTON_Z },
+    { "nunchuk.js", F_NUNCHUK_JS, SRC_NUNCHUK, 2, 0 },
+    { "nunchuk.accel", F_NUNCHUK_ACCEL, SRC_NUNCHUK, 3, 0 },
+    { "nunchuk.orient", F_NUNCHUK_ORIENT, SRC_NUNCHUK, 3, 0 },
+    { "nunchuk.gforce", F_NUNCHUK_GFORCE, SRC_NUNCHUK, 3, 0 },
+
+    { "classic.a", F_BUTTON, SRC_CLASSIC, 1, CLASSIC_CTRL_BUTTON_A },
+    { "classic.b", F_BUTTON, SRC_CLASSIC, 1, CLASSIC_CTRL_BUTTON_B },
+    { "classic.x", F_BUTTON, SRC_CLASSIC, 1, CLASSIC_CTRL_BUTTON_X },
+    { "classic.y", F_BUTTON, SRC_CLASSIC, 1, CLASSIC_CTRL_BUTTON_Y },
+    { "classic.zl", F_BUTTON, SRC_CLASSIC, 1, CLASSIC_CTRL_BUTTON_ZL },
+    { "classic.zr", F_BUTTON, SRC_CLASSIC, 1, CLASSIC_CTRL_BUTTON_ZR },
+    { "classic.l", F_BUTTON, SRC_CLASSIC, 1, CLASSIC_CTRL_BUTTON_FULL_L },
+    { "classic.r", F_BUTTON, SRC_CLASSIC, 1, CLASSIC_CTRL_BUTTON_FULL_R },
+    { "classic.plus", F_BUTTON, SRC_CLASSIC, 1, CLASSIC_CTRL_BUTTON_PLUS },
+    { "classic.minus", F_BUTTON, SRC_CLASSIC, 1, CLASSIC_CTRL_BUTTON_MINUS },
+    { "classic.home", F_BUTTON, SRC_CLASSIC, 1, CLASSIC_CTRL_BUTTON_HOME },
+    { "classic.up", F_BUTTON, SRC_CLASSIC, 1, CLASSIC_CTRL_BUTTON_UP },
+    { "classic.down", F_BUTTON, SRC_CLASSIC, 1, CLASSIC_CTRL_BUTTON_DOWN },
+    { "classic.left", F_BUTTON, SRC_CLASSIC, 1, CLASSIC_CTRL_BUTTON_LEFT },
+    { "classic.right", F_BUTTON, SRC_CLASSIC, 1, CLASSIC_CTRL_BUTTON_RIGHT },
+    { "classic.ljs", F_CLASSIC_LJS, SRC_CLASSIC, 2, 0 },
+    { "classic.rjs", F_CLASSIC_RJS, SRC_CLASSIC, 2, 0 },
+    { "classic.shoulders", F_CLASSIC_SHOULDERS, SRC_CLASSIC, 2, 0 },
+
+    { "balance", F_BALANCE, SRC_BOARD, 4, 0 },
+
+    { "motion_plus", F_MP_RATES, SRC_MOTION_PLUS, 3, 0 },
+    { "motion_plus.orient", F_MP_ORIENT, SRC_MOTION_PLUS, 3, 0 },
+    { "motion_plus.quat", F_MP_QUAT, SRC_MOTION_PLUS, 4, 0 },
+};
+#define NUM_FIELDS (int)(sizeof(fields) / sizeof(fields[0]))
+
+static const field_t* find_field(const char* name) {
+    int i;
+    for (i = 0; i < NUM_FIELDS; i++) {
+        if (strcmp(fields[i].name, name) == 0) {
+            return &fields[i];
+        }
+    }
+    return NULL;
+}
+
+const char* mapping_field_name(const mapping_entry_t* e) {
+    return fields[e->field].name;
+}
+
+// Parse "euro:1,0.01,1+median:3" into the entry, returns an error message or NULL
+static const char* parse_filters(mapping_entry_t* e, char* spec) {
+    char* save = NULL;
+    char* stage;
+
+    for (stage = strtok_r(spec, "+", &save); stage; stage = strtok_r(NULL, "+", &save)) {
+        float* p;
+        int n = 0;
+
+        if (e->num_filters >= WIIUSE_FILTER_MAX_STAGES) {
+            return "too many filter stages";
+        }
+        p = e->filters[e->num_filters].p;
+        if (strncmp(stage, "euro:", 5) == 0) {
+            n = sscanf(stage + 5, "%f,%f,%f", &p[0], &p[1], &p[2]) == 3;
+        } else if (strncmp(stage, "ema:", 4) == 0) {
+            n = sscanf(stage + 4, "%f", &p[0]) == 1 && p[0] > 0 && p[0] <= 1;
+        } else if (strncmp(stage, "median:", 7) == 0) {
+            n = sscanf(stage + 7, "%f", &p[0]) == 1 && p[0] >= 1 && p[0] <= WIIUSE_FILTER_MAX_MEDIAN;
+        } else if (strncmp(stage, "deadband:", 9) == 0) {
+            n = sscanf(stage + 9, "%f", &p[0]) == 1 && p[0] >= 0;
+        }
+        if (!n) {
+            return "expected euro:min_cutoff,beta,d_cutoff, ema:alpha, median:n or "
+                   "deadband:width joined by +";
+        }
+        e->filters[e->num_filters++].type = stage[0] == 'e' && stage[1] == 'm' ? 'a' : stage[0];
+    }
+    return NULL;
+}
+
+// Parse one "key=value" option into the entry, returns an error message or NULL
+static const char* parse_option(mapping_entry_t* e, char* opt) {
+    char* value = strchr(opt, '=');
+    char* end;
+
+    if (!value) {
+        return "expected key=value";
+    }
+    *value++ = '\0';
+
+    if (e->kind == MAPPING_BUTTON) {
+        return "buttons take no options";
+    }
+    if (strcmp(opt, "type") == 0) {
+        if (*value == ',') value++;
+        if ((int)strlen(value) != e->dim || strspn(value, "if") != strlen(value)) {
+            return "needs one 'i' or 'f' per component";
+        }
+        e->format[0] = ',';
+        strcpy(e->format + 1, value);
+    } else if (strcmp(opt, "when") == 0) {
+        const field_t* f = find_field(value);
+        if (!f || f->value != F_BUTTON || f->source != SRC_WIIMOTE) {
+            return "needs a Wiimote button";
+        }
+        e->when |= f->mask;
+    } else if (strcmp(opt, "filter") == 0) {
+        return parse_filters(e, value);
+    } else {
+        float number = strtof(value, &end);
+
+        if (strcmp(opt, "scale") != 0 && strcmp(opt, "offset") != 0 && strcmp(opt, "deadband") != 0
+            && strcmp(opt, "rate") != 0 && strcmp(opt, "heartbeat") != 0) {
+            return "unknown option";
+        }
+        if (*end || end == value) {
+            return "expected a number";
+        }
+        if (strcmp(opt, "scale") == 0) {
+            e->scale = number;
+        } else if (strcmp(opt, "offset") == 0) {
+            e->offset = number;
+        } else if (number < 0) {
+            return "must not be negative";
+        } else if (strcmp(opt, "deadband") == 0) {
+            e->deadband = number;
+        } else if (strcmp(opt, "rate") == 0) {
+            e->max_hz = number;
+        } else {
+            e->heartbeat_ms = (unsigned)number;
+        }
+    }
+    return NULL;
+}
+
+int mapping_compile(mapping_t* map, const char* text, const char* origin) {
+    const char* line = text;
+    int lineno = 0;
+
+    map->count = 0;
+    while (*line) {
+        const char* eol = strchr(line, '\n');
+        size_t len = eol ? (size_t)(eol - line) : strlen(line);
+        char buf[512];
+        char* save = NULL;
+        char *name, *address, *opt;
+        const char* error = NULL;
+        const field_t* f;
+        mapping_entry_t* e;
+
+        lineno++;
+        if (len >= sizeof(buf)) {
+            fprintf(stderr, "%s:%d: line too long\n", origin, lineno);
+            return -1;
+        }
+        memcpy(buf, line, len);
+        buf[len] = '\0';
+        line += eol ? len + 1 : len;
+        if (strchr(buf, '#')) {
+            *strchr(buf, '#') = '\0';
+        }
+
+        name = strtok_r(buf, " \t\r", &save);
+        if (!name) {
+            continue;
+        }
+        address = strtok_r(NULL, " \t\r", &save);
+        f = find_field(name);
+        if (!f) {
+            fprintf(stderr, "%s:%d: unknown field '%s'\n", origin, lineno, name);
+            return -1;
+        }
+        if (!address || address[0] != '/' || strlen(address) >= MAPPING_MAX_ADDRESS - 8) {
+            fprintf(stderr, "%s:%d: expected an OSC address starting with /\n", origin, lineno);
+            return -1;
+        }
+        if (map->count == MAPPING_MAX_ENTRIES) {
+            fprintf(stderr, "%s:%d: more than %d mappings\n", origin, lineno, MAPPING_MAX_ENTRIES);
+            return -1;
+        }
+
+        e = &map->entry[map->count];
+        memset(e, 0, sizeof(*e));
+        e->kind = f->value == F_BUTTON ? MAPPING_BUTTON : MAPPING_VALUE;
+        e->field = (int)(f - fields);
+        e->dim = f->dim;
+        e->scale = 1.0f;
+        strcpy(e->address, address);
+        e->format[0] = ',';
+        memset(e->format + 1, e->kind == MAPPING_BUTTON ? 'i' : 'f', e->dim);
+
+        while ((opt = strtok_r(NULL, " \t\r", &save))) {
+            error = parse_option(e, opt);
+            if (error) {
+                fprintf(stderr, "%s:%d: %s: %s\n", origin, lineno, opt, error);
+                return -1;
+            }
+        }
+        map->count++;
+    }
+    return 0;
+}
+
+int mapping_load(mapping_t* map, const char* path) {
+    FILE* f = fopen(path, "r");
+    mapping_t* next;
+    char* text;
+    long size;
+    int rc = -1;
+
+    if (!f) {
+        perror(path);
+        return -1;
+    }
+    fseek(f, 0, SEEK_END);
+    size = ftell(f);
+    rewind(f);
+
+    text = malloc(size + 1);
+    next = malloc(sizeof(*next));
+    if (text && next && fread(text, 1, size, f) == (size_t)size) {
+        text[size] = '\0';
+        if (mapping_compile(next, text, path) == 0) {
+            memcpy(map, next, sizeof(*map));
+            rc = 0;
+        }
+    } else {
+        fprintf(stderr, "%s: cannot read the mapping\n", path);
+    }
+
+    free(next);
+    free(text);
+    fclose(f);
+    return rc;
+}
+
+static bool has_nunchuk(const struct wiimote_t* wm) {
+    return wm->exp.type == EXP_NUNCHUK || wm->exp.type == EXP_MOTION_PLUS_NUNCHUK;
+}
+
+static bool has_classic(const struct wiimote_t* wm) {
+    return wm->exp.type == EXP_CLASSIC || wm->exp.type == EXP_MOTION_PLUS_CLASSIC;
+}
+
+static bool has_motion_plus(const struct wiimote_t* wm) {
+    return wm->exp.type == EXP_MOTION_PLUS || wm->exp.type == EXP_MOTION_PLUS_NUNCHUK
+        || wm->exp.type == EXP_MOTION_PLUS_CLASSIC;
+}
+
+static void copy3(float* v, float a, float b, float c) {
+    v[0] = a;
+    v[1] = b;
+    v[2] = c;
+}
+
+bool mapping_read_value(const mapping_entry_t* e, struct wiimote_t* wm, float* v) {
+    const struct nunchuk_t* nc = &wm->exp.nunchuk;
+    const struct classic_ctrl_t* cc = &wm->exp.classic;
+    const struct motion_plus_t* mp = &wm->exp.mp;
+
+    switch (fields[e->field].value) {
+        case F_ACCEL:
+            copy3(v, wm->accel.x, wm->accel.y, wm->accel.z);
+            return WIIUSE_USING_ACC(wm);
+        case F_ORIENT:
+            copy3(v, wm->orient.roll, wm->orient.pitch, wm->orient.yaw);
+            return WIIUSE_USING_ACC(wm);
+        case F_GFORCE:
+            copy3(v, wm->gforce.x, wm->gforce.y, wm->gforce.z);
+            return WIIUSE_USING_ACC(wm);
+        case F_IR:
+            // the cursor, while the sensor bar is in view or the tracker coasts
+            copy3(v, wm->ir.x, wm->ir.y, wm->ir.z);
+            return WIIUSE_USING_IR(wm) && (wm->ir.num_dots > 0 || wm->ir.coasting);
+        case F_IR_POSE:
+            copy3(v, wm->ir_pose.x, wm->ir_pose.y, wm->ir_pose.z);
+            return WIIUSE_USING_IR(wm) && wm->ir_pose.valid;
+        case F_IR_POSE_ORIENT:
+            copy3(v, wm->ir_pose.orient.roll, wm->ir_pose.orient.pitch, wm->ir_pose.orient.yaw);
+            return WIIUSE_USING_IR(wm) && wm->ir_pose.valid;
+        case F_NUNCHUK_JS:
+            v[0] = nc->js.x;
+            v[1] = nc->js.y;
+            return has_nunchuk(wm);
+        case F_NUNCHUK_ACCEL:
+            copy3(v, nc->accel.x, nc->accel.y, nc->accel.z);
+            return has_nunchuk(wm);
+        case F_NUNCHUK_ORIENT:
+            copy3(v, nc->orient.roll, nc->orient.pitch, nc->orient.yaw);
+            return has_nunchuk(wm);
+        case F_NUNCHUK_GFORCE:
+            copy3(v, nc->gforce.x, nc->gforce.y, nc->gforce.z);
+            return has_nunchuk(wm);
+        case F_CLASSIC_LJS:
+            v[0] = cc->ljs.x;
+            v[1] = cc->ljs.y;
+            return has_classic(wm);
+        case F_CLASSIC_RJS:
+            v[0] = cc->rjs.x;
+            v[1] = cc->rjs.y;
+            return has_classic(wm);
+        case F_CLASSIC_SHOULDERS:
+            v[0] = cc->l_shoulder;
+            v[1] = cc->r_shoulder;
+            return has_classic(wm);
+        case F_BALANCE:
+            v[0] = wm->exp.wb.tl;
+            v[1] = wm->exp.wb.tr;
+            v[2] = wm->exp.wb.bl;
+            v[3] = wm->exp.wb.br;
+            return wm->exp.type == EXP_WII_BOARD;
+        case F_MP_RATES:
+            copy3(v, mp->angle_rate_gyro.roll, mp->angle_rate_gyro.pitch, mp->angle_rate_gyro.yaw);
+            return has_motion_plus(wm);
+        case F_MP_ORIENT:
+            copy3(v, mp->orient.roll, mp->orient.pitch, mp->orient.yaw);
+            return has_motion_plus(wm);
+        case F_MP_QUAT:
+            v[0] = mp->quat.w;
+            v[1] = mp->quat.x;
+            v[2] = mp->quat.y;
+            v[3] = mp->quat.z;
+            return has_motion_plus(wm);
+    }
+    return false;
+}
+
+bool mapping_read_button(const mapping_entry_t* e, struct wiimote_t* wm, bool* pressed, bool* released) {
+    const field_t* f = &fields[e->field];
+    int btns = 0, btns_held = 0, btns_released = 0;
+
+    switch (f->source) {
+        case SRC_WIIMOTE:
+            btns = wm->btns;
+            btns_held = wm->btns_held;
+            btns_released = wm->btns_released;
+            break;
+        case SRC_NUNCHUK:
+            if (has_nunchuk(wm)) {
+                btns = wm->exp.nunchuk.btns;
+                btns_held = wm->exp.nunchuk.btns_held;
+                btns_released = wm->exp.nunchuk.btns_released;
+            }
+            break;
+        case SRC_CLASSIC:
+            if (has_classic(wm)) {
+                btns = (uint16_t)wm->exp.classic.btns;
+                btns_held = (uint16_t)wm->exp.classic.btns_held;
+                btns_released = (uint16_t)wm->exp.classic.btns_released;
+            }
+            break;
+    }
+    *pressed = (btns & f->mask) == f->mask && (btns_held & f->mask) != f->mask;
+    *released = (btns_released & f->mask) != 0;
+    return (btns & f->mask) == f->mask;
+}
+
+void mapping_init_filter(const mapping_entry_t* e, struct filter_chain_t* fc) {
+    int i;
+
+    wiiuse_filter_init(fc, e->dim);
+    for (i = 0; i < e->num_filters; i++) {
+        const float* p = e->filters[i].p;
+        switch (e->filters[i].type) {
+            case 'e':
+                wiiuse_filter_add_one_euro(fc, p[0], p[1], p[2]);
+                break;
+            case 'a':
+                wiiuse_filter_add_ema(fc, p[0]);
+                break;
+            case 'm':
+                wiiuse_filter_add_median(fc, (unsigned int)p[0]);
+                break;
+            case 'd':
+                wiiuse_filter_add_deadband(fc, p[0]);
+                break;
+        }
+    }
+}
+
+void mapping_address(const mapping_entry_t* e, int id, char* out, size_t size) {
+    const char* in = e->address;
+    size_t n = 0;
+
+    while (*in && n + 1 < size) {
+        if (strncmp(in, "{id}", 4) == 0) {
+            n += snprintf(out + n, size - n, "%d", id);
+            in += 4;
+        } else {
+            out[n++] = *in++;
+        }
+    }
+    out[n < size ? n : size - 1] = '\0';
+}
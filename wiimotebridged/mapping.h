@@ -0,0 +1,108 @@
+#ifndef MAPPING_H_INCLUDED
+#define MAPPING_H_INCLUDED
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "wiiuse.h"
+
+#define MAPPING_MAX_ENTRIES 64
+#define MAPPING_MAX_DIM WIIUSE_FILTER_MAX_DIM
+#define MAPPING_MAX_ADDRESS 64
+
+typedef enum {
+    MAPPING_BUTTON,     // 1 while held, 0 on release
+    MAPPING_VALUE       // continuous value, sent on change
+} mapping_kind_t;
+
+/**
+ * @brief One compiled line of a mapping file
+ */
+typedef struct {
+    mapping_kind_t kind;
+    int field;                          // index in the field catalogue
+    int dim;                            // components of the value, 1 for buttons
+    char address[MAPPING_MAX_ADDRESS];  // "{id}" stands for the remote id
+    char format[MAPPING_MAX_DIM + 2];   // OSC type tags, e.g. ",iif"
+    float scale, offset;                // applied to every component before sending
+    uint16_t when;                      // Wiimote buttons that must be held, 0 for always
+    float deadband;                     // see the bridge's channel_service()
+    float max_hz;
+    unsigned heartbeat_ms;
+    int num_filters;
+    struct {
+        char type;                      // 'e'uro, 'a' (EMA), 'm'edian, 'd'eadband
+        float p[3];
+    } filters[WIIUSE_FILTER_MAX_STAGES];
+} mapping_entry_t;
+
+/**
+ * @brief A compiled mapping file, walked once per report
+ */
+typedef struct {
+    int count;
+    mapping_entry_t entry[MAPPING_MAX_ENTRIES];
+} mapping_t;
+
+/**
+ * @brief Mapping used without a mapping file: mapping.conf, embedded at
+ * build time by embed_mapping.cmake
+ */
+extern const char mapping_default[];
+
+/**
+ * @brief Compile mapping text
+ *
+ * @param map Table to fill in
+ * @param text Mapping lines, see mapping.conf
+ * @param origin File name for error messages
+ * @return int 0 on success, -1 after printing the first error
+ */
+int mapping_compile(mapping_t* map, const char* text, const char* origin);
+
+/**
+ * @brief Read and compile a mapping file
+ *
+ * @param map Table to fill in, left alone on error
+ * @param path Mapping file
+ * @return int 0 on success, -1 on error
+ */
+int mapping_load(mapping_t* map, const char* path);
+
+/**
+ * @brief Name of the field an entry reads, as written in the mapping file
+ */
+const char* mapping_field_name(const mapping_entry_t* e);
+
+/**
+ * @brief Read the value of a MAPPING_VALUE entry
+ *
+ * @param e Entry
+ * @param wm Remote
+ * @param v Receives e->dim components, unscaled
+ * @return bool false if the remote does not produce the value right now
+ */
+bool mapping_read_value(const mapping_entry_t* e, struct wiimote_t* wm, float* v);
+
+/**
+ * @brief Read the state of a MAPPING_BUTTON entry
+ *
+ * @param e Entry
+ * @param wm Remote
+ * @param pressed Set if the button was pressed by this report
+ * @param released Set if the button was released by this report
+ * @return bool true while the button is down
+ */
+bool mapping_read_button(const mapping_entry_t* e, struct wiimote_t* wm, bool* pressed, bool* released);
+
+/**
+ * @brief Set up the filter chain of an entry
+ */
+void mapping_init_filter(const mapping_entry_t* e, struct filter_chain_t* fc);
+
+/**
+ * @brief Expand the address of an entry for a remote
+ */
+void mapping_address(const mapping_entry_t* e, int id, char* out, size_t size);
+
+#endif /* MAPPING_H_INCLUDED */
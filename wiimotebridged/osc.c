@@ -1,4 +1,7 @@
+#define _GNU_SOURCE     // for sendmmsg
 #include "osc.h"
+#include <errno.h>
+#include <fcntl.h>
 #include <stdarg.h>
 #include <stdio.h>
 #include <math.h>
@@ -316,6 +319,15 @@ int osc_init(osc_client_t* client) {
     client->server_addr.sin_port = htons(client->port);
     
     if (inet_pton(AF_INET, client->host, &client->server_addr.sin_addr) <= 0) {
+        close(client->sock);
+        return -1;
+    }
+
+    // Connected once, so sending skips the per-packet route lookup, and
+    // non-blocking, so a full socket buffer drops data instead of stalling
+    if (connect(client->sock, (struct sockaddr*)&client->server_addr, sizeof(client->server_addr)) < 0
+        || fcntl(client->sock, F_SETFL, fcntl(client->sock, F_GETFL) | O_NONBLOCK) < 0) {
+        close(client->sock);
         return -1;
     }
 
@@ -353,18 +365,23 @@ static void add_osc_int(char* buffer, int* offset, int32_t value) {
     *offset += 4;
 }
 
-int osc_send_message(osc_client_t* client, const char* address, const char* format, ...) {
-    va_list args;
+// Encode one message into buffer, returns its length or -1 if it does not fit
+static int build_osc_message(char* buffer, const char* address, const char* format, va_list args) {
     int offset = 0;
-    char* buffer = client->buffer;
+    const char* fmt = format;
+    
+    if (*fmt == ',') fmt++; // Skip leading comma if present
+    
+    // Address, type tags and worst case padding must fit before any argument
+    if (strlen(address) + strlen(fmt) + 10 > OSC_MAX_MESSAGE_SIZE) {
+        return -1;
+    }
     
     // Add OSC address
     add_osc_string(buffer, &offset, address);
     
     // Add type tag string
     buffer[offset++] = ',';
-    const char* fmt = format;
-    if (*fmt == ',') fmt++; // Skip leading comma if present
     strcpy(buffer + offset, fmt);
     offset += strlen(fmt);
     // Add null terminator and pad to multiple of 4 bytes
@@ -373,68 +390,285 @@ int osc_send_message(osc_client_t* client, const char* address, const char* form
     offset += pad;
     
     // Add arguments
-    va_start(args, format);
     for (const char* p = fmt; *p != '\0'; p++) {
         switch (*p) {
             case 'f': {
                 float value = (float)va_arg(args, double);
+                if (offset + 4 > OSC_MAX_MESSAGE_SIZE) return -1;
                 add_osc_float(buffer, &offset, value);
                 break;
             }
             case 'i': {
                 int32_t value = va_arg(args, int32_t);
+                if (offset + 4 > OSC_MAX_MESSAGE_SIZE) return -1;
                 add_osc_int(buffer, &offset, value);
                 break;
             }
             case 's': {
                 const char* str = va_arg(args, const char*);
+                if (offset + (int)strlen(str) + 4 > OSC_MAX_MESSAGE_SIZE) return -1;
                 add_osc_string(buffer, &offset, str);
                 break;
             }
+            case 'h': {
+                int64_t value = va_arg(args, int64_t);
+                if (offset + 8 > OSC_MAX_MESSAGE_SIZE) return -1;
+                add_osc_int(buffer, &offset, (int32_t)(value >> 32));
+                add_osc_int(buffer, &offset, (int32_t)value);
+                break;
+            }
+            case 'b': {
+                // Two arguments: int length, then const void* data
+                int len = va_arg(args, int);
+                const void* data = va_arg(args, const void*);
+                int padded = (len + 3) / 4 * 4;
+                if (len < 0 || offset + 4 + padded > OSC_MAX_MESSAGE_SIZE) return -1;
+                add_osc_int(buffer, &offset, len);
+                memcpy(buffer + offset, data, len);
+                memset(buffer + offset + len, 0, padded - len);
+                offset += padded;
+                break;
+            }
             // Add more types as needed
         }
     }
-    va_end(args);
     
-    return sendto(client->sock, buffer, offset, 0,
-                 (struct sockaddr*)&client->server_addr,
-                 sizeof(client->server_addr));
+    return offset;
 }
 
-void moving_average_init(moving_average_t* filter, float threshold) {
-    memset(filter->values, 0, sizeof(filter->values));
-    filter->index = 0;
-    filter->sum = 0;
-    filter->count = 0;
-    filter->last_sent = 0;
-    filter->threshold = threshold;
-    filter->should_send = false;
+// Account for a datagram the kernel refused
+static void count_error(osc_client_t* client, int err) {
+    if (err == ENOBUFS || err == EAGAIN || err == EWOULDBLOCK) {
+        client->stats.dropped++;
+    } else {
+        client->stats.failed++;
+    }
+    client->stats.last_errno = err;
 }
 
-float moving_average_update(moving_average_t* filter, float value) {
-    // Subtract the oldest value from sum
-    if (filter->count == OSC_MOVING_AVERAGE_WINDOW) {
-        filter->sum -= filter->values[filter->index];
+// Hand every queued datagram to the kernel in one sendmmsg() call
+static int flush_queue(osc_client_t* client) {
+    struct mmsghdr msgs[OSC_MAX_QUEUED_PACKETS];
+    struct iovec iov[OSC_MAX_QUEUED_PACKETS];
+    int i, done = 0, total = 0;
+
+    for (i = 0; i < client->queue_len; i++) {
+        iov[i].iov_base = client->queue[i];
+        iov[i].iov_len = client->queue_sizes[i];
+        memset(&msgs[i].msg_hdr, 0, sizeof(msgs[i].msg_hdr));
+        msgs[i].msg_hdr.msg_iov = &iov[i];
+        msgs[i].msg_hdr.msg_iovlen = 1;
+    }
+
+    // sendmmsg() stops at the first datagram that fails: count it lost and go on
+    while (done < client->queue_len) {
+        int n = sendmmsg(client->sock, msgs + done, client->queue_len - done, 0);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            count_error(client, errno);
+            done++;
+            continue;
+        }
+        for (i = done; i < done + n; i++) {
+            total += msgs[i].msg_len;
+        }
+        client->stats.packets += n;
+        done += n;
     }
+    client->stats.bytes += total;
+
+    client->queue_len = 0;
+    return total;
+}
+
+static int send_packet(osc_client_t* client, const char* data, int len) {
+    int sent;
+
+    if (client->queueing) {
+        if (client->queue_len == OSC_MAX_QUEUED_PACKETS) {
+            flush_queue(client);
+        }
+        memcpy(client->queue[client->queue_len], data, len);
+        client->queue_sizes[client->queue_len++] = len;
+        return len;
+    }
+
+    sent = send(client->sock, data, len, 0);
+    if (sent < 0) {
+        count_error(client, errno);
+        return -1;
+    }
+    client->stats.packets++;
+    client->stats.bytes += sent;
+    return sent;
+}
+
+void osc_queue_begin(osc_client_t* client) {
+    client->queueing = true;
+}
+
+int osc_queue_flush(osc_client_t* client) {
+    client->queueing = false;
+    return flush_queue(client);
+}
+
+
+
+// Start a fresh "#bundle" header with the current timetag
+static void reset_bundle(osc_client_t* client) {
+    int offset = 0;
     
-    // Add new value
-    filter->values[filter->index] = value;
-    filter->sum += value;
+    add_osc_string(client->bundle, &offset, "#bundle");
+    add_osc_int(client->bundle, &offset, (int32_t)(client->timetag >> 32));
+    add_osc_int(client->bundle, &offset, (int32_t)(client->timetag & 0xffffffffu));
+    client->bundle_len = offset;
+    client->bundle_count = 0;
+}
+
+// Send what the bundle holds so far, keeping it open
+static int flush_bundle(osc_client_t* client) {
+    int sent = 0;
     
-    // Update count and index
-    if (filter->count < OSC_MOVING_AVERAGE_WINDOW) {
-        filter->count++;
+    if (client->bundle_count == 1) {
+        // A lone element goes out as a plain message
+        sent = send_packet(client, client->bundle + 20, client->bundle_len - 20);
+    } else if (client->bundle_count > 1) {
+        sent = send_packet(client, client->bundle, client->bundle_len);
     }
-    filter->index = (filter->index + 1) % OSC_MOVING_AVERAGE_WINDOW;
+    reset_bundle(client);
+    return sent;
+}
+
+void osc_bundle_begin(osc_client_t* client, uint64_t timetag) {
+    client->timetag = timetag;
+    reset_bundle(client);
+}
+
+int osc_bundle_end(osc_client_t* client) {
+    int sent;
     
-    // Calculate average
-    float avg = filter->sum / filter->count;
+    if (client->bundle_len == 0) {
+        return 0;
+    }
+    sent = flush_bundle(client);
+    client->bundle_len = 0;
+    return sent;
+}
+
+// Where to encode the next message of len bytes: the open bundle or the buffer
+static char* message_slot(osc_client_t* client, int len) {
+    if (client->bundle_len == 0) {
+        return client->buffer;
+    }
+    // Split at the MTU: send what is queued and start another bundle
+    if (client->bundle_len + 4 + len > OSC_MAX_PACKET_SIZE && flush_bundle(client) < 0) {
+        return NULL;
+    }
+    return client->bundle + client->bundle_len + 4;
+}
+
+// Send the message encoded in its slot, or account for it in the bundle
+static int finish_message(osc_client_t* client, int len) {
+    if (client->bundle_len == 0) {
+        return send_packet(client, client->buffer, len);
+    }
+    add_osc_int(client->bundle, &client->bundle_len, len);
+    client->bundle_len += len;
+    client->bundle_count++;
+    return len;
+}
+
+int osc_send_message(osc_client_t* client, const char* address, const char* format, ...) {
+    va_list args;
+    char* msg;
+    int len;
+    
+    va_start(args, format);
+    len = build_osc_message(client->buffer, address, format, args);
+    va_end(args);
+    if (len < 0) {
+        return -1;
+    }
+    
+    msg = message_slot(client, len);
+    if (!msg) {
+        return -1;
+    }
+    if (msg != client->buffer) {
+        memcpy(msg, client->buffer, len);
+    }
+    return finish_message(client, len);
+}
+
+int osc_template_init(osc_client_t* client, osc_template_t* tmpl, const char* address, const char* format) {
+    const char* fmt = format;
+    char tags[OSC_MAX_MESSAGE_SIZE / 4];
+    int header_len;
     
-    // Check if change is significant
-    filter->should_send = (fabs(avg - filter->last_sent) > filter->threshold);
-    if (filter->should_send) {
-        filter->last_sent = avg;
+    tmpl->len = 0;
+    if (*fmt == ',') fmt++;
+    if (strspn(fmt, "if") != strlen(fmt) || strlen(fmt) + 1 >= sizeof(tags)) {
+        return -1;
+    }
+    
+    // Worst case padding, checked before writing into the cache
+    header_len = (strlen(address) + 4) / 4 * 4 + (strlen(fmt) + 5) / 4 * 4;
+    if (client->templates_len + header_len > OSC_TEMPLATE_CACHE_SIZE
+        || header_len + 4 * (int)strlen(fmt) > OSC_MAX_MESSAGE_SIZE) {
+        return -1;
+    }
+    
+    tmpl->offset = client->templates_len;
+    header_len = 0;
+    tags[0] = ',';
+    strcpy(tags + 1, fmt);
+    add_osc_string(client->templates + tmpl->offset, &header_len, address);
+    add_osc_string(client->templates + tmpl->offset, &header_len, tags);
+    
+    tmpl->header_len = header_len;
+    tmpl->len = header_len + 4 * strlen(fmt);
+    client->templates_len += header_len;
+    return 0;
+}
+
+void osc_template_reset(osc_client_t* client) {
+    client->templates_len = 0;
+}
+
+int osc_send_template(osc_client_t* client, const osc_template_t* tmpl, const osc_arg_t* args) {
+    char* msg;
+    int offset;
+    
+    if (tmpl->len == 0) {
+        return -1;
+    }
+    msg = message_slot(client, tmpl->len);
+    if (!msg) {
+        return -1;
+    }
+    memcpy(msg, client->templates + tmpl->offset, tmpl->header_len);
+    for (offset = tmpl->header_len; offset < tmpl->len; offset += 4, args++) {
+        uint32_t word = htonl(args->bits);
+        memcpy(msg + offset, &word, 4);
     }
+    return finish_message(client, tmpl->len);
+}
+
+int osc_send_int(osc_client_t* client, const osc_template_t* tmpl, int32_t value) {
+    osc_arg_t arg;
+    
+    arg.i = value;
+    return osc_send_template(client, tmpl, &arg);
+}
+
+int osc_send_floats(osc_client_t* client, const osc_template_t* tmpl, const float* values) {
+    osc_arg_t args[OSC_MAX_MESSAGE_SIZE / 4];
+    int i, n = (tmpl->len - tmpl->header_len) / 4;
     
-    return avg;
-} 
\ No newline at end of file
+    for (i = 0; i < n; i++) {
+        args[i].f = values[i];
+    }
+    return osc_send_template(client, tmpl, args);
+}
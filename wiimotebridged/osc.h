@@ -14,32 +14,68 @@
 #include <avahi-common/error.h>
 
 #define OSC_MAX_MESSAGE_SIZE 1024
-#define OSC_MOVING_AVERAGE_WINDOW 5
+#define OSC_MAX_PACKET_SIZE 1472        // Ethernet MTU minus IPv4 and UDP headers
+#define OSC_TIMETAG_IMMEDIATE 1ULL
+#define OSC_TEMPLATE_CACHE_SIZE 20480   // a full mapping file for four remotes
+#define OSC_MAX_QUEUED_PACKETS 16
 #define SERVICE_TYPE "_osc._udp"
 #define TARGET_SERVICE_NAME "AgapeKidAvatarBridge"
 
+/**
+ * @brief Pre-encoded message: padded address and type tags, stored in the
+ * client's template cache, followed by one 4 byte slot per argument
+ */
+typedef struct {
+    int offset;         // start in the template cache
+    int header_len;     // address and type tags
+    int len;            // whole message, 0 if the template is unusable
+} osc_template_t;
+
+/**
+ * @brief One 'i' or 'f' argument of a template
+ */
+typedef union {
+    int32_t i;
+    float f;
+    uint32_t bits;
+} osc_arg_t;
+
+/**
+ * @brief Delivery counters for one destination
+ */
+typedef struct {
+    unsigned long packets;      // datagrams handed to the kernel
+    unsigned long bytes;
+    unsigned long dropped;      // lost to a full socket buffer (ENOBUFS, EAGAIN)
+    unsigned long failed;       // lost to any other error, e.g. ECONNREFUSED
+    int last_errno;
+} osc_stats_t;
+
 typedef struct {
     int sock;
     struct sockaddr_in server_addr;
     char buffer[OSC_MAX_MESSAGE_SIZE];
+    char bundle[OSC_MAX_PACKET_SIZE];   // #bundle being assembled
+    int bundle_len;                     // bytes in bundle, 0 when none is open
+    int bundle_count;                   // messages in bundle
+    uint64_t timetag;                   // shared by every packet of the bundle
+    char templates[OSC_TEMPLATE_CACHE_SIZE];    // shared by all templates
+    int templates_len;
+    bool queueing;                      // between osc_queue_begin() and osc_queue_flush()
+    char queue[OSC_MAX_QUEUED_PACKETS][OSC_MAX_PACKET_SIZE];
+    int queue_sizes[OSC_MAX_QUEUED_PACKETS];
+    int queue_len;
+    osc_stats_t stats;
     bool discovered;
     char host[256];
     int port;
 } osc_client_t;
 
-typedef struct {
-    float values[OSC_MOVING_AVERAGE_WINDOW];
-    int index;
-    float sum;
-    int count;
-    float last_sent;
-    float threshold;
-    bool should_send;
-} moving_average_t;
-
 /**
  * @brief Initialize OSC client with discovered server info
  * 
+ * The socket is connected to the server and non-blocking.
+ * 
  * @param client Pointer to osc_client_t structure
  * @return int 0 on success, -1 on failure
  */
@@ -48,30 +84,39 @@ int osc_init(osc_client_t* client);
 /**
  * @brief Send OSC message
  * 
+ * While a bundle is open the message is queued in it instead, and only
+ * goes out when the bundle is flushed.
+ * 
  * @param client Pointer to osc_client_t structure
  * @param address OSC address pattern
- * @param format OSC type tag string
+ * @param format OSC type tag string of i, f, s, h (int64_t) and b, which
+ * takes two arguments: the int length and a pointer to the blob
  * @param ... Variable arguments based on format string
- * @return int Number of bytes sent or -1 on error
+ * @return int Number of bytes sent or queued, or -1 on error
  */
 int osc_send_message(osc_client_t* client, const char* address, const char* format, ...);
 
 /**
- * @brief Initialize moving average filter
+ * @brief Start collecting messages into a #bundle
+ * 
+ * Messages sent until osc_bundle_end() share one datagram. A bundle that
+ * would exceed OSC_MAX_PACKET_SIZE is split into several datagrams with
+ * the same timetag.
  * 
- * @param filter Pointer to moving_average_t structure
- * @param threshold Change threshold to trigger sending
+ * @param client Pointer to osc_client_t structure
+ * @param timetag NTP timetag, or OSC_TIMETAG_IMMEDIATE
  */
-void moving_average_init(moving_average_t* filter, float threshold);
+void osc_bundle_begin(osc_client_t* client, uint64_t timetag);
 
 /**
- * @brief Update moving average filter with new value
+ * @brief Send the open bundle and close it
+ * 
+ * A bundle holding a single message is sent as a plain message.
  * 
- * @param filter Pointer to moving_average_t structure
- * @param value New value to add
- * @return float Current average if change > threshold, or 0 if no significant change
+ * @param client Pointer to osc_client_t structure
+ * @return int Number of bytes sent (0 if the bundle was empty) or -1 on error
  */
-float moving_average_update(moving_average_t* filter, float value);
+int osc_bundle_end(osc_client_t* client);
 
 /**
  * @brief Discover OSC server using Zeroconf
@@ -81,4 +126,67 @@ float moving_average_update(moving_average_t* filter, float value);
  */
 int osc_discover_server(osc_client_t* client);
 
+/**
+ * @brief Hold outgoing datagrams until osc_queue_flush()
+ * 
+ * Meant to span one poll iteration, so the packets of every device go out
+ * in a single sendmmsg() call. A full queue is flushed early.
+ * 
+ * @param client Pointer to osc_client_t structure
+ */
+void osc_queue_begin(osc_client_t* client);
+
+/**
+ * @brief Send the queued datagrams and stop queueing
+ * 
+ * Datagrams the kernel refuses are counted in client->stats.
+ * 
+ * @param client Pointer to osc_client_t structure
+ * @return int Number of bytes sent
+ */
+int osc_queue_flush(osc_client_t* client);
+
+/**
+ * @brief Pre-encode a message whose arguments change from send to send
+ * 
+ * Only 'i' and 'f' arguments are supported, so that sending patches fixed
+ * 4 byte slots. Templates live in the client until osc_template_reset().
+ * 
+ * @param client Pointer to osc_client_t structure
+ * @param tmpl Template to fill in
+ * @param address OSC address pattern
+ * @param format OSC type tag string made of 'i' and 'f'
+ * @return int 0 on success, -1 if the format is unsupported or the cache is full
+ */
+int osc_template_init(osc_client_t* client, osc_template_t* tmpl, const char* address, const char* format);
+
+/**
+ * @brief Forget all templates, e.g. to build a new set of messages
+ * 
+ * Templates initialized before must not be sent afterwards.
+ * 
+ * @param client Pointer to osc_client_t structure
+ */
+void osc_template_reset(osc_client_t* client);
+
+/**
+ * @brief Send a templated message, or queue it in the open bundle
+ * 
+ * @param client Pointer to osc_client_t structure
+ * @param tmpl Template from osc_template_init()
+ * @param args One value per type tag
+ * @return int Number of bytes sent or queued, or -1 on error
+ */
+int osc_send_template(osc_client_t* client, const osc_template_t* tmpl, const osc_arg_t* args);
+
+/**
+ * @brief Send a templated message with a single 'i' argument
+ */
+int osc_send_int(osc_client_t* client, const osc_template_t* tmpl, int32_t value);
+
+/**
+ * @brief Send a templated message whose arguments are all 'f'
+ */
+int osc_send_floats(osc_client_t* client, const osc_template_t* tmpl, const float* values);
+
 #endif /* OSC_H_INCLUDED */ 
\ No newline at end of file
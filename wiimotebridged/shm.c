@@ -0,0 +1,179 @@
+#include "shm.h"
+#include <fcntl.h>
+#include <stdio.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+// Seqlock writer: readers retry while seq is odd or after it moved
+static void write_begin(wiimote_shm_state_t* s) {
+    __atomic_store_n(&s->seq, s->seq + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+}
+
+static void write_end(wiimote_shm_state_t* s) {
+    __atomic_store_n(&s->seq, s->seq + 1, __ATOMIC_RELEASE);
+}
+
+static void copy3(float* out, float a, float b, float c) {
+    out[0] = a;
+    out[1] = b;
+    out[2] = c;
+}
+
+int shm_publisher_open(shm_publisher_t* pub, const char* name, int num_remotes) {
+    wiimote_shm_t* shm;
+    int fd, i;
+
+    pub->shm = NULL;
+    snprintf(pub->name, sizeof(pub->name), "%s", name);
+
+    fd = shm_open(pub->name, O_RDWR | O_CREAT, 0644);
+    if (fd < 0) {
+        perror(pub->name);
+        return -1;
+    }
+    if (ftruncate(fd, sizeof(wiimote_shm_t)) < 0) {
+        perror(pub->name);
+        close(fd);
+        return -1;
+    }
+    shm = mmap(NULL, sizeof(wiimote_shm_t), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (shm == MAP_FAILED) {
+        perror(pub->name);
+        return -1;
+    }
+
+    // Readers may still map the segment of a previous bridge: keep their
+    // sequence numbers moving forward and switch the layout fields last
+    for (i = 0; i < WIIMOTE_SHM_MAX_REMOTES; i++) {
+        wiimote_shm_state_t* s = &shm->remote[i];
+        uint32_t seq = s->seq & ~1u;
+
+        __atomic_store_n(&s->seq, seq + 1, __ATOMIC_RELAXED);
+        __atomic_thread_fence(__ATOMIC_RELEASE);
+        memset((char*)s + sizeof(s->seq), 0, sizeof(*s) - sizeof(s->seq));
+        s->id = -1;
+        __atomic_store_n(&s->seq, seq + 2, __ATOMIC_RELEASE);
+    }
+    shm->version = WIIMOTE_SHM_VERSION;
+    shm->state_size = sizeof(wiimote_shm_state_t);
+    shm->num_remotes = num_remotes;
+    __atomic_store_n(&shm->magic, WIIMOTE_SHM_MAGIC, __ATOMIC_RELEASE);
+
+    pub->shm = shm;
+    return 0;
+}
+
+void shm_publish(shm_publisher_t* pub, int index, int id, struct wiimote_t* wm, uint64_t now) {
+    wiimote_shm_state_t* s;
+    const struct nunchuk_t* nc = &wm->exp.nunchuk;
+    const struct classic_ctrl_t* cc = &wm->exp.classic;
+    const struct motion_plus_t* mp = &wm->exp.mp;
+    uint16_t flags = 0;
+
+    if (!pub->shm) {
+        return;
+    }
+    s = &pub->shm->remote[index];
+    write_begin(s);
+
+    s->id = id;
+    s->connected = 1;
+    s->exp_type = wm->exp.type;
+    s->report_us = wm->timestamp_us;
+    s->publish_us = now;
+    s->reports++;
+    s->btns = wm->btns;
+    s->battery = wm->battery_level;
+
+    if (WIIUSE_USING_ACC(wm)) {
+        flags |= WIIMOTE_SHM_HAS_ACCEL;
+        copy3(s->accel, wm->accel.x, wm->accel.y, wm->accel.z);
+        copy3(s->orient, wm->orient.roll, wm->orient.pitch, wm->orient.yaw);
+        copy3(s->gforce, wm->gforce.x, wm->gforce.y, wm->gforce.z);
+    }
+    if (WIIUSE_USING_IR(wm) && (wm->ir.num_dots > 0 || wm->ir.coasting)) {
+        flags |= WIIMOTE_SHM_HAS_IR;
+        copy3(s->ir, wm->ir.x, wm->ir.y, wm->ir.z);
+    }
+    if (WIIUSE_USING_IR(wm) && wm->ir_pose.valid) {
+        flags |= WIIMOTE_SHM_HAS_IR_POSE;
+        copy3(s->ir_pose, wm->ir_pose.x, wm->ir_pose.y, wm->ir_pose.z);
+        copy3(s->ir_pose_orient, wm->ir_pose.orient.roll, wm->ir_pose.orient.pitch, wm->ir_pose.orient.yaw);
+    }
+
+    switch (wm->exp.type) {
+        case EXP_NUNCHUK:
+        case EXP_MOTION_PLUS_NUNCHUK:
+            flags |= WIIMOTE_SHM_HAS_NUNCHUK;
+            s->nunchuk_btns = nc->btns;
+            s->nunchuk_js[0] = nc->js.x;
+            s->nunchuk_js[1] = nc->js.y;
+            copy3(s->nunchuk_accel, nc->accel.x, nc->accel.y, nc->accel.z);
+            copy3(s->nunchuk_orient, nc->orient.roll, nc->orient.pitch, nc->orient.yaw);
+            copy3(s->nunchuk_gforce, nc->gforce.x, nc->gforce.y, nc->gforce.z);
+            break;
+        case EXP_CLASSIC:
+        case EXP_MOTION_PLUS_CLASSIC:
+            flags |= WIIMOTE_SHM_HAS_CLASSIC;
+            s->classic_btns = (uint16_t)cc->btns;
+            s->classic_ljs[0] = cc->ljs.x;
+            s->classic_ljs[1] = cc->ljs.y;
+            s->classic_rjs[0] = cc->rjs.x;
+            s->classic_rjs[1] = cc->rjs.y;
+            s->classic_shoulders[0] = cc->l_shoulder;
+            s->classic_shoulders[1] = cc->r_shoulder;
+            break;
+        case EXP_WII_BOARD:
+            flags |= WIIMOTE_SHM_HAS_BALANCE;
+            s->balance[0] = wm->exp.wb.tl;
+            s->balance[1] = wm->exp.wb.tr;
+            s->balance[2] = wm->exp.wb.bl;
+            s->balance[3] = wm->exp.wb.br;
+            break;
+    }
+    if (wm->exp.type == EXP_MOTION_PLUS || wm->exp.type == EXP_MOTION_PLUS_NUNCHUK
+        || wm->exp.type == EXP_MOTION_PLUS_CLASSIC) {
+        flags |= WIIMOTE_SHM_HAS_MOTION_PLUS;
+        copy3(s->motion_plus_rate, mp->angle_rate_gyro.roll, mp->angle_rate_gyro.pitch, mp->angle_rate_gyro.yaw);
+        copy3(s->motion_plus_orient, mp->orient.roll, mp->orient.pitch, mp->orient.yaw);
+        s->motion_plus_quat[0] = mp->quat.w;
+        s->motion_plus_quat[1] = mp->quat.x;
+        s->motion_plus_quat[2] = mp->quat.y;
+        s->motion_plus_quat[3] = mp->quat.z;
+    }
+    s->flags = flags;
+
+    write_end(s);
+}
+
+void shm_publish_connection(shm_publisher_t* pub, int index, int id, bool connected, uint64_t now) {
+    wiimote_shm_state_t* s;
+
+    if (!pub->shm) {
+        return;
+    }
+    s = &pub->shm->remote[index];
+    write_begin(s);
+    memset((char*)s + sizeof(s->seq), 0, sizeof(*s) - sizeof(s->seq));
+    s->id = id;
+    s->connected = connected;
+    s->publish_us = now;
+    write_end(s);
+}
+
+void shm_publisher_close(shm_publisher_t* pub) {
+    int i;
+
+    if (!pub->shm) {
+        return;
+    }
+    for (i = 0; i < WIIMOTE_SHM_MAX_REMOTES; i++) {
+        if (pub->shm->remote[i].connected) {
+            shm_publish_connection(pub, i, pub->shm->remote[i].id, false, pub->shm->remote[i].publish_us);
+        }
+    }
+    munmap(pub->shm, sizeof(wiimote_shm_t));
+    pub->shm = NULL;
+}
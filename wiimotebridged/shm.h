@@ -0,0 +1,48 @@
+#ifndef SHM_H_INCLUDED
+#define SHM_H_INCLUDED
+
+#include "wiiuse.h"
+#include "wiimote_shm.h"
+
+/**
+ * @brief Publisher of the latest state of every remote into a POSIX
+ * shared-memory segment, see wiimote_shm.h for the reader's side
+ */
+typedef struct {
+    char name[64];
+    wiimote_shm_t* shm;     // NULL while not publishing
+} shm_publisher_t;
+
+/**
+ * @brief Create or reuse the segment and mark every remote disconnected
+ *
+ * @param pub Publisher to set up
+ * @param name Segment name, e.g. WIIMOTE_SHM_NAME
+ * @param num_remotes Remotes the bridge serves, at most WIIMOTE_SHM_MAX_REMOTES
+ * @return int 0 on success, -1 on error
+ */
+int shm_publisher_open(shm_publisher_t* pub, const char* name, int num_remotes);
+
+/**
+ * @brief Publish the state of a remote after a report
+ *
+ * @param pub Publisher, nothing happens if it is not open
+ * @param index Remote
+ * @param id Its OSC id
+ * @param wm The remote
+ * @param now Current CLOCK_MONOTONIC time in microseconds
+ */
+void shm_publish(shm_publisher_t* pub, int index, int id, struct wiimote_t* wm, uint64_t now);
+
+/**
+ * @brief Mark a remote connected or disconnected, clearing its state
+ */
+void shm_publish_connection(shm_publisher_t* pub, int index, int id, bool connected, uint64_t now);
+
+/**
+ * @brief Mark every remote disconnected and unmap the segment, which stays
+ * for the next bridge
+ */
+void shm_publisher_close(shm_publisher_t* pub);
+
+#endif /* SHM_H_INCLUDED */
@@ -0,0 +1,129 @@
+#ifndef WIIMOTE_SHM_H_INCLUDED
+#define WIIMOTE_SHM_H_INCLUDED
+
+/*
+ * Latest state of the remotes of a wiimotebridged running on the same host
+ * (started with --shm), for readers that would rather skip OSC:
+ *
+ *     int fd = shm_open(WIIMOTE_SHM_NAME, O_RDONLY, 0);
+ *     const wiimote_shm_t* shm = mmap(NULL, sizeof(wiimote_shm_t), PROT_READ, MAP_SHARED, fd, 0);
+ *     wiimote_shm_state_t s;
+ *
+ *     if (wiimote_shm_valid(shm) && wiimote_shm_read(shm, 0, &s) && s.connected) {
+ *         ... s.orient[0] is the roll of the first remote ...
+ *     }
+ *
+ * Each remote is a seqlock: the bridge makes seq odd, updates the state and
+ * makes seq even again, and a reader copies the state and retries if seq was
+ * odd or moved meanwhile. Reading takes no syscall and never holds up the
+ * bridge. The segment outlives the bridge so readers keep their mapping
+ * across restarts; compare publish_us with CLOCK_MONOTONIC to spot a stale
+ * state, and reports to spot a new one.
+ *
+ * Needs GCC or Clang for the __atomic builtins.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#define WIIMOTE_SHM_NAME "/wiimotebridged"     // default segment name
+#define WIIMOTE_SHM_MAGIC 0x53494957u           // "WIIS"
+#define WIIMOTE_SHM_VERSION 1
+#define WIIMOTE_SHM_MAX_REMOTES 4
+
+// wiimote_shm_state_t.flags: what the remote currently produces
+#define WIIMOTE_SHM_HAS_ACCEL 0x0001            // accel, orient and gforce
+#define WIIMOTE_SHM_HAS_IR 0x0002               // the IR cursor
+#define WIIMOTE_SHM_HAS_IR_POSE 0x0004
+#define WIIMOTE_SHM_HAS_NUNCHUK 0x0008
+#define WIIMOTE_SHM_HAS_CLASSIC 0x0010
+#define WIIMOTE_SHM_HAS_BALANCE 0x0020
+#define WIIMOTE_SHM_HAS_MOTION_PLUS 0x0040
+
+/**
+ * @brief Decoded state of one remote, in the units of wiiuse.h
+ */
+typedef struct {
+    uint32_t seq;               // seqlock, odd while the bridge writes
+    int32_t id;                 // OSC id, -1 until the remote connects
+    uint32_t connected;
+    uint32_t exp_type;          // EXP_* of wiiuse.h
+    uint64_t report_us;         // CLOCK_MONOTONIC time of the report
+    uint64_t publish_us;        // CLOCK_MONOTONIC time it was published
+    uint64_t reports;           // reports published since the remote connected
+
+    uint16_t btns;              // WIIMOTE_BUTTON_* held
+    uint16_t nunchuk_btns;      // NUNCHUK_BUTTON_* held
+    uint16_t classic_btns;      // CLASSIC_CTRL_BUTTON_* held
+    uint16_t flags;             // WIIMOTE_SHM_HAS_*
+    float battery;              // 0 to 1
+
+    float accel[3];             // raw x, y, z
+    float orient[3];            // roll, pitch, yaw in degrees
+    float gforce[3];
+    float ir[3];                // cursor x, y and distance
+    float ir_pose[3];           // position in the constellation frame
+    float ir_pose_orient[3];    // roll, pitch, yaw
+    float nunchuk_js[2];
+    float nunchuk_accel[3];
+    float nunchuk_orient[3];
+    float nunchuk_gforce[3];
+    float classic_ljs[2];
+    float classic_rjs[2];
+    float classic_shoulders[2];
+    float balance[4];           // top left, top right, bottom left, bottom right in kg
+    float motion_plus_rate[3];  // roll, pitch, yaw rates in degrees/s
+    float motion_plus_orient[3];
+    float motion_plus_quat[4];  // w, x, y, z
+} wiimote_shm_state_t;
+
+/**
+ * @brief The whole segment
+ */
+typedef struct {
+    uint32_t magic;             // WIIMOTE_SHM_MAGIC once the bridge set it up
+    uint32_t version;           // WIIMOTE_SHM_VERSION
+    uint32_t state_size;        // sizeof(wiimote_shm_state_t) of the bridge
+    uint32_t num_remotes;       // remotes the bridge serves
+    wiimote_shm_state_t remote[WIIMOTE_SHM_MAX_REMOTES];
+} wiimote_shm_t;
+
+/**
+ * @brief Check that a mapped segment was set up by a compatible bridge
+ */
+static inline bool wiimote_shm_valid(const wiimote_shm_t* shm) {
+    return __atomic_load_n(&shm->magic, __ATOMIC_ACQUIRE) == WIIMOTE_SHM_MAGIC
+        && shm->version == WIIMOTE_SHM_VERSION && shm->state_size == sizeof(wiimote_shm_state_t);
+}
+
+/**
+ * @brief Copy the latest consistent state of a remote
+ *
+ * @param shm Mapped segment
+ * @param index Remote, below num_remotes
+ * @param out Receives the state
+ * @return bool false if the bridge kept writing for every try, which would
+ * take it publishing faster than the copy; try again later
+ */
+static inline bool wiimote_shm_read(const wiimote_shm_t* shm, int index, wiimote_shm_state_t* out) {
+    const wiimote_shm_state_t* s = &shm->remote[index];
+    int tries;
+
+    for (tries = 0; tries < 100; tries++) {
+        uint32_t seq = __atomic_load_n(&s->seq, __ATOMIC_ACQUIRE);
+
+        if (seq & 1) {
+            continue;
+        }
+        memcpy(out, s, sizeof(*out));
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        if (__atomic_load_n(&s->seq, __ATOMIC_RELAXED) == seq) {
+            out->seq = seq;
+            return true;
+        }
+    }
+    return false;
+}
+
+#endif /* WIIMOTE_SHM_H_INCLUDED */
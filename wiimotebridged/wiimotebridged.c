@@ -23,174 +23,260 @@
 #include <stdio.h>      /* for printf */
 #include <stdlib.h>     /* for atoi */
 #include <string.h>     /* for memset */
-#include <time.h>       /* for time */
+#include <time.h>       /* for time, clock_gettime */
 #include <stdbool.h>    /* for bool type */
+#include <math.h>       /* for fabsf, lroundf */
+#include <signal.h>     /* for sigaction */
 
 #include "wiiuse.h"                     /* for wiimote_t, classic_ctrl_t, etc */
 
 #ifndef WIIUSE_WIN32
-#include <unistd.h>                     /* for usleep */
+#include <strings.h>                    /* for strcasecmp */
 #endif
 
 #include "osc.h"
+#include "mapping.h"
+#include "shm.h"
 
 #define CONNECTION_TIMEOUT			30
+#define MAX_WIIMOTES				4
+#define MAX_ID_MAPPINGS				16
+#define CALIBRATION_RESEND_US		1000000   // --raw: resend the calibration this often
+
+// What is sent where comes from the mapping (see mapping.conf). Continuous
+// values are sent when they move by more than their deadband, at most
+// max_hz times a second, and at least every heartbeat_ms while produced.
+// No cap by default: the report rate, or the output tick, bounds the rate.
+
+// State of one mapping entry of one remote, see channel_service()
+typedef struct {
+	osc_template_t msg;
+	struct filter_chain_t filter;       // the entry's filters, values only
+	float value[MAPPING_MAX_DIM];       // latest value
+	osc_arg_t args[MAPPING_MAX_DIM];    // the same, as sent
+	float sent[MAPPING_MAX_DIM];        // value last sent
+	uint64_t sent_us;     // when, 0 if never
+	uint64_t next_us;     // rate cap: earliest time for the next change
+	bool active;          // the remote currently produces the value
+} channel_t;
+
+// Per-remote state
+typedef struct {
+	struct wiimote_t* wm;
+	int id;                  // OSC id (1-4), -1 until connected
+
+	// One per mapping entry, messages pre-encoded once the id is known
+	channel_t channels[MAPPING_MAX_ENTRIES];
+
+	// --raw: address of the reports, built once the id is known, and the
+	// calibration last sent to the decoding host, and when
+	char raw_address[32];
+	byte calibration[WIIUSE_CALIBRATION_LEN];
+	uint64_t calibration_us;
+} bridge_remote_t;
+
+// Fixed OSC id for a Bluetooth address, from the --map file
+typedef struct {
+	char bdaddr[18];
+	int id;
+} id_mapping_t;
 
 // Global variables
 osc_client_t osc_client;
-static int wiimote_id = -1;  // Initialize to invalid value
-bool b_button_pressed = false; // Track B button state
-
-// Add moving average filters for each axis
-struct {
-	moving_average_t roll;
-	moving_average_t pitch;
-	moving_average_t yaw;
-	moving_average_t accel_x;
-	moving_average_t accel_y;
-	moving_average_t accel_z;
-} filters;
+static bridge_remote_t remotes[MAX_WIIMOTES];
+static int num_remotes = 1;
+static int default_id = -1;  // id given on the command line, single remote only
+static id_mapping_t id_map[MAX_ID_MAPPINGS];
+static int id_map_len = 0;
+static mapping_t mapping;
+static const char* config_path = NULL;  // --config, NULL for mapping_default
+static volatile sig_atomic_t reload_requested = 0;  // set by SIGHUP
+static shm_publisher_t shm_publisher;  // --shm, for readers on this host
+static bool raw_mode = false;  // --raw: forward reports undecoded
+
+// Fixed output tick: continuous channels are sampled and sent once per tick
+// instead of on arrival, buttons still go out at once. 0 sends on arrival.
+static float tick_hz = 0.0f;
+static uint64_t next_tick_us = 0;
+
+/**
+ * @brief Monotonic time in microseconds, the clock of wiimote_t.timestamp_us
+ */
+static uint64_t now_us(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+/**
+ * @brief Send a channel if it changed enough, or is due for a heartbeat
+ * @param r The remote
+ * @param ch Mapping entry index
+ * @param now Current time, see now_us()
+ *
+ * A change held back by the rate cap goes out from the poll loop once the
+ * cap allows, even if the remote reports nothing new by then.
+ */
+static void channel_service(bridge_remote_t* r, int ch, uint64_t now) {
+	const mapping_entry_t* p = &mapping.entry[ch];
+	channel_t* c = &r->channels[ch];
+	bool changed = !c->sent_us;
+	int i;
+
+	for (i = 0; i < p->dim; i++) {
+		if (fabsf(c->value[i] - c->sent[i]) > p->deadband) {
+			changed = true;
+		}
+	}
+	if (changed ? (p->max_hz > 0 && now < c->next_us)
+	            : (!p->heartbeat_ms || now - c->sent_us < p->heartbeat_ms * 1000ULL)) {
+		return;
+	}
+
+	osc_send_template(&osc_client, &c->msg, c->args);
+	memcpy(c->sent, c->value, sizeof(c->sent));
+	c->sent_us = now;
+	if (p->max_hz > 0) {
+		// Keep the phase while sending steadily, so the average rate is max_hz
+		uint64_t interval = (uint64_t)(1e6f / p->max_hz);
+		c->next_us = (now >= c->next_us && now - c->next_us < interval) ? c->next_us + interval : now + interval;
+	}
+}
+
+/**
+ * @brief Record a new value of a channel and send it if warranted
+ *
+ * With a fixed tick the value waits for the next tick instead.
+ *
+ * @param r The remote
+ * @param ch Mapping entry index
+ * @param value One float per component
+ * @param args The same as OSC arguments
+ */
+static void channel_set(bridge_remote_t* r, int ch, const float* value, const osc_arg_t* args) {
+	channel_t* c = &r->channels[ch];
+
+	memcpy(c->value, value, mapping.entry[ch].dim * sizeof(float));
+	memcpy(c->args, args, mapping.entry[ch].dim * sizeof(osc_arg_t));
+	c->active = true;
+	if (tick_hz <= 0) {
+		channel_service(r, ch, now_us());
+	}
+}
+
+/**
+ * @brief --raw: forward the report of the last event as received, for
+ * wiiuse_decode_report() on the decoding host
+ * @param r The remote
+ *
+ * /wii/<id>/raw carries the Bluetooth address, the slot of the remote, the
+ * CLOCK_MONOTONIC time of the report in microseconds and the report, as
+ * long as it was read.
+ */
+static void send_raw_report(bridge_remote_t* r) {
+	struct wiimote_t* wm = r->wm;
+
+	osc_send_message(&osc_client, r->raw_address, ",sihb", wm->bdaddr_str, (int)(r - remotes),
+	                 (int64_t)wm->timestamp_us, (int)wm->raw_report_len, wm->raw_report);
+}
+
+/**
+ * @brief --raw: send the calibration for wiiuse_import_calibration() when it
+ * changed, e.g. on an expansion or the IR camera, and every second for
+ * decoding hosts that started late or lost it
+ * @param r The remote
+ * @param now Current time in microseconds
+ *
+ * /wii/<id>/raw/calibration carries the Bluetooth address, the slot and the
+ * calibration.
+ */
+static void send_calibration(bridge_remote_t* r, uint64_t now) {
+	struct wiimote_t* wm = r->wm;
+	byte calibration[WIIUSE_CALIBRATION_LEN];
+	char addr[32];
+
+	wiiuse_export_calibration(wm, calibration, sizeof(calibration));
+	if (r->calibration_us && now - r->calibration_us < CALIBRATION_RESEND_US
+	    && memcmp(calibration, r->calibration, sizeof(calibration)) == 0) {
+		return;
+	}
+	snprintf(addr, sizeof(addr), "/wii/%d/raw/calibration", r->id);
+	if (osc_send_message(&osc_client, addr, ",sib", wm->bdaddr_str, (int)(r - remotes),
+	                     WIIUSE_CALIBRATION_LEN, calibration) >= 0) {
+		memcpy(r->calibration, calibration, sizeof(calibration));
+		r->calibration_us = now;
+	}
+}
+
+/**
+ * @brief Send what the mapping makes of the report of the last event
+ * @param r The remote
+ */
+static void send_mapping(bridge_remote_t* r) {
+	struct wiimote_t* wm = r->wm;
+
+	// Local readers get the report first, they skip the network
+	shm_publish(&shm_publisher, (int)(r - remotes), r->id, wm, now_us());
+
+	// Everything this report produces goes out as one bundle
+	osc_bundle_begin(&osc_client, OSC_TIMETAG_IMMEDIATE);
+
+	for (int n = 0; n < mapping.count; n++) {
+		const mapping_entry_t* e = &mapping.entry[n];
+		channel_t* c = &r->channels[n];
+		float value[MAPPING_MAX_DIM];
+		osc_arg_t args[MAPPING_MAX_DIM];
+		bool pressed, released;
+
+		if (e->kind == MAPPING_BUTTON) {
+			if (mapping_read_button(e, wm, &pressed, &released)) {
+				if (pressed) {
+					printf("%s pressed\n", mapping_field_name(e));
+				}
+				osc_send_int(&osc_client, &c->msg, 1);
+			} else if (released) {
+				osc_send_int(&osc_client, &c->msg, 0);
+			}
+			continue;
+		}
+
+		// Values the report no longer produces stop their heartbeat
+		c->active = false;
+		if ((wm->btns & e->when) != e->when || !mapping_read_value(e, wm, value)) {
+			continue;
+		}
+		wiiuse_filter_update(&c->filter, value, value, wm->timestamp_us);
+		for (int i = 0; i < e->dim; i++) {
+			value[i] = value[i] * e->scale + e->offset;
+			if (e->format[i + 1] == 'i') {
+				args[i].i = (int32_t)lroundf(value[i]);
+			} else {
+				args[i].f = value[i];
+			}
+		}
+		channel_set(r, n, value, args);
+	}
+
+	osc_bundle_end(&osc_client);
+}
 
 /**
  *	@brief Callback that handles an event.
  *
- *	@param wm		Pointer to a wiimote_t structure.
+ *	@param r		The remote the event occurred on.
  *
- *	This function is called automatically by the wiiuse library when an
- *	event occurs on the specified wiimote.
+ *	This function is called from the poll loop when an event occurs
+ *	on the remote.
  */
-void handle_event(struct wiimote_t* wm) {
-	// printf("\n\n--- EVENT [id %i] ---\n", wiimote_id);
-
-	/* Track B button state for acceleration data */
-	if (IS_JUST_PRESSED(wm, WIIMOTE_BUTTON_B)) {
-		b_button_pressed = true;
-		printf("B pressed - acceleration data enabled\n");
-	} else if ((wm->btns_released & WIIMOTE_BUTTON_B) && b_button_pressed) {
-		b_button_pressed = false;
-		printf("B released - acceleration data disabled\n");
-	}
-
-	/* Handle all button events */
-	if (IS_PRESSED(wm, WIIMOTE_BUTTON_A)) {
-		printf("A pressed\n");
-		char addr[64];
-		snprintf(addr, sizeof(addr), "/wii/%d/buttons/a", wiimote_id);
-		osc_send_message(&osc_client, addr, ",i", 1);
-	} else if (wm->btns_released & WIIMOTE_BUTTON_A) {
-		char addr[64];
-		snprintf(addr, sizeof(addr), "/wii/%d/buttons/a", wiimote_id);
-		osc_send_message(&osc_client, addr, ",i", 0);
-	}
-	
-	if (IS_PRESSED(wm, WIIMOTE_BUTTON_B)) {
-		printf("B pressed\n");
-		char addr[64];
-		snprintf(addr, sizeof(addr), "/wii/%d/buttons/b", wiimote_id);
-		osc_send_message(&osc_client, addr, ",i", 1);
-	} else if (wm->btns_released & WIIMOTE_BUTTON_B) {
-		char addr[64];
-		snprintf(addr, sizeof(addr), "/wii/%d/buttons/b", wiimote_id);
-		osc_send_message(&osc_client, addr, ",i", 0);
-	}
-
-	if (IS_PRESSED(wm, WIIMOTE_BUTTON_UP)) {
-		printf("UP pressed\n");
-		char addr[64];
-		snprintf(addr, sizeof(addr), "/wii/%d/buttons/up", wiimote_id);
-		osc_send_message(&osc_client, addr, ",i", 1);
-	} else if (wm->btns_released & WIIMOTE_BUTTON_UP) {
-		char addr[64];
-		snprintf(addr, sizeof(addr), "/wii/%d/buttons/up", wiimote_id);
-		osc_send_message(&osc_client, addr, ",i", 0);
-	}
-
-	if (IS_PRESSED(wm, WIIMOTE_BUTTON_DOWN)) {
-		printf("DOWN pressed\n");
-		char addr[64];
-		snprintf(addr, sizeof(addr), "/wii/%d/buttons/down", wiimote_id);
-		osc_send_message(&osc_client, addr, ",i", 1);
-	} else if (wm->btns_released & WIIMOTE_BUTTON_DOWN) {
-		char addr[64];
-		snprintf(addr, sizeof(addr), "/wii/%d/buttons/down", wiimote_id);
-		osc_send_message(&osc_client, addr, ",i", 0);
-	}
-
-	if (IS_PRESSED(wm, WIIMOTE_BUTTON_LEFT)) {
-		printf("LEFT pressed\n");
-		char addr[64];
-		snprintf(addr, sizeof(addr), "/wii/%d/buttons/left", wiimote_id);
-		osc_send_message(&osc_client, addr, ",i", 1);
-	} else if (wm->btns_released & WIIMOTE_BUTTON_LEFT) {
-		char addr[64];
-		snprintf(addr, sizeof(addr), "/wii/%d/buttons/left", wiimote_id);
-		osc_send_message(&osc_client, addr, ",i", 0);
-	}
-
-	if (IS_PRESSED(wm, WIIMOTE_BUTTON_RIGHT)) {
-		printf("RIGHT pressed\n");
-		char addr[64];
-		snprintf(addr, sizeof(addr), "/wii/%d/buttons/right", wiimote_id);
-		osc_send_message(&osc_client, addr, ",i", 1);
-	} else if (wm->btns_released & WIIMOTE_BUTTON_RIGHT) {
-		char addr[64];
-		snprintf(addr, sizeof(addr), "/wii/%d/buttons/right", wiimote_id);
-		osc_send_message(&osc_client, addr, ",i", 0);
-	}
-
-	if (IS_PRESSED(wm, WIIMOTE_BUTTON_MINUS)) {
-		printf("MINUS pressed\n");
-		char addr[64];
-		snprintf(addr, sizeof(addr), "/wii/%d/buttons/minus", wiimote_id);
-		osc_send_message(&osc_client, addr, ",i", 1);
-	} else if (wm->btns_released & WIIMOTE_BUTTON_MINUS) {
-		char addr[64];
-		snprintf(addr, sizeof(addr), "/wii/%d/buttons/minus", wiimote_id);
-		osc_send_message(&osc_client, addr, ",i", 0);
-	}
-
-	if (IS_PRESSED(wm, WIIMOTE_BUTTON_PLUS)) {
-		printf("PLUS pressed\n");
-		char addr[64];
-		snprintf(addr, sizeof(addr), "/wii/%d/buttons/plus", wiimote_id);
-		osc_send_message(&osc_client, addr, ",i", 1);
-	} else if (wm->btns_released & WIIMOTE_BUTTON_PLUS) {
-		char addr[64];
-		snprintf(addr, sizeof(addr), "/wii/%d/buttons/plus", wiimote_id);
-		osc_send_message(&osc_client, addr, ",i", 0);
-	}
-
-	if (IS_PRESSED(wm, WIIMOTE_BUTTON_ONE)) {
-		printf("ONE pressed\n");
-		char addr[64];
-		snprintf(addr, sizeof(addr), "/wii/%d/buttons/one", wiimote_id);
-		osc_send_message(&osc_client, addr, ",i", 1);
-	} else if (wm->btns_released & WIIMOTE_BUTTON_ONE) {
-		char addr[64];
-		snprintf(addr, sizeof(addr), "/wii/%d/buttons/one", wiimote_id);
-		osc_send_message(&osc_client, addr, ",i", 0);
-	}
-
-	if (IS_PRESSED(wm, WIIMOTE_BUTTON_TWO)) {
-		printf("TWO pressed\n");
-		char addr[64];
-		snprintf(addr, sizeof(addr), "/wii/%d/buttons/two", wiimote_id);
-		osc_send_message(&osc_client, addr, ",i", 1);
-	} else if (wm->btns_released & WIIMOTE_BUTTON_TWO) {
-		char addr[64];
-		snprintf(addr, sizeof(addr), "/wii/%d/buttons/two", wiimote_id);
-		osc_send_message(&osc_client, addr, ",i", 0);
-	}
-
-	if (IS_PRESSED(wm, WIIMOTE_BUTTON_HOME)) {
-		printf("HOME pressed\n");
-		char addr[64];
-		snprintf(addr, sizeof(addr), "/wii/%d/buttons/home", wiimote_id);
-		osc_send_message(&osc_client, addr, ",i", 1);
-	} else if (wm->btns_released & WIIMOTE_BUTTON_HOME) {
-		char addr[64];
-		snprintf(addr, sizeof(addr), "/wii/%d/buttons/home", wiimote_id);
-		osc_send_message(&osc_client, addr, ",i", 0);
+void handle_event(bridge_remote_t* r) {
+	struct wiimote_t* wm = r->wm;
+	// printf("\n\n--- EVENT [id %i] ---\n", r->id);
+
+	// With --raw only the buttons were decoded, for the controls below
+	if (raw_mode) {
+		send_raw_report(r);
+	} else {
+		send_mapping(r);
 	}
 
 	/* Enable/disable motion sensing based on plus/minus */
@@ -221,97 +307,9 @@ void handle_event(struct wiimote_t* wm) {
 		wiiuse_set_motion_plus(wm, 0); // off
 	}
 
-	/* Handle acceleration data only when B button is pressed */
-	if (WIIUSE_USING_ACC(wm) && b_button_pressed) {
-		// Get filtered values
-		float roll = moving_average_update(&filters.roll, wm->orient.roll);
-		float pitch = moving_average_update(&filters.pitch, wm->orient.pitch);
-		float yaw = moving_average_update(&filters.yaw, wm->orient.yaw);
-		
-		// Send orientation data
-		char addr[64];
-		snprintf(addr, sizeof(addr), "/wii/%d/orientation", wiimote_id);
-		osc_send_message(&osc_client, addr, ",fff", roll, pitch, yaw);
-		
-		printf("wiimote roll  = %f [%f]\n", roll, wm->orient.a_roll);
-		printf("wiimote pitch = %f [%f]\n", pitch, wm->orient.a_pitch);
-		printf("wiimote yaw   = %f\n", yaw);
-
-		// Handle raw acceleration data
-		float accel_x = moving_average_update(&filters.accel_x, wm->accel.x);
-		float accel_y = moving_average_update(&filters.accel_y, wm->accel.y);
-		float accel_z = moving_average_update(&filters.accel_z, wm->accel.z);
-
-		if (accel_x != 0 || accel_y != 0 || accel_z != 0) {
-			snprintf(addr, sizeof(addr), "/wii/%d/accel", wiimote_id);
-			osc_send_message(&osc_client, addr, ",fff", accel_x, accel_y, accel_z);
-		}
-	}
-
-	/* Handle IR data if enabled */
-	if (WIIUSE_USING_IR(wm)) {
-		int i = 0;
-		for (; i < 4; ++i) {
-			if (wm->ir.dot[i].visible) {
-				printf("IR source %i: (%u, %u)\n", i, wm->ir.dot[i].x, wm->ir.dot[i].y);
-			}
-		}
-		printf("IR cursor: (%u, %u)\n", wm->ir.x, wm->ir.y);
-		printf("IR z distance: %f\n", wm->ir.z);
-	}
-
-	/* Handle nunchuk if connected */
-	if (wm->exp.type == EXP_NUNCHUK || wm->exp.type == EXP_MOTION_PLUS_NUNCHUK) {
-		struct nunchuk_t* nc = (nunchuk_t*)&wm->exp.nunchuk;
-
-		if (IS_PRESSED(nc, NUNCHUK_BUTTON_C)) {
-			printf("Nunchuk: C pressed\n");
-			char addr[64];
-			snprintf(addr, sizeof(addr), "/wii/%d/nunchuk/buttons/c", wiimote_id);
-			osc_send_message(&osc_client, addr, ",i", 1);
-		} else if (nc->btns_released & NUNCHUK_BUTTON_C) {
-			char addr[64];
-			snprintf(addr, sizeof(addr), "/wii/%d/nunchuk/buttons/c", wiimote_id);
-			osc_send_message(&osc_client, addr, ",i", 0);
-		}
-
-		if (IS_PRESSED(nc, NUNCHUK_BUTTON_Z)) {
-			printf("Nunchuk: Z pressed\n");
-			char addr[64];
-			snprintf(addr, sizeof(addr), "/wii/%d/nunchuk/buttons/z", wiimote_id);
-			osc_send_message(&osc_client, addr, ",i", 1);
-		} else if (nc->btns_released & NUNCHUK_BUTTON_Z) {
-			char addr[64];
-			snprintf(addr, sizeof(addr), "/wii/%d/nunchuk/buttons/z", wiimote_id);
-			osc_send_message(&osc_client, addr, ",i", 0);
-		}
-
-		// Send joystick data
-		char addr[64];
-		snprintf(addr, sizeof(addr), "/wii/%d/nunchuk/joystick", wiimote_id);
-		osc_send_message(&osc_client, addr, ",ff", nc->js.x, nc->js.y);
-	}
-
-	// Add short burst of vibration on B press
-	if (IS_JUST_PRESSED(wm, WIIMOTE_BUTTON_B)) {
-		wiiuse_rumble(wm, 1);
-#ifndef WIIUSE_WIN32
-		usleep(100000); // 100ms
-#else
-		Sleep(100);
-#endif
-		wiiuse_rumble(wm, 0);
-	}
-
-	// Add short burst of vibration on B release
-	if (wm->btns_released & WIIMOTE_BUTTON_B) {
-		wiiuse_rumble(wm, 1);
-#ifndef WIIUSE_WIN32
-		usleep(100000); // 100ms
-#else
-		Sleep(100);
-#endif
-		wiiuse_rumble(wm, 0);
+	// Add short burst of vibration on B press and release, played by wiiuse_poll()
+	if (IS_JUST_PRESSED(wm, WIIMOTE_BUTTON_B) || (wm->btns_released & WIIMOTE_BUTTON_B)) {
+		wiiuse_rumble_pulse(wm, 100, 1.0f);
 	}
 }
 
@@ -351,12 +349,7 @@ void handle_read(struct wiimote_t* wm, byte* data, unsigned short len) {
 /**
  *	@brief Callback that handles a controller status event.
  *
- *	@param wm				Pointer to a wiimote_t structure.
- *	@param attachment		Is there an attachment? (1 for yes, 0 for no)
- *	@param speaker			Is the speaker enabled? (1 for yes, 0 for no)
- *	@param ir				Is the IR support enabled? (1 for yes, 0 for no)
- *	@param led				What LEDs are lit.
- *	@param battery_level	Battery level, between 0.0 (0%) and 1.0 (100%).
+ *	@param r				The remote whose status changed.
  *
  *	This occurs when either the controller status changed
  *	or the controller status was requested explicitly by
@@ -365,8 +358,10 @@ void handle_read(struct wiimote_t* wm, byte* data, unsigned short len) {
  *	One reason the status can change is if the nunchuk was
  *	inserted or removed from the expansion port.
  */
-void handle_ctrl_status(struct wiimote_t* wm) {
-	printf("\n\n--- CONTROLLER STATUS [wiimote id %i] ---\n", wiimote_id);
+void handle_ctrl_status(bridge_remote_t* r) {
+	struct wiimote_t* wm = r->wm;
+
+	printf("\n\n--- CONTROLLER STATUS [wiimote id %i] ---\n", r->id);
 
 	printf("attachment:      %i\n", wm->exp.type);
 	printf("speaker:         %i\n", WIIUSE_USING_SPEAKER(wm));
@@ -379,13 +374,18 @@ void handle_ctrl_status(struct wiimote_t* wm) {
 /**
  *	@brief Callback that handles a disconnection event.
  *
- *	@param wm				Pointer to a wiimote_t structure.
+ *	@param r				The remote that disconnected.
  *
  *	This can happen if the POWER button is pressed, or
  *	if the connection is interrupted.
  */
-void handle_disconnect(wiimote* wm) {
-	printf("\n\n--- DISCONNECTED [wiimote id %i] ---\n", wiimote_id);
+void handle_disconnect(bridge_remote_t* r) {
+	printf("\n\n--- DISCONNECTED [wiimote id %i] ---\n", r->id);
+	shm_publish_connection(&shm_publisher, (int)(r - remotes), r->id, false, now_us());
+
+	for (int ch = 0; ch < mapping.count; ch++) {
+		r->channels[ch].active = false;
+	}
 }
 
 
@@ -393,15 +393,115 @@ void test(struct wiimote_t* wm, byte* data, unsigned short len) {
 	printf("test: %i [%x %x %x %x]\n", len, data[0], data[1], data[2], data[3]);
 }
 
+/**
+ * @brief Check whether a connected remote already uses an ID
+ * @param id The ID to check
+ * @return true if taken
+ */
+static bool wiimote_id_taken(int id) {
+	int i;
+	for (i = 0; i < num_remotes; i++) {
+		if (remotes[i].id == id) {
+			return true;
+		}
+	}
+	return false;
+}
+
+/**
+ * @brief Check whether the --map file reserves an ID for some remote
+ * @param id The ID to check
+ * @return true if reserved
+ */
+static bool wiimote_id_mapped(int id) {
+	int i;
+	for (i = 0; i < id_map_len; i++) {
+		if (id_map[i].id == id) {
+			return true;
+		}
+	}
+	return false;
+}
+
 /**
  * @brief Get our assigned ID for a wiimote based on its Bluetooth address
  * @param wm Pointer to wiimote structure
- * @return The assigned ID (1-based) or -1 if not found
+ * @return The assigned ID (1-based) or -1 if all are taken
+ *
+ * Mapped addresses get their ID from the --map file. Other remotes get the
+ * ID from the command line when there is only one, else the lowest free ID,
+ * preferring those the map does not reserve.
  */
 int get_assigned_wiimote_id(struct wiimote_t* wm) {
-	if (!wm || !wm->bdaddr_str) return -1;
-	
-	return wiimote_id;
+	int i, pass;
+
+	if (!wm) return -1;
+
+	for (i = 0; i < id_map_len; i++) {
+		if (strcasecmp(id_map[i].bdaddr, wm->bdaddr_str) == 0 && !wiimote_id_taken(id_map[i].id)) {
+			return id_map[i].id;
+		}
+	}
+	if (default_id > 0 && !wiimote_id_taken(default_id)) {
+		return default_id;
+	}
+	for (pass = 0; pass < 2; pass++) {
+		for (i = 1; i <= MAX_WIIMOTES; i++) {
+			if (!wiimote_id_taken(i) && (pass || !wiimote_id_mapped(i))) {
+				return i;
+			}
+		}
+	}
+	return -1;
+}
+
+/**
+ * @brief Load the Bluetooth address to ID map
+ * @param path File with one "XX:XX:XX:XX:XX:XX id" pair per line, # comments
+ * @return 0 on success, -1 on error
+ */
+static int load_id_map(const char* path) {
+	FILE* f = fopen(path, "r");
+	char line[256];
+	int lineno = 0;
+
+	if (!f) {
+		perror(path);
+		return -1;
+	}
+	while (fgets(line, sizeof(line), f)) {
+		char bdaddr[32];
+		int id;
+		char* hash = strchr(line, '#');
+
+		lineno++;
+		if (hash) {
+			*hash = '\0';
+		}
+		if (sscanf(line, "%31s %d", bdaddr, &id) != 2) {
+			if (sscanf(line, "%31s", bdaddr) == 1) {
+				fprintf(stderr, "%s:%d: expected \"XX:XX:XX:XX:XX:XX id\"\n", path, lineno);
+				fclose(f);
+				return -1;
+			}
+			continue;
+		}
+		if (strlen(bdaddr) != 17 || id < 1 || id > MAX_WIIMOTES) {
+			fprintf(stderr, "%s:%d: invalid address or ID (1-%d)\n", path, lineno, MAX_WIIMOTES);
+			fclose(f);
+			return -1;
+		}
+		if (id_map_len == MAX_ID_MAPPINGS) {
+			fprintf(stderr, "%s:%d: more than %d remotes mapped\n", path, lineno, MAX_ID_MAPPINGS);
+			fclose(f);
+			return -1;
+		}
+		strcpy(id_map[id_map_len].bdaddr, bdaddr);
+		id_map[id_map_len].id = id;
+		id_map_len++;
+	}
+	fclose(f);
+	return 0;
 }
 
 /**
@@ -423,159 +523,463 @@ short any_wiimote_connected(wiimote** wm, int wiimotes) {
 	return 0;
 }
 
+/**
+ * @brief Set up the channels of a remote for the current mapping: OSC
+ * messages pre-encoded for its ID, fresh filters and send state
+ * @param r The remote
+ */
+static void build_channels(bridge_remote_t* r) {
+	char addr[MAPPING_MAX_ADDRESS];
+	int n;
+
+	memset(r->channels, 0, sizeof(r->channels));
+	for (n = 0; n < mapping.count; n++) {
+		const mapping_entry_t* e = &mapping.entry[n];
+
+		mapping_address(e, r->id, addr, sizeof(addr));
+		if (osc_template_init(&osc_client, &r->channels[n].msg, addr, e->format) < 0) {
+			fprintf(stderr, "OSC: cannot encode %s, not sending it\n", addr);
+		}
+		mapping_init_filter(e, &r->channels[n].filter);
+	}
+}
+
+/**
+ * @brief SIGHUP handler, the poll loop does the reload
+ */
+static void request_reload(int sig) {
+	(void)sig;
+	reload_requested = 1;
+}
+
+/**
+ * @brief Recompile the mapping file and rebuild the channels of the
+ * connected remotes, keeping the current mapping if the file is broken
+ *
+ * The remotes stay connected throughout.
+ */
+static void reload_mapping(void) {
+	int i;
+
+	reload_requested = 0;
+	if (!config_path) {
+		printf("No --config file, keeping the built-in mapping.\n");
+		return;
+	}
+	if (mapping_load(&mapping, config_path) < 0) {
+		fprintf(stderr, "Keeping the previous mapping.\n");
+		return;
+	}
+
+	osc_template_reset(&osc_client);
+	for (i = 0; i < num_remotes; i++) {
+		if (remotes[i].id >= 0) {
+			build_channels(&remotes[i]);
+		}
+	}
+	printf("Reloaded %s: %d mappings.\n", config_path, mapping.count);
+}
+
+/**
+ * @brief Set up a freshly connected wiimote: ID, LED, feedback rumble, motion sensing.
+ * @param r The remote
+ */
+static void setup_connected_wiimote(bridge_remote_t* r) {
+	struct wiimote_t* wm = r->wm;
+
+	r->id = get_assigned_wiimote_id(wm);
+	printf("Wiimote %s is ID %d\n", wm->bdaddr_str, r->id);
+	build_channels(r);
+	snprintf(r->raw_address, sizeof(r->raw_address), "/wii/%d/raw", r->id);
+	r->calibration_us = 0;
+	shm_publish_connection(&shm_publisher, (int)(r - remotes), r->id, true, now_us());
+
+	// Set LED based on ID (1-4)
+	if (r->id >= 1 && r->id <= 4) {
+		wiiuse_set_leds(wm, WIIMOTE_LED_1 << (r->id - 1));
+	}
+
+	// Brief rumble for feedback
+	wiiuse_rumble_pulse(wm, 200, 1.0f);
+
+	// Enable motion sensing
+	wiiuse_motion_sensing(wm, 1);
+
+	// The mapping's filters replace the built-in roll/pitch smoothing
+	wiiuse_set_flags(wm, 0, WIIUSE_SMOOTHING);
+
+	// Or the decoding host does all of it
+	if (raw_mode) {
+		wiiuse_set_flags(wm, WIIUSE_RAW_REPORTS, 0);
+	}
+}
+
+/**
+ * @brief Handle the events of the last wiiuse_poll() on every remote, then
+ * send the channels that are due without an event.
+ * @param wiimotes All remotes
+ *
+ * Called after every poll, events or not, for rate capped changes,
+ * heartbeats and the output tick (see --tick).
+ */
+static void dispatch_events(wiimote** wiimotes) {
+	static unsigned long next_loss_report = 1;
+	uint64_t now;
+	int i, ch;
+
+	if (reload_requested) {
+		reload_mapping();
+	}
+
+	// Packets of all remotes leave in one sendmmsg() per iteration
+	osc_queue_begin(&osc_client);
+	for (i = 0; i < num_remotes; i++) {
+		switch (wiimotes[i]->event) {
+			case WIIUSE_EVENT:
+				handle_event(&remotes[i]);
+				break;
+			case WIIUSE_STATUS:
+				handle_ctrl_status(&remotes[i]);
+				break;
+			case WIIUSE_DISCONNECT:
+			case WIIUSE_UNEXPECTED_DISCONNECT:
+				handle_disconnect(&remotes[i]);
+				break;
+			default:
+				break;
+		}
+	}
+	now = now_us();
+	if (raw_mode) {
+		for (i = 0; i < num_remotes; i++) {
+			if (remotes[i].id >= 0 && WIIMOTE_IS_CONNECTED(wiimotes[i])) {
+				send_calibration(&remotes[i], now);
+			}
+		}
+	}
+	if (tick_hz <= 0 || now >= next_tick_us) {
+		// On a tick, the latest state of every remote goes out as one bundle
+		if (tick_hz > 0) {
+			osc_bundle_begin(&osc_client, OSC_TIMETAG_IMMEDIATE);
+		}
+		for (i = 0; i < num_remotes; i++) {
+			for (ch = 0; ch < mapping.count; ch++) {
+				if (remotes[i].channels[ch].active) {
+					channel_service(&remotes[i], ch, now);
+				}
+			}
+		}
+		if (tick_hz > 0) {
+			osc_bundle_end(&osc_client);
+
+			// Stay on the tick grid, unless we fell more than a tick behind
+			uint64_t period = (uint64_t)(1e6f / tick_hz);
+			next_tick_us = (next_tick_us && now - next_tick_us < period) ? next_tick_us + period : now + period;
+		}
+	}
+	osc_queue_flush(&osc_client);
+
+	// Report losses at 1, 2, 4, 8... so a dead server doesn't flood the console
+	unsigned long lost = osc_client.stats.dropped + osc_client.stats.failed;
+	if (lost >= next_loss_report) {
+		fprintf(stderr, "OSC: %lu datagrams lost so far (%s)\n", lost,
+		        strerror(osc_client.stats.last_errno));
+		next_loss_report = lost * 2;
+	}
+}
+
+/**
+ * @brief Keep the connected remotes running for a while.
+ * @param wiimotes All remotes
+ * @param ms How long, at least; also until their rumble patterns are over
+ */
+static void serve_remotes(wiimote** wiimotes, int ms) {
+	uint64_t end = now_us() + ms * 1000ULL;
+
+	do {
+		wiiuse_poll(wiimotes, num_remotes);
+		dispatch_events(wiimotes);
+	} while (now_us() < end || wiiuse_rumble_deadline(wiimotes, num_remotes));
+}
+
+/**
+ * @brief Find and connect the remotes that are not connected yet.
+ * @param wiimotes All remotes
+ * @return Number of remotes connected in total
+ *
+ * One inquiry per round serves every pending remote, so they all share the
+ * adapter and the timeout.
+ */
+static int connect_remotes(wiimote** wiimotes) {
+	wiimote* pending[MAX_WIIMOTES];
+	time_t start_time = time(NULL);
+	int connected = 0;
+	int i, npending;
+
+	printf("Please press 1+2 on your Wiimote%s now...\n", num_remotes > 1 ? "s" : "");
+	printf("You have %d seconds to connect.\n", CONNECTION_TIMEOUT);
+
+	// Connection loop - try to find and connect wiimotes until timeout
+	while (connected < num_remotes && (time(NULL) - start_time < CONNECTION_TIMEOUT)) {
+		int seconds_remaining = CONNECTION_TIMEOUT - (time(NULL) - start_time);
+
+		// Print remaining time
+		printf("\rWaiting for %d Wiimote(s)... (%d seconds remaining)   ", num_remotes - connected, seconds_remaining);
+		fflush(stdout);
+
+		// wiiuse_find() resets every slot it is given, so only pass the free ones
+		npending = 0;
+		for (i = 0; i < num_remotes; i++) {
+			if (!WIIMOTE_IS_CONNECTED(wiimotes[i])) {
+				pending[npending++] = wiimotes[i];
+			}
+		}
+
+		// Search for wiimotes (with a short timeout)
+		if (wiiuse_find(pending, npending, 1) > 0 && wiiuse_connect(pending, npending) > 0) {
+			for (i = 0; i < num_remotes; i++) {
+				if (remotes[i].id < 0 && WIIMOTE_IS_CONNECTED(wiimotes[i])) {
+					printf("\nConnected to Wiimote (address: %s)\n", wiimotes[i]->bdaddr_str);
+					setup_connected_wiimote(&remotes[i]);
+					connected++;
+				}
+			}
+		}
+
+		// Serve the remotes already connected between inquiries, and let
+		// their connection pulse end before the next inquiry blocks
+		serve_remotes(wiimotes, 100);
+	}
+
+	printf("\n");
+	return connected;
+}
+
+/**
+ * @brief Parse a "host:port" OSC destination.
+ * @param arg The argument to parse
+ * @param client OSC client receiving host and port
+ * @return 0 on success, -1 if malformed
+ */
+static int parse_osc_destination(const char* arg, osc_client_t* client) {
+	const char* colon = strrchr(arg, ':');
+	char* endptr;
+	long port;
+
+	if (!colon || colon == arg || (size_t)(colon - arg) >= sizeof(client->host)) {
+		return -1;
+	}
+	port = strtol(colon + 1, &endptr, 10);
+	if (*endptr != '\0' || port < 1 || port > 65535) {
+		return -1;
+	}
+
+	memcpy(client->host, arg, colon - arg);
+	client->host[colon - arg] = '\0';
+	client->port = (int)port;
+	return 0;
+}
+
+static void usage(const char* argv0) {
+	fprintf(stderr, "Usage: %s [-n count] [--map file] [--config file] [--osc host:port] [--shm name] [--raw] [--virtual fd]... [--tick hz] [wiimote_id]\n", argv0);
+	fprintf(stderr, "  wiimote_id must be between 1 and 4, for a single remote\n");
+	fprintf(stderr, "  -n count         number of remotes to bridge, 1 to %d (default 1)\n", MAX_WIIMOTES);
+	fprintf(stderr, "  --map file       fixed IDs by Bluetooth address, one \"XX:XX:XX:XX:XX:XX id\" per line\n");
+	fprintf(stderr, "  --config file    what to send where, see mapping.conf; reloaded on SIGHUP\n");
+	fprintf(stderr, "                   (default: the /wii/<id>/... messages of mapping.conf)\n");
+	fprintf(stderr, "  --osc host:port  send to this OSC server instead of discovering it\n");
+	fprintf(stderr, "  --shm name       also publish the latest state of every remote in this POSIX\n");
+	fprintf(stderr, "                   shared-memory segment, e.g. %s (see wiimote_shm.h)\n", WIIMOTE_SHM_NAME);
+	fprintf(stderr, "  --raw            forward the reports undecoded, with the calibration, to\n");
+	fprintf(stderr, "                   decode them on the OSC host (see passthrough.c); the\n");
+	fprintf(stderr, "                   mapping and --shm are not used, the controls still work\n");
+	fprintf(stderr, "  --virtual fd     use an inherited SOCK_SEQPACKET socket as a remote, once per remote\n");
+	fprintf(stderr, "  --tick hz        send continuous values once per tick, e.g. at the render frame\n");
+	fprintf(stderr, "                   rate; buttons are never delayed (default 0: on arrival)\n");
+}
+
 /**
  *	@brief main()
  *
- *	Connect to up to two wiimotes and print any events
- *	that occur on either device.
+ *	Connect to up to four wiimotes and bridge the events of all of them
+ *	from a single poll loop.
  */
 int main(int argc, char** argv) {
+	const char* id_arg = NULL;
+	const char* osc_arg = NULL;
+	const char* map_arg = NULL;
+	const char* shm_arg = NULL;
+	int virtual_fds[MAX_WIIMOTES];
+	int num_virtual = 0;
+	int argi, i;
+
 	// Validate command line args first
-	if (argc != 2) {
-		fprintf(stderr, "Error: Wiimote ID argument is required\n\n");
-		fprintf(stderr, "Usage: %s <wiimote_id>\n", argv[0]);
-		fprintf(stderr, "  wiimote_id must be between 1 and 4\n");
-		return 1;
+	for (argi = 1; argi < argc; argi++) {
+		if (strcmp(argv[argi], "--osc") == 0 && argi + 1 < argc) {
+			osc_arg = argv[++argi];
+		} else if (strcmp(argv[argi], "--map") == 0 && argi + 1 < argc) {
+			map_arg = argv[++argi];
+		} else if (strcmp(argv[argi], "--tick") == 0 && argi + 1 < argc) {
+			tick_hz = atof(argv[++argi]);
+			if (tick_hz < 0 || tick_hz > 1000) {
+				fprintf(stderr, "Error: Invalid tick rate. Must be between 0 and 1000 Hz.\n");
+				return 1;
+			}
+		} else if (strcmp(argv[argi], "--shm") == 0 && argi + 1 < argc) {
+			shm_arg = argv[++argi];
+		} else if (strcmp(argv[argi], "--raw") == 0) {
+			raw_mode = true;
+		} else if (strcmp(argv[argi], "--config") == 0 && argi + 1 < argc) {
+			config_path = argv[++argi];
+		} else if (strcmp(argv[argi], "-n") == 0 && argi + 1 < argc) {
+			num_remotes = atoi(argv[++argi]);
+			if (num_remotes < 1 || num_remotes > MAX_WIIMOTES) {
+				fprintf(stderr, "Error: Invalid number of remotes. Must be between 1 and %d.\n", MAX_WIIMOTES);
+				return 1;
+			}
+		} else if (strcmp(argv[argi], "--virtual") == 0 && argi + 1 < argc && num_virtual < MAX_WIIMOTES) {
+			virtual_fds[num_virtual++] = atoi(argv[++argi]);
+		} else if (!id_arg && argv[argi][0] != '-') {
+			id_arg = argv[argi];
+		} else {
+			usage(argv[0]);
+			return 1;
+		}
+	}
+	if (num_virtual > 0) {
+		num_remotes = num_virtual;
 	}
 
 	// Parse and validate Wiimote ID
-	char* endptr;
-	wiimote_id = strtol(argv[1], &endptr, 10);
-	if (*endptr != '\0' || wiimote_id < 1 || wiimote_id > 4) {
-		fprintf(stderr, "Error: Invalid Wiimote ID '%s'. Must be a number between 1 and 4.\n", argv[1]);
+	if (id_arg) {
+		char* endptr;
+		default_id = strtol(id_arg, &endptr, 10);
+		if (*endptr != '\0' || default_id < 1 || default_id > 4) {
+			fprintf(stderr, "Error: Invalid Wiimote ID '%s'. Must be a number between 1 and 4.\n", id_arg);
+			return 1;
+		}
+		if (num_remotes > 1) {
+			fprintf(stderr, "Error: A Wiimote ID only applies to a single remote; use --map with -n.\n\n");
+			usage(argv[0]);
+			return 1;
+		}
+	} else if (num_remotes == 1 && !map_arg) {
+		fprintf(stderr, "Error: Wiimote ID argument is required\n\n");
+		usage(argv[0]);
+		return 1;
+	}
+	if (map_arg && load_id_map(map_arg) < 0) {
 		return 1;
 	}
+	if (config_path ? mapping_load(&mapping, config_path) < 0
+	                : mapping_compile(&mapping, mapping_default, "built-in mapping") < 0) {
+		return 1;
+	}
+
+#ifndef WIIUSE_WIN32
+	// Reload the mapping on SIGHUP; no SA_RESTART, so the poll wakes up for it
+	struct sigaction sa;
+	memset(&sa, 0, sizeof(sa));
+	sa.sa_handler = request_reload;
+	sigemptyset(&sa.sa_mask);
+	sigaction(SIGHUP, &sa, NULL);
+#endif
 
-	// Only continue if we have a valid ID
-	printf("Starting wiimotebridged with Wiimote ID: %d\n", wiimote_id);
+	printf("Starting wiimotebridged for %d Wiimote(s)\n", num_remotes);
 
 	wiimote** wiimotes;
-	int found, connected;
-	time_t start_time;
-	int seconds_remaining;
-	
+	int connected;
+
 	// Initialize OSC client structure
 	memset(&osc_client, 0, sizeof(osc_client));
 
-	// Try to discover OSC server
-	printf("Discovering OSC server...\n");
-	if (osc_discover_server(&osc_client) < 0) {
-		printf("Failed to discover OSC server. Please check if AgapeKidAvatarBridge is running.\n");
-		return 1;
+	if (osc_arg) {
+		// Fixed destination, no discovery
+		if (parse_osc_destination(osc_arg, &osc_client) < 0 || osc_init(&osc_client) < 0) {
+			fprintf(stderr, "Error: Invalid OSC destination '%s'.\n", osc_arg);
+			return 1;
+		}
+	} else {
+		// Try to discover OSC server
+		printf("Discovering OSC server...\n");
+		if (osc_discover_server(&osc_client) < 0) {
+			printf("Failed to discover OSC server. Please check if AgapeKidAvatarBridge is running.\n");
+			return 1;
+		}
 	}
 	printf("Successfully connected to OSC server at %s:%d\n", osc_client.host, osc_client.port);
 
-	// Initialize moving average filters
-	moving_average_init(&filters.roll, 0.5f);
-	moving_average_init(&filters.pitch, 0.5f);
-	moving_average_init(&filters.yaw, 0.5f);
-	moving_average_init(&filters.accel_x, 0.1f);
-	moving_average_init(&filters.accel_y, 0.1f);
-	moving_average_init(&filters.accel_z, 0.1f);
+	if (shm_arg) {
+		if (shm_publisher_open(&shm_publisher, shm_arg, num_remotes) < 0) {
+			fprintf(stderr, "Error: Cannot publish to shared memory '%s'.\n", shm_arg);
+			return 1;
+		}
+		printf("Publishing remote state to shared memory %s\n", shm_arg);
+	}
 
-	// Initialize wiimote
-	wiimotes = wiiuse_init(1);  // Just one wiimote
+	// Initialize wiimotes
+	wiimotes = wiiuse_init(num_remotes);
 	if (!wiimotes) {
-		printf("Failed to initialize wiimote.\n");
+		printf("Failed to initialize wiimotes.\n");
 		return 1;
 	}
 
-	printf("Please press 1+2 on your Wiimote now...\n");
-	printf("You have %d seconds to connect.\n", CONNECTION_TIMEOUT);
-	
-	// Record the start time
-	start_time = time(NULL);
-	bool is_connected = false;
-	
-	// Connection loop - try to find and connect wiimote until timeout
-	while (!is_connected && (time(NULL) - start_time < CONNECTION_TIMEOUT)) {
-		seconds_remaining = CONNECTION_TIMEOUT - (time(NULL) - start_time);
-		
-		// Print remaining time
-		printf("\rWaiting for Wiimote... (%d seconds remaining)   ", seconds_remaining);
-		fflush(stdout);
-		
-		// Search for wiimote (with a short timeout)
-		found = wiiuse_find(wiimotes, 1, 1); // 1 second timeout
-		
-		if (found > 0) {
-			// Try to connect to found wiimote
-			connected = wiiuse_connect(wiimotes, 1);
-			
-			if (connected > 0 && wiimotes[0] && WIIMOTE_IS_CONNECTED(wiimotes[0])) {
-				printf("\nConnected to Wiimote (address: %s)\n", wiimotes[0]->bdaddr_str);
-				
-				// Set LED based on ID (1-4)
-				if (wiimote_id >= 1 && wiimote_id <= 4) {
-					wiiuse_set_leds(wiimotes[0], WIIMOTE_LED_1 << (wiimote_id - 1));
-				}
-				
-				// Brief rumble for feedback
-				wiiuse_rumble(wiimotes[0], 1);
-#ifndef WIIUSE_WIN32
-				usleep(200000);
-#else
-				Sleep(200);
-#endif
-				wiiuse_rumble(wiimotes[0], 0);
-				
-				// Enable motion sensing
-				wiiuse_motion_sensing(wiimotes[0], 1);
-				
-				is_connected = true;
-				break;
+	// Initialize per-remote state, channels are built once connected
+	for (i = 0; i < num_remotes; i++) {
+		bridge_remote_t* r = &remotes[i];
+
+		memset(r, 0, sizeof(*r));
+		r->wm = wiimotes[i];
+		r->id = -1;
+	}
+
+	if (num_virtual > 0) {
+		// Emulated remotes on inherited sockets, used by the latency benchmark
+		for (i = 0; i < num_virtual; i++) {
+			if (!wiiuse_connect_socket(wiimotes[i], virtual_fds[i])) {
+				fprintf(stderr, "Error: Cannot use fd %d as a Wiimote.\n", virtual_fds[i]);
+				wiiuse_cleanup(wiimotes, num_remotes);
+				return 1;
 			}
+			printf("Connected to virtual Wiimote on fd %d\n", virtual_fds[i]);
+			setup_connected_wiimote(&remotes[i]);
 		}
-		
-		// Small delay to prevent CPU hogging
-#ifndef WIIUSE_WIN32
-		usleep(100000); // 100ms
-#else
-		Sleep(100);
-#endif
+		connected = num_virtual;
+	} else {
+		connected = connect_remotes(wiimotes);
 	}
-	
-	printf("\n");
-	
-	// Check if wiimote was connected
-	if (!is_connected) {
+
+	// Check if any wiimote was connected
+	if (!connected) {
 		printf("No Wiimote connected within the %d second timeout. Exiting.\n", CONNECTION_TIMEOUT);
-		wiiuse_cleanup(wiimotes, 1);
+		wiiuse_cleanup(wiimotes, num_remotes);
 		return 0;
 	}
-	
-	printf("Connection complete. Wiimote ID %d ready.\n", wiimote_id);
+	if (connected < num_remotes) {
+		printf("Only %d of %d Wiimotes connected, continuing with those.\n", connected, num_remotes);
+	}
+
+	printf("Connection complete. %d Wiimote(s) ready.\n", connected);
 
 	printf("\nControls:\n");
 	printf("\tB toggles rumble.\n");
-	printf("\tB (hold) enables acceleration data sending.\n");
+	printf("\tB (hold) enables orientation and acceleration data sending (default mapping).\n");
 	printf("\t+ to start Wiimote accelerometer reporting, - to stop\n");
 	printf("\tUP to start IR camera (sensor bar mode), DOWN to stop.\n");
 	printf("\t1 to start Motion+ reporting, 2 to stop.\n");
 	printf("\n\n");
 
-	// Main loop
-	while (wiimotes[0] && WIIMOTE_IS_CONNECTED(wiimotes[0])) {
-		if (wiiuse_poll(wiimotes, 1)) {
-			switch (wiimotes[0]->event) {
-				case WIIUSE_EVENT:
-					handle_event(wiimotes[0]);
-					break;
-				case WIIUSE_STATUS:
-					handle_ctrl_status(wiimotes[0]);
-					break;
-				case WIIUSE_DISCONNECT:
-				case WIIUSE_UNEXPECTED_DISCONNECT:
-					handle_disconnect(wiimotes[0]);
-					break;
-				default:
-					break;
-			}
-		}
+	// Main loop: one poll serves every remote
+	while (any_wiimote_connected(wiimotes, num_remotes)) {
+		wiiuse_poll(wiimotes, num_remotes);
+		dispatch_events(wiimotes);
 	}
 
 	// Cleanup
-	wiiuse_cleanup(wiimotes, 1);
-	printf("Wiimote disconnected. Exiting.\n");
+	wiiuse_cleanup(wiimotes, num_remotes);
+	shm_publisher_close(&shm_publisher);
+	printf("All Wiimotes disconnected. Exiting.\n");
+	printf("OSC: %lu datagrams (%lu bytes) sent, %lu dropped, %lu failed\n", osc_client.stats.packets,
+	       osc_client.stats.bytes, osc_client.stats.dropped, osc_client.stats.failed);
 	return 0;
 }